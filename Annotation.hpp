@@ -0,0 +1,103 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CALLGRIND_VIEWER__ANNOTATION_HPP_
+#define CALLGRIND_VIEWER__ANNOTATION_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+#include "Profile.hpp"
+
+/* Costs of a function grouped by the value of one of its positions, by
+   source line or by instruction address. Calls are accounted to the
+   position of the call. */
+class Annotation {
+ public:
+  using Cost = Profile::Cost;
+  using SubPosition = Profile::SubPosition;
+
+  struct Line {
+    SubPosition position{0};
+    Cost self{0};
+    /* inclusive costs of the calls made there */
+    Cost calls{0};
+
+    Cost total() const { return self + calls; }
+  };
+
+  Annotation() = default;
+
+  /* position and event index the positions and events of profile */
+  Annotation(const Profile &profile, Profile::FunctionId function,
+             size_t position, size_t event) {
+    for (const auto &block : profile.blocks()) {
+      if (block.function != function) continue;
+      for (uint32_t irow = 0; irow < block.nrows; ++irow) {
+        const auto row = block.offset + irow;
+        lines_.push_back({profile.rowSubPositions(row)[position],
+                          profile.rowCosts(row)[event], 0});
+      }
+    }
+    for (auto call : profile.calls(function)) {
+      lines_.push_back({profile.callSubPositions(call)[position], 0,
+                        profile.callCost(call)[event]});
+    }
+
+    /* merges the lines of a position */
+    std::stable_sort(begin(lines_), end(lines_),
+                     [](const Line &lhs, const Line &rhs) {
+                       return lhs.position < rhs.position;
+                     });
+    size_t merged = 0;
+    for (size_t iline = 0; iline < lines_.size(); ++iline) {
+      auto &last = lines_[merged > 0 ? merged - 1 : 0];
+      if (merged > 0 && last.position == lines_[iline].position) {
+        last.self += lines_[iline].self;
+        last.calls += lines_[iline].calls;
+      } else {
+        lines_[merged++] = lines_[iline];
+      }
+    }
+    lines_.resize(merged);
+
+    by_cost_.resize(lines_.size());
+    std::iota(begin(by_cost_), end(by_cost_), size_t(0));
+    std::stable_sort(begin(by_cost_), end(by_cost_),
+                     [this](size_t lhs, size_t rhs) {
+                       return lines_[lhs].total() > lines_[rhs].total();
+                     });
+    for (const auto &line : lines_) total_ += line.total();
+  }
+
+  /* by position */
+  const std::vector<Line> &lines() const { return lines_; }
+  /* indices of lines, the most expensive first */
+  const std::vector<size_t> &byCost() const { return by_cost_; }
+  Cost total() const { return total_; }
+
+ private:
+  std::vector<Line> lines_;
+  std::vector<size_t> by_cost_;
+  Cost total_{0};
+};
+
+#endif  // CALLGRIND_VIEWER__ANNOTATION_HPP_
@@ -0,0 +1,63 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "Annotation.hpp"
+
+#include <gtest/gtest.h>
+
+TEST(Annotation, GroupsByPosition) {
+  Profile profile;
+  profile.setPositions({"instr", "line"});
+  profile.setEvents({"Ir", "D1mr"});
+  auto object = profile.names().intern("a.out");
+  auto file = profile.names().intern("a.c");
+  auto main_function =
+      profile.addFunction(object, file, profile.names().intern("main"));
+  auto foo = profile.addFunction(object, file, profile.names().intern("foo"));
+
+  const Profile::SubPosition at_10[] = {0x100, 10};
+  const Profile::SubPosition at_12[] = {0x104, 12};
+  const Profile::SubPosition at_12_again[] = {0x108, 12};
+  const Profile::Cost cost[] = {5, 1};
+  const Profile::Cost loop[] = {100, 7};
+  profile.addCost(main_function, at_10, cost);
+  profile.addCost(main_function, at_12, loop);
+  profile.addCost(foo, at_10, cost);
+  profile.addCall(main_function, foo, 1, at_10, at_10, cost);
+  profile.addCost(main_function, at_12_again, loop);
+  profile.finalize();
+
+  const Annotation by_line(profile, main_function, 1, 0);
+  ASSERT_EQ(by_line.lines().size(), 2);
+  EXPECT_EQ(by_line.lines()[0].position, 10);
+  EXPECT_EQ(by_line.lines()[0].self, 5);
+  EXPECT_EQ(by_line.lines()[0].calls, 5);
+  EXPECT_EQ(by_line.lines()[1].position, 12);
+  EXPECT_EQ(by_line.lines()[1].self, 200);
+  EXPECT_EQ(by_line.byCost(), (std::vector<size_t>{1, 0}));
+  EXPECT_EQ(by_line.total(), 210);
+
+  const Annotation by_instr(profile, main_function, 0, 1);
+  ASSERT_EQ(by_instr.lines().size(), 3);
+  EXPECT_EQ(by_instr.lines()[2].position, 0x108);
+  EXPECT_EQ(by_instr.lines()[2].self, 7);
+  EXPECT_EQ(by_instr.total(), 16);
+
+  EXPECT_TRUE(Annotation(profile, foo, 1, 0).lines().size() == 1);
+}
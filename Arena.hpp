@@ -0,0 +1,218 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CALLGRIND_VIEWER__ARENA_HPP_
+#define CALLGRIND_VIEWER__ARENA_HPP_
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "Span.hpp"
+
+/* Bump allocator: memory is taken from large blocks and released all at once
+   when the arena dies. Only for trivially destructible types. */
+class Arena {
+ public:
+  static constexpr size_t kDefaultBlockSize = size_t(4) << 20;
+
+  explicit Arena(size_t block_size = kDefaultBlockSize)
+      : block_size_(block_size) {}
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+  Arena(Arena &&) = default;
+  Arena &operator=(Arena &&) = default;
+
+  template <typename T>
+  T *allocate(size_t n) {
+    static_assert(std::is_trivially_destructible_v<T>);
+    return static_cast<T *>(allocateBytes(n * sizeof(T), alignof(T)));
+  }
+
+  void *allocateBytes(size_t size, size_t alignment) {
+    auto aligned = (cursor_ + alignment - 1) & ~(uintptr_t(alignment) - 1);
+    if (cursor_ == 0 || aligned + size > end_) {
+      const auto block_size = std::max(block_size_, size + alignment);
+      blocks_.emplace_back(new char[block_size]);
+      cursor_ = uintptr_t(blocks_.back().get());
+      end_ = cursor_ + block_size;
+      aligned = (cursor_ + alignment - 1) & ~(uintptr_t(alignment) - 1);
+    }
+    cursor_ = aligned + size;
+    bytes_allocated_ += size;
+    return reinterpret_cast<void *>(aligned);
+  }
+
+  size_t bytesAllocated() const { return bytes_allocated_; }
+  size_t blockCount() const { return blocks_.size(); }
+
+ private:
+  size_t block_size_;
+  std::vector<std::unique_ptr<char[]> > blocks_;
+  uintptr_t cursor_{0};
+  uintptr_t end_{0};
+  size_t bytes_allocated_{0};
+};
+
+/* Fixed-width rows of uint64_t kept in arena chunks and addressed by row
+   index. Rows never move once appended and never straddle chunks. */
+class RowStore {
+ public:
+  /* rows reserved by reserve(); they stay writable through the range while
+     the store grows further, so different ranges may be filled
+     concurrently */
+  class Range {
+   public:
+    uint64_t *operator[](size_t row) const {
+      assert(row < size_);
+      row += first_row_;
+      return chunks_[(row >> chunk_shift_) - first_chunk_] +
+             (row & ((size_t(1) << chunk_shift_) - 1)) * width_;
+    }
+    size_t size() const { return size_; }
+
+   private:
+    friend class RowStore;
+    std::vector<uint64_t *> chunks_;
+    size_t first_row_{0};
+    size_t first_chunk_{0};
+    size_t size_{0};
+    size_t width_{0};
+    size_t chunk_shift_{0};
+  };
+
+  explicit RowStore(Arena &arena) : arena_(&arena) {}
+
+  void setWidth(size_t width) {
+    assert(size_ == 0);
+    width_ = width;
+    /* power of two rows per chunk of at most kChunkBytes */
+    chunk_shift_ = 0;
+    while ((size_t(2) << chunk_shift_) * std::max<size_t>(width_, 1) *
+               sizeof(uint64_t) <=
+           kChunkBytes) {
+      ++chunk_shift_;
+    }
+  }
+
+  uint64_t *append() {
+    assert(!adopted_);
+    const auto slot = size_ & chunkMask();
+    if (slot == 0) {
+      chunks_.push_back(
+          arena_->allocate<uint64_t>(width_ << chunk_shift_));
+    }
+    ++size_;
+    return chunks_.back() + slot * width_;
+  }
+
+  /* appends nrows uninitialized rows */
+  Range reserve(size_t nrows) {
+    assert(!adopted_);
+    Range range;
+    range.first_row_ = size_;
+    range.first_chunk_ = size_ >> chunk_shift_;
+    range.size_ = nrows;
+    range.width_ = width_;
+    range.chunk_shift_ = chunk_shift_;
+    size_ += nrows;
+    while ((chunks_.size() << chunk_shift_) < size_) {
+      chunks_.push_back(arena_->allocate<uint64_t>(width_ << chunk_shift_));
+    }
+    if (nrows > 0) {
+      range.chunks_.assign(chunks_.begin() + range.first_chunk_,
+                           chunks_.begin() + ((size_ - 1) >> chunk_shift_) + 1);
+    }
+    return range;
+  }
+
+  /* Uses nrows contiguous rows owned by someone else, laid out as
+     forEachRun() gives them, instead of copying. The store must be empty
+     and becomes read-only. */
+  void adoptRows(const uint64_t *rows, size_t nrows) {
+    assert(size_ == 0);
+    for (size_t row = 0; row < nrows; row += size_t(1) << chunk_shift_) {
+      chunks_.push_back(const_cast<uint64_t *>(rows + row * width_));
+    }
+    size_ = nrows;
+    adopted_ = true;
+  }
+
+  /* Reads the rows other has now instead of copying them; they never move
+     and other may go on growing. Other must outlive the store, which must
+     be empty and becomes read-only. */
+  void share(const RowStore &other) {
+    assert(size_ == 0 && width_ == other.width_);
+    const auto nchunks = (other.size_ + other.chunkMask()) >> chunk_shift_;
+    chunks_.assign(other.chunks_.begin(), other.chunks_.begin() + nchunks);
+    size_ = other.size_;
+    adopted_ = true;
+  }
+
+  /* calls handler(const uint64_t *rows, size_t nrows) for the runs of
+     contiguous rows in order */
+  template <typename RunHandler>
+  void forEachRun(RunHandler &&handler) const {
+    for (size_t row = 0; row < size_; row += size_t(1) << chunk_shift_) {
+      handler(chunks_[row >> chunk_shift_],
+              std::min(size_ - row, size_t(1) << chunk_shift_));
+    }
+  }
+
+  /* the same for the rows [first, first + count) */
+  template <typename RunHandler>
+  void forEachRun(size_t first, size_t count, RunHandler &&handler) const {
+    assert(first + count <= size_);
+    for (size_t row = first, last = first + count; row < last;) {
+      const auto run = std::min(last, (row | chunkMask()) + 1) - row;
+      handler(operator[](row), run);
+      row += run;
+    }
+  }
+
+  const uint64_t *operator[](size_t row) const {
+    assert(row < size_);
+    return chunks_[row >> chunk_shift_] + (row & chunkMask()) * width_;
+  }
+  Span<const uint64_t> row(size_t row) const {
+    return {operator[](row), width_};
+  }
+
+  size_t size() const { return size_; }
+  size_t width() const { return width_; }
+
+ private:
+  static constexpr size_t kChunkBytes = size_t(1) << 20;
+
+  size_t chunkMask() const { return (size_t(1) << chunk_shift_) - 1; }
+
+  Arena *arena_;
+  size_t width_{0};
+  size_t chunk_shift_{0};
+  size_t size_{0};
+  std::vector<uint64_t *> chunks_;
+  bool adopted_{false};
+};
+
+#endif  // CALLGRIND_VIEWER__ARENA_HPP_
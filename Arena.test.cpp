@@ -0,0 +1,78 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "Arena.hpp"
+
+#include <gtest/gtest.h>
+
+TEST(Arena, Allocate) {
+  Arena arena(64);
+  auto small = arena.allocate<uint32_t>(3);
+  auto aligned = arena.allocate<uint64_t>(2);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(aligned) % alignof(uint64_t), 0);
+  EXPECT_NE(static_cast<void *>(small), static_cast<void *>(aligned));
+  /* larger than a block gets a block of its own */
+  auto large = arena.allocate<uint64_t>(100);
+  large[99] = 1;
+  EXPECT_EQ(arena.blockCount(), 2);
+  EXPECT_EQ(arena.bytesAllocated(), 3 * 4 + 2 * 8 + 100 * 8);
+}
+
+TEST(Arena, RowStore) {
+  Arena arena;
+  RowStore rows(arena);
+  rows.setWidth(3);
+  /* enough rows to span several chunks */
+  const uint64_t nrows = 200000;
+  for (uint64_t i = 0; i < nrows; ++i) {
+    auto row = rows.append();
+    row[0] = i;
+    row[1] = i * 2;
+    row[2] = i * 3;
+  }
+  ASSERT_EQ(rows.size(), nrows);
+  for (uint64_t i = 0; i < nrows; i += 997) {
+    EXPECT_EQ(rows[i][0], i);
+    EXPECT_EQ(rows.row(i)[2], i * 3);
+  }
+  EXPECT_GT(arena.bytesAllocated(), nrows * 3 * sizeof(uint64_t) - 1);
+}
+
+TEST(Arena, ShareRows) {
+  Arena arena;
+  RowStore rows(arena);
+  rows.setWidth(2);
+  const uint64_t nrows = 100000;
+  for (uint64_t i = 0; i < nrows; ++i) rows.append()[1] = i;
+
+  Arena other;
+  RowStore shared(other);
+  shared.setWidth(2);
+  shared.share(rows);
+  /* the rows appended later, into the same chunk and new ones, are not seen */
+  for (uint64_t i = 0; i < nrows; ++i) rows.append()[1] = nrows + i;
+  ASSERT_EQ(shared.size(), nrows);
+  EXPECT_EQ(shared[nrows - 1], rows[nrows - 1]);
+  uint64_t sum = 0;
+  shared.forEachRun([&sum](const uint64_t *run, size_t count) {
+    for (size_t row = 0; row < count; ++row) sum += run[row * 2 + 1];
+  });
+  EXPECT_EQ(sum, nrows * (nrows - 1) / 2);
+  EXPECT_EQ(other.bytesAllocated(), 0);
+}
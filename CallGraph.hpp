@@ -0,0 +1,200 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef CALLGRIND_VIEWER__CALLGRAPH_HPP_
+#define CALLGRIND_VIEWER__CALLGRAPH_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Profile.hpp"
+#include "Span.hpp"
+
+/* Call paths of a finalized Profile: the calls and callers of a function
+   sorted by an event once and shared by every expansion of it, and folded
+   stacks for flame graphs. Recursions are the recursive components of the
+   profile, costed as a whole. */
+class CallGraph {
+ public:
+  using FunctionId = Profile::FunctionId;
+  using CallId = Profile::CallId;
+  using Cost = Profile::Cost;
+
+  /* paths with a smaller share of the total are left out of the folded
+     stacks */
+  static constexpr double kDefaultMinFraction = 1e-5;
+
+  explicit CallGraph(const Profile &profile) : profile_(profile) {}
+
+  const Profile &profile() const { return profile_; }
+
+  /* the calls of the function, the most expensive by event first; sorted
+     on first use */
+  Span<const CallId> callsBy(FunctionId function, size_t event) {
+    if (event == Profile::kPrimaryEvent) return profile_.calls(function);
+    if (sorted_calls_.size() <= event) sorted_calls_.resize(event + 1);
+    auto [found, inserted] = sorted_calls_[event].try_emplace(function);
+    if (inserted) found->second = profile_.callsBy(function, event);
+    return {found->second.data(), found->second.size()};
+  }
+  /* the caller edges of the function, the most expensive by event first;
+     made on first use */
+  Span<const CallId> callerEdgesBy(FunctionId function, size_t event) {
+    if (sorted_callers_.size() <= event) sorted_callers_.resize(event + 1);
+    auto [found, inserted] = sorted_callers_[event].try_emplace(function);
+    if (inserted) found->second = profile_.callerEdgesBy(function, event);
+    return {found->second.data(), found->second.size()};
+  }
+
+  /* Folded stacks, "main;foo;bar 1234" lines as flame graph tools read
+     them. The profile has no stacks, so the cost of a function is spread
+     over its callers in proportion to their calls, walking down from the
+     functions nobody calls. A recursion is one frame named after the
+     function it is entered by, its self cost is the one of all its
+     functions. */
+  void writeFolded(std::ostream &os, size_t event,
+                   double min_fraction = kDefaultMinFraction) const {
+    const auto ncomponents = profile_.componentCount();
+    const auto nfunctions = profile_.functionCount();
+
+    /* the calls between components, grouped by the calling one and summed
+       by callee */
+    struct Edge {
+      uint32_t component;
+      FunctionId callee;
+      Cost cost;
+    };
+    std::vector<Cost> self(ncomponents, 0);
+    std::vector<FunctionId> first(ncomponents, Profile::kNoFunction);
+    std::vector<bool> called(ncomponents, false);
+    std::vector<size_t> offsets(ncomponents + 1, 0);
+    for (FunctionId function = 0; function < nfunctions; ++function) {
+      const auto component = profile_.component(function);
+      self[component] += profile_.selfCost(function, event);
+      /* the most expensive function names a recursion nobody calls */
+      if (first[component] == Profile::kNoFunction ||
+          profile_.selfCost(function, event) >
+              profile_.selfCost(first[component], event)) {
+        first[component] = function;
+      }
+      for (auto call : profile_.calls(function)) {
+        const auto callee = profile_.component(profile_.call(call).callee);
+        if (callee != component) offsets[component + 1]++;
+      }
+    }
+    std::partial_sum(begin(offsets), end(offsets), begin(offsets));
+    std::vector<Edge> edges(offsets.back());
+    auto positions = offsets;
+    for (FunctionId function = 0; function < nfunctions; ++function) {
+      const auto component = profile_.component(function);
+      for (auto call : profile_.calls(function)) {
+        const auto &edge = profile_.call(call);
+        const auto callee = profile_.component(edge.callee);
+        if (callee == component) continue;
+        called[callee] = true;
+        edges[positions[component]++] = {callee, edge.callee,
+                                         profile_.callCost(call)[event]};
+      }
+    }
+    for (size_t component = 0; component < ncomponents; ++component) {
+      const auto begin_edge = edges.begin() + offsets[component];
+      const auto end_edge = edges.begin() + offsets[component + 1];
+      std::sort(begin_edge, end_edge, [](const Edge &lhs, const Edge &rhs) {
+        return lhs.callee < rhs.callee;
+      });
+      /* summed in place, the rest is marked empty */
+      for (auto it = begin_edge; it != end_edge; ++it) {
+        auto next = it + 1;
+        while (next != end_edge && next->callee == it->callee) {
+          it->cost += next->cost;
+          next->cost = 0;
+          next->callee = Profile::kNoFunction;
+          ++next;
+        }
+        it = next - 1;
+      }
+    }
+
+    /* the costs flowing into the components nobody calls */
+    double total = 0;
+    auto inclusive = [&](size_t component) {
+      return double(profile_.inclusiveCost(first[component], event));
+    };
+    for (size_t component = 0; component < ncomponents; ++component) {
+      if (!called[component]) total += inclusive(component);
+    }
+    const auto min_flow = std::max(1.0, total * min_fraction);
+
+    struct Frame {
+      uint32_t component;
+      double flow;
+      size_t next_edge;
+      size_t path_size;
+    };
+    std::vector<Frame> frames;
+    std::string path;
+    auto enter = [&](uint32_t component, FunctionId function, double flow) {
+      const auto path_size = path.size();
+      if (!path.empty()) path += ';';
+      auto name = std::string(profile_.symbol(function));
+      std::replace(begin(name), end(name), ';', ':');
+      path += name;
+      const auto self_flow = flow * double(self[component]) /
+                             std::max(inclusive(component), 1.0);
+      if (std::llround(self_flow) > 0) {
+        os << path << ' ' << std::llround(self_flow) << '\n';
+      }
+      frames.push_back({component, flow, offsets[component], path_size});
+    };
+    for (uint32_t root = 0; root < ncomponents; ++root) {
+      if (called[root] || inclusive(root) < min_flow) continue;
+      enter(root, first[root], inclusive(root));
+      while (!frames.empty()) {
+        auto &frame = frames.back();
+        if (frame.next_edge == offsets[frame.component + 1]) {
+          path.resize(frame.path_size);
+          frames.pop_back();
+          continue;
+        }
+        const auto &edge = edges[frame.next_edge++];
+        if (edge.callee == Profile::kNoFunction) continue;
+        const auto flow = frame.flow * double(edge.cost) /
+                          std::max(inclusive(frame.component), 1.0);
+        if (flow >= min_flow) enter(edge.component, edge.callee, flow);
+      }
+    }
+  }
+
+ private:
+  const Profile &profile_;
+  /* by event, then function; the primary event is the profile order */
+  std::vector<std::unordered_map<FunctionId, std::vector<CallId> > >
+      sorted_calls_;
+  std::vector<std::unordered_map<FunctionId, std::vector<CallId> > >
+      sorted_callers_;
+};
+
+#endif  // CALLGRIND_VIEWER__CALLGRAPH_HPP_
@@ -0,0 +1,133 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "CallGraph.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+namespace {
+
+/* main calls f, f and g call each other and g calls h, which calls itself */
+struct RecursiveProfile {
+  RecursiveProfile() {
+    profile.setPositions({"line"});
+    profile.setEvents({"Ir", "Dr"});
+    auto object = profile.names().intern("a.out");
+    auto file = profile.names().intern("a.c");
+    main_function =
+        profile.addFunction(object, file, profile.names().intern("main"));
+    f = profile.addFunction(object, file, profile.names().intern("f"));
+    g = profile.addFunction(object, file, profile.names().intern("g"));
+    h = profile.addFunction(object, file, profile.names().intern("h"));
+
+    const Profile::SubPosition line[] = {1};
+    const Profile::Cost main_cost[] = {10, 1};
+    const Profile::Cost f_cost[] = {20, 2};
+    const Profile::Cost g_cost[] = {30, 3};
+    const Profile::Cost h_cost[] = {10, 1};
+    const Profile::Cost main_f[] = {60, 6};
+    const Profile::Cost f_g[] = {40, 4};
+    const Profile::Cost g_f[] = {20, 1};
+    const Profile::Cost g_h[] = {10, 5};
+    const Profile::Cost h_h[] = {4, 0};
+    profile.addCost(main_function, line, main_cost);
+    profile.addCall(main_function, f, 1, line, line, main_f);
+    profile.addCost(f, line, f_cost);
+    profile.addCall(f, g, 2, line, line, f_g);
+    profile.addCost(g, line, g_cost);
+    profile.addCall(g, f, 1, line, line, g_f);
+    profile.addCall(g, h, 1, line, line, g_h);
+    profile.addCost(h, line, h_cost);
+    profile.addCall(h, h, 3, line, line, h_h);
+    profile.finalize();
+  }
+
+  Profile profile;
+  Profile::FunctionId main_function, f, g, h;
+};
+
+}  // namespace
+
+TEST(CallGraph, Components) {
+  RecursiveProfile test;
+  const auto &profile = test.profile;
+
+  EXPECT_EQ(profile.componentCount(), 3);
+  EXPECT_EQ(profile.component(test.f), profile.component(test.g));
+  EXPECT_NE(profile.component(test.f), profile.component(test.h));
+  /* callees first */
+  EXPECT_LT(profile.component(test.h), profile.component(test.f));
+  EXPECT_LT(profile.component(test.f), profile.component(test.main_function));
+  EXPECT_FALSE(profile.recursive(test.main_function));
+  EXPECT_TRUE(profile.recursive(test.f));
+  EXPECT_TRUE(profile.recursive(test.g));
+  EXPECT_TRUE(profile.recursive(test.h));
+
+  /* the self costs of f and g and the call leaving them, the calls between
+     them are not counted again */
+  EXPECT_EQ(profile.inclusiveCost(test.f, 0), 60);
+  EXPECT_EQ(profile.inclusiveCost(test.g, 0), 60);
+  EXPECT_EQ(profile.inclusiveCost(test.h, 0), 10);
+  EXPECT_EQ(profile.inclusiveCost(test.main_function, 0), 70);
+  EXPECT_EQ(profile.inclusiveCost(test.g, 1), 10);
+}
+
+TEST(CallGraph, CallsBy) {
+  RecursiveProfile test;
+  CallGraph graph(test.profile);
+
+  const auto by_ir = graph.callsBy(test.g, 0);
+  ASSERT_EQ(by_ir.size(), 2);
+  EXPECT_EQ(test.profile.call(by_ir[0]).callee, test.f);
+
+  const auto by_dr = graph.callsBy(test.g, 1);
+  ASSERT_EQ(by_dr.size(), 2);
+  EXPECT_EQ(test.profile.call(by_dr[0]).callee, test.h);
+  EXPECT_EQ(test.profile.call(by_dr[1]).callee, test.f);
+  /* sorted once */
+  EXPECT_EQ(graph.callsBy(test.g, 1).begin(), by_dr.begin());
+
+  /* f is called by main for 60 Ir and 6 Dr, by g for 20 Ir and 1 Dr */
+  const auto f_callers = graph.callerEdgesBy(test.f, 1);
+  ASSERT_EQ(f_callers.size(), 2);
+  EXPECT_EQ(test.profile.edgeCaller(f_callers[0]), test.main_function);
+  EXPECT_EQ(test.profile.edgeCaller(f_callers[1]), test.g);
+  EXPECT_EQ(test.profile.edgeCost(f_callers[1])[1], 1);
+  EXPECT_EQ(graph.callerEdgesBy(test.f, 1).begin(), f_callers.begin());
+}
+
+TEST(CallGraph, WriteFolded) {
+  RecursiveProfile test;
+  CallGraph graph(test.profile);
+
+  std::stringstream folded;
+  graph.writeFolded(folded, 0);
+  EXPECT_EQ(folded.str(),
+            "main 10\n"
+            "main;f 50\n"
+            "main;f;h 10\n");
+
+  std::stringstream pruned;
+  graph.writeFolded(pruned, 0, 0.5);
+  EXPECT_EQ(pruned.str(),
+            "main 10\n"
+            "main;f 50\n");
+}
@@ -0,0 +1,157 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <benchmark/benchmark.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "CallgrindParser.hpp"
+#include "ProfileGenerator.hpp"
+
+namespace {
+
+/* generated files, made once and removed at exit */
+struct GeneratedFiles {
+  ~GeneratedFiles() {
+    for (const auto &path : paths) std::filesystem::remove(path);
+  }
+  std::vector<std::string> paths;
+};
+
+/* CURSEGRIND_BENCH_PROFILE names a file to parse instead of the generated
+   ones, e.g. a large one made by cursegrind_generate */
+std::string profileFile(const std::string &name,
+                        const ProfileGenerator::Options &options,
+                        bool gzip = false) {
+  if (const char *file = std::getenv("CURSEGRIND_BENCH_PROFILE")) return file;
+  static GeneratedFiles generated;
+  const auto path = (std::filesystem::temp_directory_path() / name).string();
+  if (std::find(begin(generated.paths), end(generated.paths), path) !=
+      end(generated.paths)) {
+    return path;
+  }
+  if (gzip) {
+    gzFile file = gzopen(path.c_str(), "wb");
+    if (!file) throw std::runtime_error("Cannot open " + path);
+    ProfileGenerator(options).write([file](std::string_view text) {
+      gzwrite(file, text.data(), unsigned(text.size()));
+    });
+    gzclose(file);
+  } else {
+    ProfileGenerator(options).writeFile(path);
+  }
+  generated.paths.push_back(path);
+  return path;
+}
+
+ProfileGenerator::Options defaultOptions() {
+  ProfileGenerator::Options options;
+  options.size = uint64_t(32) << 20;
+  return options;
+}
+
+void parse(benchmark::State &state, const std::string &file,
+           CallgrindParser::InputMode input_mode, unsigned int threads) {
+  for (auto _ : state) {
+    CallgrindParser parser(file);
+    parser.SetInputMode(input_mode);
+    parser.SetThreads(threads);
+    parser.parse();
+    benchmark::DoNotOptimize(parser.getProfile());
+  }
+  state.SetBytesProcessed(int64_t(state.iterations()) *
+                          int64_t(std::filesystem::file_size(file)));
+}
+
+/* tokenizing and building the profile of a memory-mapped file */
+void BM_ParseMapped(benchmark::State &state) {
+  parse(state, profileFile("cursegrind_bench.out", defaultOptions()),
+        CallgrindParser::InputMode::MemoryMapped,
+        unsigned(state.range(0)));
+}
+BENCHMARK(BM_ParseMapped)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+void BM_ParseStream(benchmark::State &state) {
+  parse(state, profileFile("cursegrind_bench.out", defaultOptions()),
+        CallgrindParser::InputMode::Stream, 1);
+}
+BENCHMARK(BM_ParseStream)->Unit(benchmark::kMillisecond);
+
+/* full names and absolute positions on every line: longer lines, no
+   compression cache lookups */
+void BM_ParseUncompressed(benchmark::State &state) {
+  auto options = defaultOptions();
+  options.compress_names = false;
+  options.compress_positions = false;
+  parse(state, profileFile("cursegrind_bench_plain.out", options),
+        CallgrindParser::InputMode::MemoryMapped, 1);
+}
+BENCHMARK(BM_ParseUncompressed)->Unit(benchmark::kMillisecond);
+
+void BM_ParseInstructions(benchmark::State &state) {
+  auto options = defaultOptions();
+  options.instructions = true;
+  parse(state, profileFile("cursegrind_bench_instr.out", options),
+        CallgrindParser::InputMode::MemoryMapped, 1);
+}
+BENCHMARK(BM_ParseInstructions)->Unit(benchmark::kMillisecond);
+
+/* the nine events of --cache-sim=yes: cost lines of many columns */
+void BM_ParseCacheSim(benchmark::State &state) {
+  auto options = defaultOptions();
+  options.events = 9;
+  parse(state, profileFile("cursegrind_bench_cache.out", options),
+        CallgrindParser::InputMode::MemoryMapped, 1);
+}
+BENCHMARK(BM_ParseCacheSim)->Unit(benchmark::kMillisecond);
+
+/* decompressed on a thread of its own while parsing, the bytes are the
+   compressed ones */
+void BM_ParseGzip(benchmark::State &state) {
+  parse(state,
+        profileFile("cursegrind_bench.out.gz", defaultOptions(), true),
+        CallgrindParser::InputMode::MemoryMapped, 1);
+}
+BENCHMARK(BM_ParseGzip)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/* many functions with few lines each: interning and function lookup
+   dominate */
+void BM_ParseManySymbols(benchmark::State &state) {
+  auto options = defaultOptions();
+  options.symbols = 500000;
+  options.files = 50000;
+  options.lines = 2;
+  options.fanout = 1;
+  parse(state, profileFile("cursegrind_bench_symbols.out", options),
+        CallgrindParser::InputMode::MemoryMapped, 1);
+}
+BENCHMARK(BM_ParseManySymbols)->Unit(benchmark::kMillisecond);
+
+}  // namespace
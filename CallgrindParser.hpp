@@ -21,107 +21,144 @@
 #ifndef CALLGRIND_VIEWER__CALLGRINDPARSER_HPP_
 #define CALLGRIND_VIEWER__CALLGRINDPARSER_HPP_
 
-#include <boost/lexical_cast.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <charconv>
+#include <chrono>
+#include <exception>
+#include <filesystem>
 #include <fstream>
+#include <future>
 #include <iostream>
 #include <memory>
 #include <optional>
-#include <regex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <unordered_set>
 #include <utility>
+#include <vector>
+
+#include "CompressedInput.hpp"
+#include "MappedFile.hpp"
+#include "NameTable.hpp"
+#include "ParseStats.hpp"
+#include "Profile.hpp"
+#include "ProfileCache.hpp"
+#include "Span.hpp"
+#include "ThreadPool.hpp"
 
 class CallgrindParser {
  public:
   using SubPosition = uint64_t;
   using Cost = uint64_t;
+  using NameId = NameTable::NameId;
+  using FunctionId = Profile::FunctionId;
+  using PositionId = FunctionId;
 
   enum class PositionType : std::size_t { Cost = 0, Call = 1, FiFe = 2 };
 
+  enum class InputMode { Stream, MemoryMapped };
+
+  struct Progress {
+    uint64_t bytes_read;
+    uint64_t total_bytes;
+    uint64_t lines;
+    uint64_t entries;
+  };
+
+  /* name is only valid until the next line is read, value is interned */
   struct PositionSpec {
-    PositionSpec(std::string name, std::string value)
-        : name(std::move(name)), value(std::move(value)) {}
-    std::string name;
-    std::string value;
+    PositionSpec(std::string_view name, std::string_view value, NameId id)
+        : name(name), value(value), id(id) {}
+    std::string_view name;
+    std::string_view value;
+    NameId id;
   };
 
+  /* views into the parser line buffers, valid until the next line of the
+     same kind is parsed; the Profile copies them into its row storage */
   struct CostSpec {
-    CostSpec(std::vector<SubPosition> sub_positions, std::vector<Cost> costs)
-        : sub_positions(std::move(sub_positions)), costs(std::move(costs)) {}
-    std::vector<SubPosition> sub_positions;
-    std::vector<Cost> costs;
+    CostSpec(Span<const SubPosition> sub_positions, Span<const Cost> costs)
+        : sub_positions(sub_positions), costs(costs) {}
+    Span<const SubPosition> sub_positions;
+    Span<const Cost> costs;
   };
 
   struct CallSpec {
-    CallSpec(unsigned int ncalls, const std::vector<SubPosition> &sub_positions)
+    CallSpec(uint64_t ncalls, Span<const SubPosition> sub_positions)
         : ncalls(ncalls), sub_positions(sub_positions) {}
-    unsigned int ncalls;
-    std::vector<SubPosition> sub_positions;
+    uint64_t ncalls;
+    Span<const SubPosition> sub_positions;
   };
 
+  /* Legacy object graph built on demand from the Profile by getEntries(),
+     cost specs point into the rows of the profile */
+
   struct Entry;
   using EntryPtr = std::shared_ptr<Entry>;
 
   struct Call {
-    Call(unsigned int ncalls, std::vector<SubPosition> sub_positions,
+    Call(uint64_t ncalls, Span<const SubPosition> sub_positions,
          std::shared_ptr<Entry> entry)
         : ncalls(ncalls),
-          sub_positions(std::move(sub_positions)),
+          sub_positions(sub_positions),
           entry(std::move(entry)) {}
 
-    unsigned int ncalls;
-    std::vector<SubPosition> sub_positions;
+    uint64_t ncalls;
+    Span<const SubPosition> sub_positions;
     std::vector<CostSpec> costs;
     std::shared_ptr<Entry> entry;
+    std::vector<Cost> inclusive_cost;
 
-    void addCost(const CostSpec &spec) { costs.emplace_back(spec); }
-    std::vector<Cost> totalCosts() const {
-      std::vector<Cost> result;
-      for (auto &cost_spec : costs) {
-        if (result.empty()) {
-          result = cost_spec.costs;
-          continue;
-        }
-        for (int i = 0; i < cost_spec.costs.size(); ++i) {
-          result[i] += cost_spec.costs[i];
-        }
-      }
-      return result;
-    }
+    void addCost(CostSpec &&spec) { costs.emplace_back(std::move(spec)); }
+    const std::vector<Cost> &totalCosts() const { return inclusive_cost; }
   };
 
-  struct Position {
-    /* object */
-    std::string binary;
-    /* filename */
-    std::string source;
-    /* function name */
-    std::string symbol;
+  /* (ob, fl, fn) as interned name ids */
+  struct PositionKey {
+    NameId binary{NameTable::kEmpty};
+    NameId source{NameTable::kEmpty};
+    NameId symbol{NameTable::kEmpty};
 
-    Position &operator=(const Position &other) = delete;
     void setPosition(const PositionSpec &spec) {
       if (spec.name == "ob") {
-        binary = spec.value;
+        binary = spec.id;
       } else if (spec.name == "fl") {
-        source = spec.value;
+        source = spec.id;
       } else if (spec.name == "fn") {
-        symbol = spec.value;
+        symbol = spec.id;
       } else if (spec.name == "fi") {
-        source = spec.value;
+        source = spec.id;
       } else if (spec.name == "fe") {
-        source = spec.value;
+        source = spec.id;
       } else {
-        throw std::runtime_error("Unknown spec: " + spec.name);
+        throw std::runtime_error("Unknown spec: " + std::string(spec.name));
       }
     }
+  };
+
+  /* unique (ob, fl, fn), names point into the profile name table */
+  struct Position {
+    PositionId id;
+    /* object */
+    std::string_view binary;
+    /* filename */
+    std::string_view source;
+    /* function name */
+    std::string_view symbol;
+
+    Position &operator=(const Position &other) = delete;
     friend std::ostream &operator<<(std::ostream &os,
                                     const Position &position) {
       os << "fl: " << position.source << " fn: " << position.symbol;
       return os;
     }
 
-    bool operator==(const Position &rhs) const {
-      return symbol == rhs.symbol && binary == rhs.binary &&
-             source == rhs.source;
-    }
+    bool operator==(const Position &rhs) const { return id == rhs.id; }
     bool operator!=(const Position &rhs) const { return !(rhs == *this); }
   };
 
@@ -130,400 +167,1506 @@ class CallgrindParser {
     std::vector<CostSpec> costs;
     std::vector<Call> calls;
     std::vector<std::weak_ptr<Entry> > callers;
+    std::vector<Cost> self_cost;
+    std::vector<Cost> inclusive_cost;
+
+    void addCost(CostSpec &&spec) { costs.emplace_back(std::move(spec)); }
+    void addCall(Call &&call) { calls.emplace_back(std::move(call)); }
+    const std::vector<Cost> &selfCost() const { return self_cost; }
+    const std::vector<Cost> &totalCost() const { return inclusive_cost; }
+  };
 
-    void addCost(const CostSpec &spec) { costs.emplace_back(spec); }
-    void addCall(Call &&call) { calls.emplace_back(call); }
-    std::vector<Cost> totalCost() const {
-      std::vector<Cost> result;
-      for (size_t ic = 0; ic < costs[0].costs.size(); ++ic) {
-        Cost sum = 0;
-        for (const auto &cost : costs) {
-          sum += cost.costs[ic];
+  explicit CallgrindParser(std::string filename)
+      : filename(std::move(filename)) {}
+  /* several dumps, e.g. the threads of a --separate-threads=yes run, are
+     parsed in parallel and merged into one profile */
+  explicit CallgrindParser(std::vector<std::string> filenames)
+      : filenames_(std::move(filenames)) {
+    if (filenames_.empty()) throw std::runtime_error("No input files");
+    filename = filenames_.front();
+    if (filenames_.size() == 1) filenames_.clear();
+  }
+
+  void parse() {
+    stats_ = ParseStats();
+    stats_.threads = threads_;
+    stats_.start(ParseStats::kParse);
+    timing_ = true;
+    try {
+      parseProfile();
+    } catch (...) {
+      timing_ = false;
+      throw;
+    }
+    timing_ = false;
+    stats_.bytes = total_bytes_;
+    stats_.lines = current_line_number_;
+    stats_.entries = entries_parsed_;
+    stats_.functions = profile_->functionCount();
+    stats_.calls = profile_->callCount();
+    stats_.names = profile_->names().size();
+    stats_.cost_rows = profile_->costRowCount();
+    stats_.stop();
+    std::atomic_store(&published_stats_,
+                      std::make_shared<const ParseStats>(stats_));
+  }
+
+ private:
+  void parseProfile() {
+    reset();
+    if (follow_) findDumps();
+    std::optional<ProfileCache::SourceKey> source_key;
+    if (!filenames_.empty()) {
+      parseFiles();
+    } else if (!filename.empty()) {
+      if (cache_ && !follow_) source_key = ProfileCache::sourceKey(filename);
+      if (source_key && loadCache(*source_key)) return;
+      parseFile();
+      if (follow_) {
+        follow(filename, total_bytes_, total_bytes_,
+               CompressedInput::detect(filename) ==
+                   CompressedInput::Compression::None);
+      }
+    }
+
+    updateProgress(total_bytes_);
+    if (follow_) {
+      /* the profile keeps growing, the view gets copies of it */
+      takeSnapshot();
+    } else {
+      profile_->finalize(timing(), sort_entries_);
+      std::atomic_store(&snapshot_, std::shared_ptr<const Profile>(profile_));
+    }
+
+    /* a cache always has its entries sorted */
+    if (source_key && sort_entries_) {
+      ParseStats::Scope cache(timing(), ParseStats::kCache);
+      const auto cache_path = ProfileCache::cachePath(filename);
+      if (!ProfileCache::writable(cache_path)) {
+        /* a read-only directory just goes without the cache */
+        stats_.cache = "not writable";
+      } else {
+        stats_.cache = ProfileCache::save(*profile_, cache_path, *source_key,
+                                          current_line_number_)
+                           ? "written"
+                           : "failed";
+      }
+    }
+  }
+
+  void parseFile() {
+    if (const auto compression = CompressedInput::detect(filename);
+        compression != CompressedInput::Compression::None) {
+      parseCompressed(compression);
+    } else if (MappedFile mapped_file;
+               input_mode_ == InputMode::MemoryMapped &&
+               mapInput(mapped_file)) {
+      auto text = mapped_file.view();
+      /* a followed file is parsed up to where appending goes on */
+      if (follow_) text = text.substr(0, mergeableEnd(text));
+      total_bytes_ = text.size();
+      bool parsed = false;
+      if (threads_ > 1 && text.size() >= 2 * chunk_size_) {
+        try {
+          parseParallel(text);
+          parsed = true;
+        } catch (const std::exception &) {
+          if (*cancel_) throw;
+          /* the sequential parser reports the error at its actual line */
+          reset();
+        }
+      }
+      if (!parsed) parseText(text);
+    } else {
+      std::ifstream ifs(filename);
+      std::error_code error;
+      const auto file_size = std::filesystem::file_size(filename, error);
+      total_bytes_ = error ? 0 : file_size;
+      std::string buffer;
+      uint64_t bytes_read = 0;
+      while (std::getline(ifs, buffer)) {
+        current_line_number_++;
+        bytes_read += buffer.size() + 1;
+        handleLine(buffer);
+        if (current_line_number_ % kProgressLines == 0) {
+          updateProgress(bytes_read);
         }
-        for (const auto &call : calls) {
-          for (const auto &call_cost : call.costs) {
-            sum += call_cost.costs[ic];
+      }
+    }
+    finishText();
+  }
+
+  ParseStats *timing() { return timing_ ? &stats_ : nullptr; }
+
+  bool mapInput(MappedFile &mapped_file) {
+    ParseStats::Scope read(timing(), ParseStats::kRead);
+    return mapped_file.map(filename);
+  }
+
+  /* Every file is parsed on the pool by a parser of its own, which uses
+     the cache of the file; the profiles are merged in the order of the
+     files as soon as they are parsed. */
+  void parseFiles() {
+    std::vector<std::unique_ptr<CallgrindParser> > parsers;
+    for (const auto &file : filenames_) {
+      std::error_code error;
+      const auto file_size = std::filesystem::file_size(file, error);
+      total_bytes_ += error ? 0 : file_size;
+      auto &parser = parsers.emplace_back(new CallgrindParser(file));
+      parser->SetInputMode(input_mode_);
+      parser->SetCache(cache_ && !follow_);
+      parser->SetChunkSize(chunk_size_);
+      /* the threads left over by the files split the big ones */
+      parser->SetThreads(unsigned(threads_ / filenames_.size()));
+      parser->cancel_ = cancel_;
+    }
+
+    std::exception_ptr error;
+    {
+      ThreadPool pool(std::min<size_t>(threads_, parsers.size()));
+      std::atomic<bool> failed{false};
+      std::vector<std::future<void> > parsed;
+      for (auto &parser : parsers) {
+        parsed.push_back(pool.submit([&parser, &failed] {
+          if (!failed) parser->parse();
+        }));
+      }
+
+      uint64_t merged_bytes = 0;
+      for (size_t ifile = 0; ifile < parsers.size() && !error; ++ifile) {
+        try {
+          while (parsed[ifile].wait_for(kFilesProgressInterval) !=
+                 std::future_status::ready) {
+            /* the files being parsed */
+            uint64_t bytes = merged_bytes;
+            for (size_t iparsing = ifile; iparsing < parsers.size();
+                 ++iparsing) {
+              bytes += parsers[iparsing]->progress().bytes_read;
+            }
+            publishProgress(bytes);
           }
+          parsed[ifile].get();
+          const auto file_bytes = parsers[ifile]->progress().total_bytes;
+          merged_bytes += file_bytes;
+          mergeFile(*parsers[ifile], ifile == 0);
+          if (follow_) {
+            follow(filenames_[ifile], file_bytes, file_bytes, false);
+          }
+          parsers[ifile].reset();
+          publishProgress(merged_bytes);
+          if (snapshotDue()) takeSnapshot();
+        } catch (...) {
+          error = std::current_exception();
+          failed = true;
         }
-        result.push_back(sum);
       }
-      return result;
     }
-  };
+    if (error) std::rethrow_exception(error);
+  }
 
-  explicit CallgrindParser(std::string filename)
-      : filename(std::move(filename)) {}
+  /* the first file defines the positions and events of all */
+  void mergeFile(const CallgrindParser &parser, bool first) {
+    ParseStats::Scope merge(timing(), ParseStats::kMerge);
+    const auto &file_profile = *parser.profile_;
+    if (first) {
+      positions_def = parser.positions_def;
+      events_def = parser.events_def;
+      profile_->setPositions(positions_def);
+      profile_->setEvents(events_def);
+    } else if (parser.positions_def != positions_def ||
+               parser.events_def != events_def) {
+      throw std::runtime_error("Positions or events of " + parser.filename +
+                               " differ from " + filename);
+    }
 
-  void parse() {
-    auto get_position_from_cache =
-        [this](const Position &position) -> std::shared_ptr<Position> {
-      auto cached_position = std::find_if(
-          begin(this->positions_cache_), end(this->positions_cache_),
-          [&position](const auto &p) { return *p == position; });
-
-      if (cached_position == end(positions_cache_)) {
-        auto new_cache_entry = std::make_shared<Position>(position);
-        this->positions_cache_.emplace_back(new_cache_entry);
-        return new_cache_entry;
+    const auto &file_names = file_profile.names();
+    std::vector<NameId> name_ids(file_names.size(), NameTable::kEmpty);
+    for (NameId id = 1; id < file_names.size(); ++id) {
+      name_ids[id] = profile_->names().intern(file_names[id]);
+    }
+    /* the objects of each file are told apart by a label, so are their
+       functions */
+    std::vector<NameId> object_ids;
+    if (keep_parts_) {
+      const auto label =
+          " [" +
+          (parser.thread_.empty()
+               ? std::filesystem::path(parser.filename).filename().string()
+               : "thread " + parser.thread_) +
+          "]";
+      object_ids.resize(file_names.size());
+      for (NameId id = 0; id < file_names.size(); ++id) {
+        object_ids[id] =
+            profile_->names().intern(std::string(file_names[id]) + label);
       }
+    }
+
+    const auto rows = profile_->appendPart(file_profile, name_ids,
+                                           keep_parts_ ? &object_ids : nullptr);
+    /* the rows of a parsed file are absolute */
+    profile_->copyPartRows(rows,
+                           std::vector<SubPosition>(positions_def.size(), 0),
+                           {}, {}, {});
+    current_line_number_ += parser.current_line_number_;
+    entries_parsed_ += parser.entries_parsed_;
+    mergeHeaders(parser);
+  }
+
+  void mergeHeaders(const CallgrindParser &other) {
+    parts_ += other.parts_;
+    if (thread_.empty()) thread_ = other.thread_;
+    addCosts(summary_, other.summary_);
+    addCosts(totals_, other.totals_);
+  }
+
+  /* a file of the followed run: the bytes merged so far and its size at the
+     previous update() */
+  struct FollowedFile {
+    std::string path;
+    uint64_t merged;
+    uint64_t size;
+    /* the file parsed by this parser itself, whose state goes on into the
+       bytes appended to it */
+    bool appendable;
+  };
 
-      return *cached_position;
+  /* callgrind.out.<pid>[.<part>][-<thread>]: the dumps of one run share the
+     name up to the pid */
+  static std::string dumpPrefix(std::string name) {
+    auto strip_number = [](std::string &text, char separator) {
+      const auto pos = text.find_last_not_of("0123456789");
+      if (pos == std::string::npos || pos + 1 == text.size() ||
+          text[pos] != separator) {
+        return false;
+      }
+      text.resize(pos);
+      return true;
     };
+    if (auto rest = name; strip_number(rest, '-')) name = rest;
+    if (auto rest = name; strip_number(rest, '.')) {
+      if (auto pid = rest; strip_number(pid, '.')) name = rest;
+    }
+    return name;
+  }
+
+  bool isDump(const std::string &name) const {
+    return startsWith(name, dump_prefix_) &&
+           name.find_first_not_of("0123456789.-", dump_prefix_.size()) ==
+               std::string::npos;
+  }
+
+  static std::string followKey(const std::string &path) {
+    std::error_code error;
+    const auto absolute = std::filesystem::absolute(path, error);
+    return (error ? std::filesystem::path(path) : absolute)
+        .lexically_normal()
+        .string();
+  }
+
+  void follow(const std::string &path, uint64_t merged, uint64_t size,
+              bool appendable) {
+    followed_.push_back({path, merged, size, appendable});
+    followed_keys_.insert(followKey(path));
+  }
+
+  /* the dumps in the followed directory not followed yet, in name order */
+  std::vector<std::string> newDumps() const {
+    std::vector<std::string> dumps;
+    std::error_code error;
+    for (std::filesystem::directory_iterator it(follow_directory_, error), end;
+         !error && it != end; it.increment(error)) {
+      const auto &path = it->path();
+      if (isDump(path.filename().string()) &&
+          followed_keys_.count(followKey(path.string())) == 0) {
+        dumps.push_back(path.string());
+      }
+    }
+    std::sort(begin(dumps), end(dumps));
+    return dumps;
+  }
+
+  /* A directory is followed for the dumps in it, a file or the files given
+     for the dumps of the same run next to the first one. The dumps of a
+     directory are listed anew when parse() starts over. */
+  void findDumps() {
+    followed_.clear();
+    followed_keys_.clear();
+    if (follow_directory_.empty()) {
+      std::error_code error;
+      const auto &first = filenames_.empty() ? filename : filenames_.front();
+      const std::filesystem::path path(first);
+      if (std::filesystem::is_directory(path, error)) {
+        follows_directory_ = true;
+        follow_directory_ = first;
+        dump_prefix_ = "callgrind.out";
+      } else {
+        follow_directory_ =
+            path.has_parent_path() ? path.parent_path().string() : ".";
+        dump_prefix_ = dumpPrefix(path.filename().string());
+      }
+    }
+    if (!follows_directory_) return;
+    filenames_ = newDumps();
+    filename = filenames_.size() == 1 ? filenames_.front() : std::string();
+    if (filenames_.size() == 1) filenames_.clear();
+  }
+
+  /* a dump found later is parsed by a parser of its own and merged as one
+     of several files */
+  void mergeDump(FollowedFile &file) {
+    CallgrindParser parser(file.path);
+    parser.SetInputMode(input_mode_);
+    parser.SetThreads(threads_);
+    parser.SetChunkSize(chunk_size_);
+    parser.cancel_ = cancel_;
+    parser.parse();
+    mergeFile(parser, events_def.empty());
+    file.merged = parser.total_bytes_;
+    total_bytes_ += parser.total_bytes_;
+  }
+
+  /* the bytes appended to the file go on from the state its parse ended
+     in, so they are parsed like the next chunk of it, which continues the
+     entry the file ended in; returns false if nothing can be merged yet */
+  bool mergeAppended(FollowedFile &file) {
+    MappedFile mapped_file;
+    if (!mapped_file.map(file.path)) return false;
+    auto text = mapped_file.view();
+    if (text.size() <= file.merged) return false;
+    text.remove_prefix(file.merged);
+    text = text.substr(0, mergeableEnd(text));
+    if (text.empty()) return false;
+
+    CallgrindParser chunk(ChunkTag{}, *this);
+    if (ended_in_ == State::EntryCosts) chunk.resumeEntry();
+    chunk.parseText(text);
+    chunk.finishText();
+    const auto job = mergeChunk(chunk);
+    profile_->copyPartRows(job.rows, job.base, chunk.cost_fixups_,
+                           chunk.call_fixups_, chunk.target_fixups_);
+    finishText();
+    file.merged += text.size();
+    total_bytes_ += text.size();
+    return true;
+  }
+
+  static void addCosts(std::vector<Cost> &costs, const std::vector<Cost> &add) {
+    if (costs.size() < add.size()) costs.resize(add.size(), 0);
+    for (size_t ic = 0; ic < add.size(); ++ic) costs[ic] += add[ic];
+  }
+
+  /* part: thread: summary: totals:, the other header lines are ignored */
+  void handleHeaderLine(std::string_view line) {
+    const auto colon = line.find(':');
+    if (colon == std::string_view::npos) return;
+    const auto key = line.substr(0, colon);
+    auto value = line.substr(colon + 1);
+    if (key == "part") {
+      ++parts_;
+    } else if (key == "thread") {
+      thread_ = std::string(nextToken(value));
+    } else if (key == "summary" || key == "totals") {
+      std::vector<Cost> costs;
+      for (auto token = nextToken(value); !token.empty();
+           token = nextToken(value)) {
+        const auto cost = parseNumber<Cost>(token);
+        if (!cost) return;
+        costs.push_back(*cost);
+      }
+      addCosts(key == "summary" ? summary_ : totals_, costs);
+    }
+  }
+
+  /* Entry := PositionLine+ CostLine (CostLine | FiFeLine | Call)* EmptyLine
+     Call := CallPositionLine+ CallLine CostLine */
+  enum class State {
+    None,
+    EntryPositions,
+    EntryCosts,
+    CallPositions,
+    CallCost
+  };
+
+  /* kinds of compressed names, also the fields of PositionKey */
+  enum class NameKind { Object, File, Symbol };
+
+  /* a name a chunk cannot resolve on its own: a "(id)" reference to a name
+     defined in an earlier chunk, or ob/fl/fn carried over from it */
+  struct UnresolvedName {
+    bool inherited;
+    NameKind kind;
+    unsigned int compression_index;
+  };
+
+  /* a relative sub-position at the start of a chunk, the base it is
+     relative to is known only when the previous chunk is merged */
+  using SubPositionFixup = Profile::RowFixup;
+
+  struct ChunkTag {};
+
+  /* parser for a part of the body after the header parsed by the parent,
+     it fills its own profile which is merged into the parent's one */
+  CallgrindParser(ChunkTag, const CallgrindParser &parent)
+      : events_def(parent.events_def),
+        positions_def(parent.positions_def),
+        chunk_mode_(true),
+        cancel_(parent.cancel_) {
+    profile_->setPositions(positions_def);
+    profile_->setEvents(events_def);
+    current_subposition.assign(positions_def.size(), 0);
+    subposition_known_.assign(positions_def.size(), false);
+    resizeLineBuffers();
+    current_position_.binary = unresolvedName({true, NameKind::Object, 0});
+    current_position_.source = unresolvedName({true, NameKind::File, 0});
+    current_position_.symbol = unresolvedName({true, NameKind::Symbol, 0});
+  }
+
+  /* the chunk goes on with the entry its parent ended in, whose function
+     has the names the chunk inherits */
+  void resumeEntry() {
+    state_ = State::EntryCosts;
+    current_function_ = profile_->addFunction(current_position_.binary,
+                                              current_position_.source,
+                                              current_position_.symbol);
+  }
+
+  /* the end of the text of a followed file that can be merged now: its
+     complete lines, without the entry header or call at the end that the
+     cost line following it has not been appended to yet; these are merged
+     with the rest of their lines */
+  static size_t mergeableEnd(std::string_view text) {
+    auto end = text.rfind('\n');
+    if (end == std::string_view::npos) return 0;
+    ++end;
+    while (end > 0) {
+      const auto previous = end > 1 ? text.rfind('\n', end - 2)
+                                    : std::string_view::npos;
+      const auto start = previous == std::string_view::npos ? 0 : previous + 1;
+      switch (classifyLine(text.substr(start, end - 1 - start))) {
+        case LineType::Position:
+        case LineType::FiFe:
+        case LineType::CallPosition:
+        case LineType::Calls:
+          end = start;
+          continue;
+        default:
+          return end;
+      }
+    }
+    return end;
+  }
+
+  bool loadCache(const ProfileCache::SourceKey &source_key) {
+    ParseStats::Scope cache(timing(), ParseStats::kCache);
+    uint64_t lines = 0;
+    auto cached = ProfileCache::load(ProfileCache::cachePath(filename),
+                                     source_key, &lines);
+    if (!cached) return false;
+    profile_ = std::move(cached);
+    current_line_number_ = lines;
+    entries_parsed_ = profile_->entries().size();
+    total_bytes_ = source_key.size;
+    updateProgress(source_key.size);
+    std::atomic_store(&snapshot_, std::shared_ptr<const Profile>(profile_));
+    stats_.cache = "loaded";
+    return true;
+  }
+
+  void reset() {
+    profile_ = std::make_shared<Profile>();
+    std::atomic_store(&snapshot_, std::shared_ptr<const Profile>());
+    entries_profile_.reset();
+    entries_.clear();
 
     /* positions: [instr] [line]
     For cost lines, this defines the semantic of the first numbers. Any
     combination of "instr", "bb" and "line" is allowed, but has to be in this
     order which corresponds to position numbers at the start of the cost lines
-    later in the file. */
-    static const std::regex re_positions_def(
-        "^positions:\\s+(instr|line\\s*)+$");
-
-    static const std::regex re_events_def(R"(^events:\s+(\w+\s*)+$)");
-
-    std::ifstream ifs(filename);
-    std::string line;
-    unsigned int current_line_number = 0;
-    auto getline = [&ifs, &line, &current_line_number]() -> bool {
-      auto is_eof = !bool(std::getline(ifs, line));
-      if (!is_eof) {
-        current_line_number++;
+    later in the file. If the line is missing, "line" is assumed. */
+    positions_def = {"line"};
+    events_def.clear();
+    parts_ = 0;
+    thread_.clear();
+    summary_.clear();
+    totals_.clear();
+    current_subposition.assign(positions_def.size(), 0);
+    profile_->setPositions(positions_def);
+    resizeLineBuffers();
+
+    file_compression_cache_.clear();
+    symbol_compression_cache_.clear();
+    object_compression_cache_.clear();
+
+    state_ = State::None;
+    ended_in_ = State::None;
+    current_position_ = {};
+    call_position_ = {};
+    current_function_ = Profile::kNoFunction;
+    callee_ = Profile::kNoFunction;
+    call_.reset();
+    current_line_number_ = 0;
+    entries_parsed_ = 0;
+    next_snapshot_ = std::chrono::steady_clock::now() + kSnapshotInterval;
+    updateProgress(0);
+  }
+
+  void parseText(std::string_view text) {
+    MappedFile::forEachLine(text, [this, text](std::string_view line) {
+      current_line_number_++;
+      handleLine(line);
+      if (current_line_number_ % kProgressLines == 0) {
+        updateProgress(line.data() + line.size() - text.data());
       }
-      return !is_eof;
+    });
+  }
+
+  /* publishes the counters, checks for cancellation and takes a snapshot
+     now and then; the interval grows with the time a snapshot takes, so they
+     cost a bounded share of the parse time */
+  void updateProgress(uint64_t bytes_read) {
+    publishProgress(bytes_read);
+    if (snapshotDue()) takeSnapshot();
+  }
+
+  void publishProgress(uint64_t bytes_read) {
+    bytes_read_ = bytes_read;
+    lines_parsed_ = current_line_number_;
+    entries_published_ = entries_parsed_;
+    if (*cancel_) {
+      throw std::runtime_error("Parsing cancelled");
+    }
+  }
+
+  bool snapshotDue() const {
+    return snapshots_ && std::chrono::steady_clock::now() >= next_snapshot_;
+  }
+
+  void takeSnapshot() {
+    ParseStats::Scope snapshot(timing(), ParseStats::kSnapshot);
+    const auto start = std::chrono::steady_clock::now();
+    std::atomic_store(&snapshot_,
+                      std::shared_ptr<const Profile>(profile_->snapshot()));
+    const auto spent = std::chrono::steady_clock::now() - start;
+    next_snapshot_ = start + std::max<std::chrono::steady_clock::duration>(
+                                 kSnapshotInterval, 4 * spent);
+  }
+
+  /* decompression runs ahead on its own thread, progress is in compressed
+     bytes */
+  void parseCompressed(CompressedInput::Compression compression) {
+    std::error_code error;
+    const auto file_size = std::filesystem::file_size(filename, error);
+    total_bytes_ = error ? 0 : file_size;
+    CompressedInput input(filename, compression);
+    CompressedInput::Block block;
+    auto next_block = [this, &input, &block] {
+      ParseStats::Scope read(timing(), ParseStats::kRead);
+      return input.next(block);
     };
+    while (next_block()) {
+      MappedFile::forEachLine(block.text, [this](std::string_view line) {
+        current_line_number_++;
+        handleLine(line);
+      });
+      updateProgress(block.input_end);
+    }
+  }
 
-    Position current_position;
-
-    while (getline()) {
-      std::smatch match_results;
-      /* POSITION */
-      if (std::optional<PositionSpec> cost_position;
-          bool(cost_position = parsePositionLine(line, PositionType::Cost))) {
-        /* setup new event */
-        if (verbose_) std::cout << "Begin entry" << std::endl;
-        auto new_entry = std::make_shared<Entry>();
-        /* populating position */
-        {
-          current_position.setPosition(*cost_position);
-          while (getline() && (cost_position = parsePositionLine(
-                                   line, PositionType::Cost))) {
-            current_position.setPosition(*cost_position);
-          }
-          new_entry->position = get_position_from_cache(current_position);
+  /* end of file terminates the last entry as an empty line does */
+  void finishText() {
+    ended_in_ = state_;
+    if (state_ != State::None) {
+      handleLine({});
+    }
+  }
+
+  void handleLine(std::string_view line) {
+    /* every (ob, fl, fn) is one function: repeated "fn=" blocks of a
+       function are merged and calls are linked by id */
+    auto get_function = [this](const PositionKey &key) {
+      return profile_->addFunction(key.binary, key.source, key.symbol);
+    };
+
+    const auto line_type = classifyLine(line);
+    switch (state_) {
+      case State::None:
+        if (line_type == LineType::Position || line_type == LineType::FiFe) {
+          /* setup new event */
+          entries_parsed_++;
+          current_position_.setPosition(
+              *parsePositionLine(line, PositionType::Cost));
+          state_ = State::EntryPositions;
+        } else if (line_type == LineType::PositionsDef) {
+          /* the parts of a file may repeat the header */
+          if (parseDefinitionLine(line, definition_) == positions_def) return;
+          checkDefinitionAllowed();
+          positions_def = definition_;
+          current_subposition.assign(positions_def.size(), 0);
+          profile_->setPositions(positions_def);
+          resizeLineBuffers();
+        } else if (line_type == LineType::EventsDef) {
+          if (parseDefinitionLine(line, definition_) == events_def) return;
+          checkDefinitionAllowed();
+          events_def = definition_;
+          profile_->setEvents(events_def);
+          resizeLineBuffers();
+        } else if (line_type == LineType::Other) {
+          handleHeaderLine(line);
         }
-        /* line = CostSpec */
-        /* now parsing costs */
-        {
-          auto cost_spec = parseCostLine(line);
-          if (!cost_spec) {
-            throw std::runtime_error("Expected cost spec at " +
-                                     std::to_string(current_line_number));
-          }
-          new_entry->addCost(*cost_spec);
-          while (getline()) {
-            if ((cost_spec = parseCostLine(line))) {
-              new_entry->addCost(*cost_spec);
-            } else if (parsePositionLine(line, PositionType::FiFe)) {
-              if (verbose_) std::cout << "Ignore fife" << std::endl;
-            } else {
-              break;
-            }
-          }
+        return;
+      case State::EntryPositions:
+        if (line_type == LineType::Position || line_type == LineType::FiFe) {
+          current_position_.setPosition(
+              *parsePositionLine(line, PositionType::Cost));
+          return;
         }
-        while (true) {
-          /* here line is call position spec or endline */
-          Position call_position = current_position;
-          if (std::optional<PositionSpec> call_position_spec;
-              bool(call_position_spec =
-                       parsePositionLine(line, PositionType::Call))) {
-            if (verbose_) std::cout << "Begin call" << std::endl;
-            auto call_entry = std::make_shared<Entry>();
-            call_position.setPosition(*call_position_spec);
-            while (getline() && (call_position_spec = parsePositionLine(
-                                     line, PositionType::Call))) {
-              call_position.setPosition(*call_position_spec);
-            }
-            call_entry->position = get_position_from_cache(call_position);
-            /* here line is call line */
-            auto call_line = parseCallLine(line);
-            if (!call_line) {
-              throw std::runtime_error("Expected call line at " +
-                                       std::to_string(current_line_number));
-            }
-            Call call(call_line->ncalls, call_line->sub_positions, call_entry);
-            {
-              /* we expect cost line after */
-              getline();
-              auto cost_spec = parseCostLine(line);
-              if (!cost_spec) {
-                throw std::runtime_error("Expected cost line after call at " +
-                                         std::to_string(current_line_number));
-              }
-              call.addCost(*cost_spec);
-              while (getline()) {
-                if ((cost_spec = parseCostLine(line))) {
-                  call.addCost(*cost_spec);
-                }
-                /* fi/fe= */
-                else if (parsePositionLine(line, PositionType::FiFe)) {
-                  if (verbose_) std::cout << "Ignore fife" << std::endl;
-                } else {
-                  break;
-                }
-              }
-            }
-            assert(!call.costs.empty());
-            /* now we ready to add new call */
-            new_entry->addCall(std::move(call));
-            /* now line should be empty */
-          } else if (parseEmptyLine(line)) {
-            break;
-          } else {
-            throw std::runtime_error("Unexpected not empty line");
+        current_function_ = get_function(current_position_);
+        if (std::optional<CostSpec> cost_spec;
+            line_type == LineType::Cost &&
+            bool(cost_spec = parseCostLine(line))) {
+          addFixups(cost_fixups_, addCost(current_function_, *cost_spec),
+                    cost_fixup_indices_);
+          state_ = State::EntryCosts;
+          return;
+        }
+        throw std::runtime_error("Expected cost spec at " +
+                                 std::to_string(current_line_number_));
+      case State::EntryCosts:
+        if (line_type == LineType::Cost) {
+          if (auto cost_spec = parseCostLine(line)) {
+            addFixups(cost_fixups_, addCost(current_function_, *cost_spec),
+                      cost_fixup_indices_);
+            return;
           }
+        } else if (line_type == LineType::FiFe) {
+          /* still has to be parsed to keep the compression cache complete */
+          parsePositionLine(line, PositionType::FiFe);
+          return;
+        } else if (line_type == LineType::CallPosition) {
+          call_position_ = current_position_;
+          call_position_.setPosition(
+              *parsePositionLine(line, PositionType::Call));
+          state_ = State::CallPositions;
+          return;
+        } else if (line_type == LineType::Empty) {
+          current_function_ = Profile::kNoFunction;
+          state_ = State::None;
+          return;
+        }
+        throw std::runtime_error("Unexpected not empty line");
+      case State::CallPositions:
+        if (line_type == LineType::CallPosition) {
+          call_position_.setPosition(
+              *parsePositionLine(line, PositionType::Call));
+          return;
+        }
+        if (line_type == LineType::Calls && bool(call_ = parseCallLine(line))) {
+          callee_ = get_function(call_position_);
+          state_ = State::CallCost;
+          return;
+        }
+        throw std::runtime_error("Expected call line at " +
+                                 std::to_string(current_line_number_));
+      case State::CallCost:
+        /* exactly one cost line with the inclusive cost follows the call
+           line, subsequent cost lines belong to the entry itself */
+        if (std::optional<CostSpec> cost_spec;
+            line_type == LineType::Cost &&
+            bool(cost_spec = parseCostLine(line))) {
+          /* now we ready to add new call */
+          const auto call_id = profile_->addCall(
+              current_function_, callee_, call_->ncalls,
+              call_->sub_positions.data(), cost_spec->sub_positions.data(),
+              cost_spec->costs.data());
+          addFixups(call_fixups_, call_id, cost_fixup_indices_);
+          addFixups(target_fixups_, call_id, call_fixup_indices_);
+          call_.reset();
+          state_ = State::EntryCosts;
+          return;
+        }
+        throw std::runtime_error("Expected cost line after call at " +
+                                 std::to_string(current_line_number_));
+    }
+  }
 
-        }  // while (true)
+  /* Chunks are split at empty lines, where no entry is open. Each one is
+     parsed by its own parser into its own profile; names and sub-positions
+     a chunk takes from the preceding ones are resolved when the chunks are
+     merged in file order. */
+  void parseParallel(std::string_view text) {
+    /* the header up to the first entry defines positions and events for
+       all chunks */
+    auto body = text;
+    while (!body.empty()) {
+      const auto eol = body.find('\n');
+      const auto line = body.substr(0, eol);
+      const auto line_type = classifyLine(line);
+      if (line_type == LineType::Position || line_type == LineType::FiFe) {
+        break;
+      }
+      current_line_number_++;
+      handleLine(line);
+      body.remove_prefix(eol == std::string_view::npos ? body.size()
+                                                       : eol + 1);
+    }
 
-        entries_.push_back(new_entry);
+    const auto nchunks = std::clamp<size_t>(body.size() / chunk_size_, 1,
+                                            threads_ * kChunksPerThread);
+    std::vector<std::string_view> chunks;
+    size_t chunk_begin = 0;
+    for (size_t ichunk = 1; ichunk < nchunks; ++ichunk) {
+      const auto boundary = body.find(
+          "\n\n", std::max(chunk_begin, body.size() / nchunks * ichunk));
+      if (boundary == std::string_view::npos) break;
+      chunks.push_back(body.substr(chunk_begin, boundary + 2 - chunk_begin));
+      chunk_begin = boundary + 2;
+    }
+    chunks.push_back(body.substr(chunk_begin));
 
-        if (verbose_) std::cout << "End entry" << std::endl;
+    std::vector<std::unique_ptr<CallgrindParser> > parsers;
+    for (size_t ichunk = 0; ichunk < chunks.size(); ++ichunk) {
+      parsers.emplace_back(new CallgrindParser(ChunkTag{}, *this));
+    }
+
+    std::exception_ptr error;
+    std::vector<std::future<void> > copied;
+    {
+      ThreadPool pool(std::min<size_t>(threads_, chunks.size()));
+      std::atomic<bool> failed{false};
+      std::vector<std::future<void> > parsed;
+      for (size_t ichunk = 0; ichunk < chunks.size(); ++ichunk) {
+        parsed.push_back(pool.submit([&chunks, &parsers, &failed, ichunk] {
+          if (failed) return;
+          parsers[ichunk]->parseText(chunks[ichunk]);
+          parsers[ichunk]->finishText();
+        }));
       }
-      /* header */
-      else if (std::regex_search(line, match_results, re_positions_def)) {
-        for (size_t im = 1; im < match_results.size(); ++im) {
-          positions_def.emplace_back(match_results.str(im));  // TODO trim
-        }
-        current_subposition.resize(positions_def.size());
-        if (verbose_) std::cout << line << std::endl;
-      } else if (std::regex_search(line, match_results, re_events_def)) {
-        for (size_t im = 1; im < match_results.size(); ++im) {
-          events_def.emplace_back(match_results.str(im));  // TODO trim
+
+      /* chunks are merged in order as soon as they are parsed: the merge
+         only maps names and functions and reserves rows, the rows are
+         copied by the pool */
+      size_t ncopied = 0;
+      for (size_t ichunk = 0; ichunk < chunks.size() && !error; ++ichunk) {
+        try {
+          parsed[ichunk].get();
+          auto &chunk = *parsers[ichunk];
+          copied.push_back(pool.submit(
+              [this, &parsers, ichunk, job = mergeChunk(chunk)] {
+                const auto &chunk = *parsers[ichunk];
+                profile_->copyPartRows(job.rows, job.base, chunk.cost_fixups_,
+                                       chunk.call_fixups_,
+                                       chunk.target_fixups_);
+                parsers[ichunk].reset();
+              },
+              true));
+          publishProgress(chunks[ichunk].data() + chunks[ichunk].size() -
+                          text.data());
+          if (snapshotDue()) {
+            /* the snapshot reads the rows */
+            for (; ncopied < copied.size(); ++ncopied) copied[ncopied].wait();
+            takeSnapshot();
+          }
+        } catch (...) {
+          error = std::current_exception();
+          failed = true;
         }
-        if (verbose_) std::cout << line << std::endl;
-      } else if (parseEmptyLine(line)) {
-      } else {
-        //        std::cerr << current_line_number << ": " << line <<
-        //        std::endl;
       }
     }
+    if (error) std::rethrow_exception(error);
+    for (auto &copy : copied) copy.get();
+  }
 
-    for (auto &entry1 : entries_) {
-      for (auto &entry1_call : entry1->calls) {
-        for (auto &entry2 : entries_) {
-          if (*(entry1_call.entry->position) == *(entry2->position)) {
-            entry1_call.entry = entry2;
-            auto this_caller =
-                std::find_if(begin(entry2->callers), end(entry2->callers),
-                             [entry1](const std::weak_ptr<Entry> &e) {
-                               return e.lock() == entry1;
-                             });
-            if (this_caller == end(entry2->callers)) {
-              entry2->callers.emplace_back(entry1);
-            }
-            break;
-          }
-        }
+  struct CopyJob {
+    Profile::PartRows rows;
+    /* sub-positions at the start of the chunk */
+    std::vector<SubPosition> base;
+  };
+
+  CopyJob mergeChunk(const CallgrindParser &chunk) {
+    ParseStats::Scope merge(timing(), ParseStats::kMerge);
+    const auto &chunk_profile = *chunk.profile_;
+
+    const auto &chunk_names = chunk_profile.names();
+    std::vector<NameId> name_ids(chunk_names.size(), NameTable::kEmpty);
+    for (NameId id = 1; id < chunk_names.size(); ++id) {
+      name_ids[id] = profile_->names().intern(chunk_names[id]);
+    }
+    for (const auto &[id, name] : chunk.unresolved_names_) {
+      name_ids[id] = resolveName(name);
+    }
+    for (auto kind : {NameKind::Object, NameKind::File, NameKind::Symbol}) {
+      const auto &chunk_cache = chunk.compressionCache(kind);
+      auto &cache = compressionCache(kind);
+      for (size_t index = 0; index < chunk_cache.size(); ++index) {
+        const auto id = chunk_cache[index];
+        /* placeholders have empty names */
+        if (chunk_names[id].empty()) continue;
+        if (index >= cache.size()) cache.resize(index + 1, NameTable::kEmpty);
+        cache[index] = name_ids[id];
       }
     }
 
-    std::sort(begin(entries_), end(entries_),
-              [](const EntryPtr &lhs, const EntryPtr &rhs) {
-                return lhs->totalCost()[0] > rhs->totalCost()[0];
-              });
+    CopyJob job{profile_->appendPart(chunk_profile, name_ids),
+                current_subposition};
 
-    std::cout << "Parsed " << current_line_number << " lines" << std::endl;
+    /* the state at the end of the chunk is the start of the next one */
+    for (size_t index = 0; index < current_subposition.size(); ++index) {
+      current_subposition[index] =
+          chunk.current_subposition[index] +
+          (chunk.subposition_known_[index] ? 0 : job.base[index]);
+    }
+    current_position_.binary = name_ids[chunk.current_position_.binary];
+    current_position_.source = name_ids[chunk.current_position_.source];
+    current_position_.symbol = name_ids[chunk.current_position_.symbol];
+    /* the entry open at the end of the chunk is ended by the parent */
+    if (chunk.ended_in_ == State::EntryCosts) state_ = State::EntryCosts;
+    current_line_number_ += chunk.current_line_number_;
+    entries_parsed_ += chunk.entries_parsed_;
+    mergeHeaders(chunk);
+    return job;
   }
 
- private:
-  template <typename NumberType, typename Iterator>
-  NumberType parseNumber(const Iterator &begin, const Iterator &end) {
-    auto length = std::distance(begin, end);
-    assert(length > 0);
-    return boost::lexical_cast<NumberType>(begin.operator->(), length);
+  NameId resolveName(const UnresolvedName &name) const {
+    if (name.inherited) {
+      switch (name.kind) {
+        case NameKind::Object:
+          return current_position_.binary;
+        case NameKind::File:
+          return current_position_.source;
+        case NameKind::Symbol:
+          return current_position_.symbol;
+      }
+    }
+    const auto &cache = compressionCache(name.kind);
+    if (name.compression_index < cache.size() &&
+        cache[name.compression_index] != NameTable::kEmpty) {
+      return cache[name.compression_index];
+    }
+    throw std::runtime_error("Cannot find compression from the cache");
+  }
+
+  /* placeholder in the name table of the chunk profile */
+  NameId unresolvedName(const UnresolvedName &name) {
+    const auto id = profile_->names().reserve();
+    unresolved_names_.emplace_back(id, name);
+    return id;
+  }
+
+  void checkDefinitionAllowed() const {
+    /* a chunk comes after the first entry, so costs have already been
+       defined; the sequential parser reports the error */
+    if (chunk_mode_) {
+      throw std::runtime_error("Positions and events must precede costs");
+    }
+  }
+
+  void addFixups(std::vector<SubPositionFixup> &fixups, uint64_t row,
+                 const std::vector<uint32_t> &indices) {
+    for (auto index : indices) fixups.push_back({row, index});
+  }
+
+  void resizeLineBuffers() {
+    cost_sub_positions_.resize(positions_def.size());
+    cost_values_.resize(events_def.size());
+    call_sub_positions_.resize(positions_def.size());
+    selectLineDecoders();
+  }
+
+  uint64_t addCost(FunctionId function, const CostSpec &cost_spec) {
+    return profile_->addCost(function, cost_spec.sub_positions.data(),
+                             cost_spec.costs.data());
+  }
+
+  enum class LineType {
+    Empty,
+    /* ob= fl= fn= */
+    Position,
+    /* fi= fe= */
+    FiFe,
+    /* cob= cfi= cfl= cfn= */
+    CallPosition,
+    /* calls= */
+    Calls,
+    /* starts with a digit, '+', '-' or '*' */
+    Cost,
+    /* positions: */
+    PositionsDef,
+    /* events: */
+    EventsDef,
+    Other
+  };
+
+  static bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+  static bool startsWith(std::string_view line, std::string_view prefix) {
+    return line.substr(0, prefix.size()) == prefix;
   }
 
-  template <class Iterator>
-  SubPosition parseSubPosition(const Iterator &begin, const Iterator &end,
-                               size_t subposition_index) {
+  static std::string_view skipSpaces(std::string_view text) {
+    size_t pos = 0;
+    while (pos < text.size() && isSpace(text[pos])) ++pos;
+    return text.substr(pos);
+  }
+
+  /* cuts the next space-separated token from the text */
+  static std::string_view nextToken(std::string_view &text) {
+    text = skipSpaces(text);
+    size_t pos = 0;
+    while (pos < text.size() && !isSpace(text[pos])) ++pos;
+    auto token = text.substr(0, pos);
+    text.remove_prefix(pos);
+    return token;
+  }
+
+  static LineType classifyLine(std::string_view line) {
+    if (line.empty()) return LineType::Empty;
+    switch (line[0]) {
+      case '0':
+      case '1':
+      case '2':
+      case '3':
+      case '4':
+      case '5':
+      case '6':
+      case '7':
+      case '8':
+      case '9':
+      case '+':
+      case '-':
+      case '*':
+        return LineType::Cost;
+      case 'f':
+        if (line.size() < 3 || line[2] != '=') return LineType::Other;
+        if (line[1] == 'l' || line[1] == 'n') return LineType::Position;
+        if (line[1] == 'i' || line[1] == 'e') return LineType::FiFe;
+        return LineType::Other;
+      case 'o':
+        return startsWith(line, "ob=") ? LineType::Position : LineType::Other;
+      case 'c':
+        if (line.size() >= 4 && line[3] == '=' &&
+            (startsWith(line, "cfn") || startsWith(line, "cob") ||
+             startsWith(line, "cfi") || startsWith(line, "cfl"))) {
+          return LineType::CallPosition;
+        }
+        return startsWith(line, "calls=") ? LineType::Calls : LineType::Other;
+      case 'p':
+        return startsWith(line, "positions:") ? LineType::PositionsDef
+                                              : LineType::Other;
+      case 'e':
+        return startsWith(line, "events:") ? LineType::EventsDef
+                                           : LineType::Other;
+      case ' ':
+      case '\t':
+      case '\r':
+        return skipSpaces(line).empty() ? LineType::Empty : LineType::Other;
+      default:
+        return LineType::Other;
+    }
+  }
+
+  /* Number := Decimal | "0x" Hex */
+  template <typename NumberType>
+  static std::optional<NumberType> parseNumber(std::string_view token) {
+    int base = 10;
+    if (token.size() > 2 && token[0] == '0' &&
+        (token[1] == 'x' || token[1] == 'X')) {
+      token.remove_prefix(2);
+      base = 16;
+    }
+    NumberType result{};
+    auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(),
+                                     result, base);
+    if (ec != std::errc() || ptr != token.data() + token.size() ||
+        token.empty()) {
+      return {};
+    }
+    return result;
+  }
+
+  std::optional<SubPosition> parseSubPosition(std::string_view token,
+                                              size_t subposition_index) const {
     /* SubPosition := Number | "+" Number | "-" Number | "*" */
-    if (std::distance(begin, end) == 1 && *begin == '*') {
+    if (token.size() == 1 && token[0] == '*') {
       return current_subposition[subposition_index];
-    } else if (std::distance(begin, end) > 1 && *begin == '+') {
-      return current_subposition[subposition_index] +
-             parseNumber<SubPosition>(begin + 1, end);
-    } else if (std::distance(begin, end) > 1 && *begin == '-') {
-      return current_subposition[subposition_index] -
-             parseNumber<SubPosition>(begin + 1, end);
+    } else if (token.size() > 1 && token[0] == '+') {
+      auto diff = parseNumber<SubPosition>(token.substr(1));
+      if (!diff) return {};
+      return current_subposition[subposition_index] + *diff;
+    } else if (token.size() > 1 && token[0] == '-') {
+      auto diff = parseNumber<SubPosition>(token.substr(1));
+      if (!diff) return {};
+      return current_subposition[subposition_index] - *diff;
     }
-    current_subposition[subposition_index] =
-        parseNumber<SubPosition>(begin, end);
-    return current_subposition[subposition_index];
+    return parseNumber<SubPosition>(token);
   }
 
-  bool parseEmptyLine(const std::string &empty_line) {
-    static const std::regex re_empty("^\\s*$");
-    return std::regex_search(empty_line, re_empty);
+  static bool isRelativeSubPosition(std::string_view token) {
+    return token[0] == '*' || token[0] == '+' || token[0] == '-';
   }
 
-  std::optional<PositionSpec> parsePositionLine(const std::string &line,
+  std::vector<NameId> &compressionCache(NameKind kind) {
+    return const_cast<std::vector<NameId> &>(
+        std::as_const(*this).compressionCache(kind));
+  }
+  const std::vector<NameId> &compressionCache(NameKind kind) const {
+    switch (kind) {
+      case NameKind::Object:
+        return object_compression_cache_;
+      case NameKind::File:
+        return file_compression_cache_;
+      case NameKind::Symbol:
+      default:
+        return symbol_compression_cache_;
+    }
+  }
+
+  /* "positions:" or "events:" followed by space-separated names */
+  static const std::vector<std::string> &parseDefinitionLine(
+      std::string_view line, std::vector<std::string> &definition) {
+    line.remove_prefix(line.find(':') + 1);
+    definition.clear();
+    for (auto token = nextToken(line); !token.empty();
+         token = nextToken(line)) {
+      definition.emplace_back(token);
+    }
+    return definition;
+  }
+
+  std::optional<PositionSpec> parsePositionLine(std::string_view line,
                                                 PositionType position_type) {
     /* CostPosition := "ob" | "fl" | "fi" | "fe" | "fn" */
     /* CalledPosition := " "cob" | "cfi" | "cfl" | "cfn" */
-    static const std::vector<std::regex> re_map{
-        std::regex(R"(^(ob|fl|fi|fe|fn)=[ \t]*(\(\d+\))?[ \t]*(.*)$)"),
-        std::regex(R"(^c(ob|fl|fi|fn)=[ \t]*(\(\d+\))?[ \t]*(.*)$)"),
-        std::regex(R"(^(fi|fe)=[ \t]*(\(\d+\))?[ \t]*(.*)$)")};
-    auto &re_position_spec = re_map[size_t(position_type)];
-
-    std::smatch match_results;
-
-    if (std::regex_search(line, match_results, re_position_spec)) {
-      auto position = match_results[1].str();
-      auto compression_index =
-          match_results[2].matched
-              ? parseNumber<unsigned int>(match_results[2].first + 1,
-                                          match_results[2].second - 1)
-              : -1;
-      bool has_specified_name =
-          match_results[3].matched && !match_results[3].str().empty();
-
-      std::string value;
-      if (!has_specified_name) {
-        const std::map<unsigned int, std::string> *cache{nullptr};
-        if (position == "fl" || position == "fe" || position == "fi") {
-          cache = &file_compression_cache_;
-        } else if (position == "fn") {
-          cache = &symbol_compression_cache_;
-        } else if (position == "ob") {
-          cache = &object_compression_cache_;
-        } else {
-          assert(false);
-        }
-        auto result = cache->find(compression_index);
-        if (result == end(*cache)) {
-          throw std::runtime_error("Cannot find compression from the cache");
-        }
-        value = result->second;
-      } else {
-        value = match_results.str(3);
+    if (position_type == PositionType::Call) {
+      line.remove_prefix(1);
+    }
+    if (line.size() < 3 || line[2] != '=') return {};
+    auto position = line.substr(0, 2);
+    if (position_type == PositionType::FiFe && position != "fi" &&
+        position != "fe") {
+      return {};
+    }
+    line = skipSpaces(line.substr(3));
+
+    /* "(" Number ")" */
+    std::optional<unsigned int> compression_index;
+    if (!line.empty() && line[0] == '(') {
+      auto closing = line.find(')');
+      if (closing != std::string_view::npos &&
+          (compression_index =
+               parseNumber<unsigned int>(line.substr(1, closing - 1)))) {
+        line = skipSpaces(line.substr(closing + 1));
       }
+    }
+    bool has_specified_name = !line.empty();
+
+    NameKind kind;
+    if (position == "fl" || position == "fe" || position == "fi") {
+      kind = NameKind::File;
+    } else if (position == "fn") {
+      kind = NameKind::Symbol;
+    } else if (position == "ob") {
+      kind = NameKind::Object;
+    } else {
+      return {};
+    }
+    auto cache = &compressionCache(kind);
 
-      /* cache value */
-      if (compression_index >= 0 && has_specified_name) {
-        std::map<unsigned int, std::string> *cache = &symbol_compression_cache_;
-        if (position == "fl" || position == "fe" || position == "fi") {
-          cache = &file_compression_cache_;
-        } else if (position == "fn") {
-          cache = &symbol_compression_cache_;
-        } else if (position == "ob") {
-          cache = &object_compression_cache_;
-        } else {
-          assert(false);
+    /* the name is copied only once: when it enters the name table */
+    NameId id = NameTable::kEmpty;
+    if (!has_specified_name) {
+      if (compression_index && *compression_index < cache->size()) {
+        id = (*cache)[*compression_index];
+      }
+      if (id == NameTable::kEmpty && chunk_mode_ && compression_index) {
+        /* defined in an earlier chunk */
+        id = unresolvedName({false, kind, *compression_index});
+        if (*compression_index >= cache->size()) {
+          cache->resize(*compression_index + 1, NameTable::kEmpty);
         }
-        auto result = cache->emplace(compression_index, value);
-        assert(result.second);
+        (*cache)[*compression_index] = id;
+      }
+      if (id == NameTable::kEmpty) {
+        throw std::runtime_error("Cannot find compression from the cache");
+      }
+    } else {
+      id = profile_->names().intern(line);
+      if (compression_index) {
+        /* cache value */
+        if (*compression_index >= cache->size()) {
+          cache->resize(*compression_index + 1, NameTable::kEmpty);
+        }
+        assert((*cache)[*compression_index] == NameTable::kEmpty);
+        (*cache)[*compression_index] = id;
       }
-
-      assert(!value.empty());
-      return {{position, value}};
     }
-    return {};
+
+    assert(id != NameTable::kEmpty);
+    return {{position, profile_->names()[id], id}};
   }
 
-  std::optional<CostSpec> parseCostLine(const std::string &costs_line) {
-    static const std::regex re_space("\\s+");
-    static const std::regex re_number(
-        R"(^(\*|[+-]\d+|0[xX][0-9a-fA-F]+|\d+)+$)");
-    for (auto it = std::sregex_token_iterator(begin(costs_line),
-                                              end(costs_line), re_space, -1);
-         it != std::sregex_token_iterator(); ++it) {
-      if (!std::regex_match(it->first, it->second, re_number)) {
-        return {};
-      }
-    }
+  std::optional<CostSpec> parseCostLine(std::string_view line) {
+    return (this->*decode_cost_line_)(line);
+  }
+  std::optional<CallSpec> parseCallLine(std::string_view line) {
+    return (this->*decode_call_line_)(line);
+  }
 
-    std::stringstream ss(costs_line);
+  /* Cost and call lines are most of a file, so their decoders are
+     instantiated for the common numbers of positions and events, with the
+     column loops unrolled; kAny takes the numbers of the definitions. */
+  static constexpr size_t kAny = 0;
+
+  using CostLineDecoder =
+      std::optional<CostSpec> (CallgrindParser::*)(std::string_view);
+  using CallLineDecoder =
+      std::optional<CallSpec> (CallgrindParser::*)(std::string_view);
+
+  template <size_t kPositions>
+  static std::pair<CostLineDecoder, CallLineDecoder> lineDecoders(
+      size_t nevents) {
+    constexpr auto call_decoder = &CallgrindParser::decodeCallLine<kPositions>;
+    switch (nevents) {
+      /* Ir */
+      case 1:
+        return {&CallgrindParser::decodeCostLine<kPositions, 1>, call_decoder};
+      /* Ir Dr, as the generator writes */
+      case 2:
+        return {&CallgrindParser::decodeCostLine<kPositions, 2>, call_decoder};
+      /* --cache-sim=yes */
+      case 9:
+        return {&CallgrindParser::decodeCostLine<kPositions, 9>, call_decoder};
+      /* --cache-sim=yes --branch-sim=yes */
+      case 13:
+        return {&CallgrindParser::decodeCostLine<kPositions, 13>,
+                call_decoder};
+      default:
+        return {&CallgrindParser::decodeCostLine<kAny, kAny>,
+                &CallgrindParser::decodeCallLine<kAny>};
+    }
+  }
 
-    std::vector<SubPosition> sub_positions;
-    sub_positions.reserve(positions_def.size());
+  /* after the header defined positions and events */
+  void selectLineDecoders() {
+    const auto nevents = events_def.size();
+    switch (positions_def.size()) {
+      /* line or instr */
+      case 1:
+        std::tie(decode_cost_line_, decode_call_line_) =
+            lineDecoders<1>(nevents);
+        break;
+      /* instr line */
+      case 2:
+        std::tie(decode_cost_line_, decode_call_line_) =
+            lineDecoders<2>(nevents);
+        break;
+      default:
+        decode_cost_line_ = &CallgrindParser::decodeCostLine<kAny, kAny>;
+        decode_call_line_ = &CallgrindParser::decodeCallLine<kAny>;
+    }
+  }
 
-    std::vector<Cost> costs;
-    costs.reserve(events_def.size());
+  /* the decimal number at the start of text, which is left after it; false
+     for anything else, hexadecimal numbers and the ones that may overflow
+     are left to parseNumber() */
+  static bool scanDecimal(std::string_view &text, uint64_t &value) {
+    constexpr size_t kMaxDigits = 19;
+    const auto length = std::min(text.size(), kMaxDigits + 1);
+    uint64_t result = 0;
+    size_t pos = 0;
+    for (; pos < length && unsigned(text[pos] - '0') < 10; ++pos) {
+      result = result * 10 + unsigned(text[pos] - '0');
+    }
+    if (pos == 0 || pos > kMaxDigits ||
+        (pos < text.size() && !isSpace(text[pos]))) {
+      return false;
+    }
+    value = result;
+    text.remove_prefix(pos);
+    return true;
+  }
 
-    int subposition_index = 0;
-    for (auto &&_ : positions_def) {
-      std::string tmp;
-      ss >> tmp;
-      auto sub_position =
-          parseSubPosition(begin(tmp), end(tmp), subposition_index);
-      sub_positions.emplace_back(sub_position);
-      subposition_index++;
+  /* the next sub-position of line, a relative one in a chunk whose base is
+     not known yet is added to fixup_indices */
+  bool scanSubPosition(std::string_view &line, size_t index,
+                       SubPosition &sub_position,
+                       std::vector<uint32_t> &fixup_indices) const {
+    line = skipSpaces(line);
+    if (line.empty()) return false;
+    const auto sign = line[0];
+    const bool relative = isRelativeSubPosition(line);
+    auto number = line.substr(sign == '+' || sign == '-' ? 1 : 0);
+    uint64_t value;
+    if (sign != '*' && scanDecimal(number, value)) {
+      sub_position = sign == '+'   ? current_subposition[index] + value
+                     : sign == '-' ? current_subposition[index] - value
+                                   : value;
+      line = number;
+    } else {
+      auto parsed = parseSubPosition(nextToken(line), index);
+      if (!parsed) return false;
+      sub_position = *parsed;
+    }
+    if (chunk_mode_ && relative && !subposition_known_[index]) {
+      fixup_indices.push_back(uint32_t(index));
     }
+    return true;
+  }
 
-    for (auto &&_ : events_def) {
-      std::string tmp;
-      ss >> tmp;
-      auto cost = parseNumber<Cost>(begin(tmp), end(tmp));
-      costs.emplace_back(cost);
+  template <size_t kPositions, size_t kEvents>
+  std::optional<CostSpec> decodeCostLine(std::string_view line) {
+    /* CostLine := SubPositionList Costs? */
+    const auto npositions =
+        kPositions == kAny ? cost_sub_positions_.size() : kPositions;
+    const auto nevents = kEvents == kAny ? cost_values_.size() : kEvents;
+    auto sub_positions = cost_sub_positions_.data();
+    cost_fixup_indices_.clear();
+    for (size_t index = 0; index < npositions; ++index) {
+      if (!scanSubPosition(line, index, sub_positions[index],
+                           cost_fixup_indices_)) {
+        return {};
+      }
     }
 
-    return {{sub_positions, costs}};
+    /* trailing zero costs may be omitted */
+    auto costs = cost_values_.data();
+    size_t nparsed = 0;
+    for (; nparsed < nevents; ++nparsed) {
+      line = skipSpaces(line);
+      if (line.empty()) break;
+      if (scanDecimal(line, costs[nparsed])) continue;
+      auto parsed_cost = parseNumber<Cost>(nextToken(line));
+      if (!parsed_cost) return {};
+      costs[nparsed] = *parsed_cost;
+    }
+    std::fill(costs + nparsed, costs + nevents, 0);
+
+    std::copy(sub_positions, sub_positions + npositions,
+              current_subposition.data());
+    if (chunk_mode_) {
+      /* an absolute sub-position ends the dependency on the previous chunk */
+      std::fill(begin(subposition_known_), end(subposition_known_), true);
+      for (auto index : cost_fixup_indices_) subposition_known_[index] = false;
+    }
+    return {{cost_sub_positions_, cost_values_}};
   }
 
-  std::optional<CallSpec> parseCallLine(const std::string &line) {
+  template <size_t kPositions>
+  std::optional<CallSpec> decodeCallLine(std::string_view line) {
     /* CallLine := "calls=" Space* Number Space+ SubPositionList */
-    static const std::regex re_call_line(R"(^calls=\s*(.+)\s+(.+))");
-
-    std::smatch match_results;
-    if (std::regex_search(line, match_results, re_call_line)) {
-      auto n_calls = parseNumber<unsigned int>(match_results[1].first,
-                                               match_results[1].second);
-
-      std::vector<SubPosition> sub_positions;
-      std::stringstream ss(match_results[2].str());
-      int subposition_index = 0;
-      for (auto &&_ : positions_def) {
-        std::string tmp;
-        ss >> tmp;
-        sub_positions.emplace_back(
-            parseSubPosition(begin(tmp), end(tmp), subposition_index));
-        subposition_index++;
+    line.remove_prefix(std::string_view("calls=").size());
+    auto n_calls = parseNumber<uint64_t>(nextToken(line));
+    if (!n_calls) return {};
+
+    /* the target position is relative to the current one but does not
+       replace it */
+    const auto npositions =
+        kPositions == kAny ? call_sub_positions_.size() : kPositions;
+    auto sub_positions = call_sub_positions_.data();
+    call_fixup_indices_.clear();
+    for (size_t index = 0; index < npositions; ++index) {
+      if (!scanSubPosition(line, index, sub_positions[index],
+                           call_fixup_indices_)) {
+        return {};
       }
-
-      return {{n_calls, sub_positions}};
     }
 
-    return {};
+    return {{*n_calls, call_sub_positions_}};
   }
 
  public:
-  void SetVerbose(bool verbose) { CallgrindParser::verbose_ = verbose; }
+  void SetInputMode(InputMode input_mode) { input_mode_ = input_mode; }
+  /* memory-mapped files of at least two chunks are parsed by the given
+     number of threads */
+  void SetThreads(unsigned int threads) { threads_ = std::max(threads, 1u); }
+  void SetChunkSize(size_t chunk_size) {
+    chunk_size_ = std::max<size_t>(chunk_size, 1);
+  }
+  /* publish snapshots while parsing, see getSnapshot() */
+  void SetSnapshots(bool snapshots) { snapshots_ = snapshots; }
+  /* load the profile from the ProfileCache of the file when it is up to
+     date, and write the cache after parsing otherwise */
+  void SetCache(bool cache) { cache_ = cache; }
+  /* keep the functions of several files apart instead of summing them,
+     their object names are labelled with the thread or the file */
+  void SetKeepParts(bool keep_parts) { keep_parts_ = keep_parts; }
+  /* sort the entries of the profile by inclusive cost; a report reads the
+     top ones alone, see Profile::topEntriesBy() */
+  void SetSortEntries(bool sort_entries) { sort_entries_ = sort_entries; }
+
+  /* Follow a running program: parse() reads no cache and publishes copies
+     of the profile, which update() then extends. A directory can be given
+     instead of a file to follow the callgrind.out.* dumps in it. */
+  void SetFollow(bool follow) { follow_ = follow; }
+
+  /* Merges what the followed run added since parse() or the last call: the
+     complete lines appended to the file parsed, and the dumps of the run
+     appearing next to it, each parsed on its own. A file is merged once its
+     size stayed the same since the previous call, so calls should be some
+     time apart. A file which shrank was written anew and the profile is
+     parsed again. Returns whether a new snapshot was published. */
+  bool update() {
+    assert(follow_);
+    bool merged = false;
+    for (auto &file : followed_) {
+      std::error_code error;
+      const auto size = std::filesystem::file_size(file.path, error);
+      if (error) continue;
+      if (size < file.merged) {
+        parse();
+        return true;
+      }
+      const bool settled = size == file.size;
+      file.size = size;
+      if (!settled || size == file.merged) continue;
+      if (file.merged == 0) {
+        mergeDump(file);
+        merged = true;
+      } else if (file.appendable && mergeAppended(file)) {
+        merged = true;
+      }
+    }
+    for (const auto &path : newDumps()) {
+      std::error_code error;
+      const auto size = std::filesystem::file_size(path, error);
+      if (!error) follow(path, 0, size, false);
+    }
+    if (!merged) return false;
+    publishProgress(total_bytes_);
+    takeSnapshot();
+    return true;
+  }
+  /* whether a followed file has bytes not merged yet */
+  bool pending() const {
+    return std::any_of(begin(followed_), end(followed_),
+                       [](const FollowedFile &file) {
+                         return file.size != file.merged;
+                       });
+  }
+  /* the directory the dumps of the followed run are written to */
+  const std::string &followedDirectory() const { return follow_directory_; }
+
+  /* from the headers of the files: the number of "part:" lines, the
+     "thread:" of the first file giving one, and the summed totals of the
+     parts, or the summaries if no totals were given */
+  unsigned int parts() const { return parts_; }
+  const std::string &thread() const { return thread_; }
+  const std::vector<Cost> &totals() const {
+    return totals_.empty() ? summary_ : totals_;
+  }
 
   void Summary() const {
     using std::cout;
     using std::endl;
 
-    cout << "Entries: " << entries_.size() << "; " << endl;
-    cout << "Unique positions: " << positions_cache_.size() << "; " << endl;
+    const auto profile = getProfile();
+    cout << "Entries: " << profile->entries().size() << "; " << endl;
+    cout << "Unique positions: " << profile->functionCount() << "; " << endl;
     cout << endl;
     printTopEntries(cout, 100);
   }
 
+  /* the parsed profile; when following, the last snapshot of it */
+  std::shared_ptr<const Profile> getProfile() const {
+    return follow_ ? getSnapshot() : profile_;
+  }
+
+  /* Safe to call from other threads while parse() runs */
+
+  /* the last published state of the profile being parsed, the complete
+     profile once parse() returns; null before the first snapshot */
+  std::shared_ptr<const Profile> getSnapshot() const {
+    return std::atomic_load(&snapshot_);
+  }
+  /* what the last parse() took, null before it returned */
+  std::shared_ptr<const ParseStats> stats() const {
+    return std::atomic_load(&published_stats_);
+  }
+  Progress progress() const {
+    return {bytes_read_, total_bytes_, lines_parsed_, entries_published_};
+  }
+  /* makes parse() throw soon */
+  void Cancel() { cancelled_ = true; }
+
+  /* adapter to the object graph for callers that still need it, built
+     again for each snapshot when following */
   const std::vector<std::shared_ptr<Entry> > &getEntries() const {
+    if (auto profile = getProfile(); !profile || profile != entries_profile_) {
+      buildEntries();
+      entries_profile_ = std::move(profile);
+    }
     return entries_;
   }
 
  private:
-  void printTopEntries(std::ostream &os, unsigned int ne = 0) const {
-    if (entries_.empty()) return;
-    ne = ne == 0 ? entries_.size() : ne;
+  void buildEntries() const {
+    entries_.clear();
+    const auto profile_ptr = getProfile();
+    if (!profile_ptr) return;
+    const auto &profile = *profile_ptr;
+    const auto nfunctions = profile.functionCount();
+
+    std::vector<EntryPtr> function_entries(nfunctions);
+    for (FunctionId function = 0; function < nfunctions; ++function) {
+      auto &entry = function_entries[function];
+      entry = std::make_shared<Entry>();
+      entry->position = std::make_shared<Position>(
+          Position{function, profile.object(function), profile.file(function),
+                   profile.symbol(function)});
+      auto self_cost = profile.selfCost(function);
+      entry->self_cost.assign(self_cost.begin(), self_cost.end());
+      auto inclusive_cost = profile.inclusiveCost(function);
+      entry->inclusive_cost.assign(inclusive_cost.begin(),
+                                   inclusive_cost.end());
+    }
 
-    auto max_cost = entries_[0]->totalCost();
-    for (const auto &entry : entries_) {
+    for (const auto &block : profile.blocks()) {
+      auto &entry = function_entries[block.function];
+      entry->costs.reserve(entry->costs.size() + block.nrows);
+      for (uint32_t irow = 0; irow < block.nrows; ++irow) {
+        const auto row = block.offset + irow;
+        entry->addCost({profile.rowSubPositions(row), profile.rowCosts(row)});
+      }
+    }
+
+    for (FunctionId function = 0; function < nfunctions; ++function) {
+      auto &entry = function_entries[function];
+      for (auto call_id : profile.calls(function)) {
+        const auto &edge = profile.call(call_id);
+        Call call(edge.ncalls, profile.callTargetSubPositions(call_id),
+                  function_entries[edge.callee]);
+        call.addCost(
+            {profile.callSubPositions(call_id), profile.callCost(call_id)});
+        const auto inclusive_cost = profile.callCost(call_id);
+        call.inclusive_cost.assign(inclusive_cost.begin(),
+                                   inclusive_cost.end());
+        entry->addCall(std::move(call));
+      }
+      for (auto caller : profile.callers(function)) {
+        entry->callers.emplace_back(function_entries[caller]);
+      }
+    }
+
+    for (auto function : profile.entries()) {
+      entries_.push_back(function_entries[function]);
+    }
+  }
+
+  void printTopEntries(std::ostream &os, unsigned int ne = 0) const {
+    const auto profile = getProfile();
+    const auto &entries = profile->entries();
+    if (entries.empty()) return;
+    ne = ne == 0 ? entries.size() : ne;
+
+    const auto max_cost =
+        profile->inclusiveCost(entries[0], Profile::kPrimaryEvent);
+    for (auto function : entries) {
       if (ne == 0) break;
 
-      os << entry->totalCost()[0] * 100 / max_cost[0] << "% "
-         << entry->totalCost()[0] << "\t\t" << entry->position->binary
-         << "::" << entry->position->symbol << std::endl;
+      const auto cost =
+          profile->inclusiveCost(function, Profile::kPrimaryEvent);
+      os << cost * 100 / max_cost << "% " << cost << "\t\t"
+         << profile->object(function) << "::" << profile->symbol(function)
+         << std::endl;
       --ne;
     }
   }
@@ -532,16 +1675,99 @@ class CallgrindParser {
   std::vector<std::string> positions_def;
   std::vector<SubPosition> current_subposition;
 
-  std::map<unsigned int, std::string> file_compression_cache_;
-  std::map<unsigned int, std::string> symbol_compression_cache_;
-  std::map<unsigned int, std::string> object_compression_cache_;
+  /* reused by every cost and call line, so parsing does not allocate per
+     line; rows are stored by the profile */
+  std::vector<SubPosition> cost_sub_positions_;
+  std::vector<Cost> cost_values_;
+  std::vector<SubPosition> call_sub_positions_;
+  /* for the numbers of positions and events, see selectLineDecoders() */
+  CostLineDecoder decode_cost_line_{
+      &CallgrindParser::decodeCostLine<kAny, kAny>};
+  CallLineDecoder decode_call_line_{&CallgrindParser::decodeCallLine<kAny>};
+
+  /* "(id)" -> name, indexed by the compression id */
+  std::vector<NameId> file_compression_cache_;
+  std::vector<NameId> symbol_compression_cache_;
+  std::vector<NameId> object_compression_cache_;
 
   std::string filename;
-
-  std::vector<std::shared_ptr<Entry> > entries_;
-  std::vector<std::shared_ptr<Position> > positions_cache_;
-
-  bool verbose_{true};
+  /* all the files when there are several */
+  std::vector<std::string> filenames_;
+  bool keep_parts_{false};
+
+  /* follow mode */
+  bool follow_{false};
+  std::vector<FollowedFile> followed_;
+  std::unordered_set<std::string> followed_keys_;
+  std::string follow_directory_;
+  bool follows_directory_{false};
+  std::string dump_prefix_;
+
+  /* headers */
+  std::vector<std::string> definition_;
+  unsigned int parts_{0};
+  std::string thread_;
+  std::vector<Cost> summary_;
+  std::vector<Cost> totals_;
+
+  std::shared_ptr<Profile> profile_{std::make_shared<Profile>()};
+
+  /* line state machine */
+  State state_{State::None};
+  /* the state at the end of the text, before the last entry was ended */
+  State ended_in_{State::None};
+  PositionKey current_position_;
+  PositionKey call_position_;
+  FunctionId current_function_{Profile::kNoFunction};
+  FunctionId callee_{Profile::kNoFunction};
+  std::optional<CallSpec> call_;
+  unsigned int current_line_number_{0};
+
+  /* parallel parsing */
+  static constexpr size_t kDefaultChunkSize = size_t(8) << 20;
+  static constexpr size_t kChunksPerThread = 4;
+  unsigned int threads_{1};
+  size_t chunk_size_{kDefaultChunkSize};
+  /* set for the parsers of chunks */
+  bool chunk_mode_{false};
+  /* placeholder name ids of the chunk profile */
+  std::vector<std::pair<NameId, UnresolvedName> > unresolved_names_;
+  /* sub-positions not yet given absolutely since the chunk start */
+  std::vector<bool> subposition_known_;
+  /* relative sub-positions of the last cost and call lines to fix up */
+  std::vector<uint32_t> cost_fixup_indices_;
+  std::vector<uint32_t> call_fixup_indices_;
+  std::vector<SubPositionFixup> cost_fixups_;
+  std::vector<SubPositionFixup> call_fixups_;
+  std::vector<SubPositionFixup> target_fixups_;
+
+  /* progress reporting */
+  static constexpr unsigned int kProgressLines = 4096;
+  static constexpr auto kSnapshotInterval = std::chrono::milliseconds(250);
+  static constexpr auto kFilesProgressInterval = std::chrono::milliseconds(50);
+  bool snapshots_{false};
+  std::chrono::steady_clock::time_point next_snapshot_;
+  std::shared_ptr<const Profile> snapshot_;
+  uint64_t entries_parsed_{0};
+  std::atomic<uint64_t> bytes_read_{0};
+  std::atomic<uint64_t> total_bytes_{0};
+  std::atomic<uint64_t> lines_parsed_{0};
+  std::atomic<uint64_t> entries_published_{0};
+  std::atomic<bool> cancelled_{false};
+  /* chunk parsers share the flag of their parent */
+  const std::atomic<bool> *cancel_{&cancelled_};
+
+  mutable std::shared_ptr<const Profile> entries_profile_;
+  mutable std::vector<std::shared_ptr<Entry> > entries_;
+
+  InputMode input_mode_{InputMode::MemoryMapped};
+  bool cache_{false};
+  bool sort_entries_{true};
+
+  /* of the last parse(); the phases are timed while it runs */
+  ParseStats stats_;
+  bool timing_{false};
+  std::shared_ptr<const ParseStats> published_stats_;
 };
 
 #endif  // CALLGRIND_VIEWER__CALLGRINDPARSER_HPP_
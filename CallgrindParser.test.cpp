@@ -21,9 +21,13 @@
 
 #include <gtest/gtest.h>
 
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
 TEST(CallgrindParser, Basics) {
   CallgrindParser parser("callgrind.out.18859");
-  parser.SetVerbose(false);
   parser.parse();
   parser.Summary();
   std::cout << "Done" << std::endl;
@@ -31,7 +35,577 @@ TEST(CallgrindParser, Basics) {
 
 TEST(CallgrindParser, Empty) {
   CallgrindParser parser("empty.out");
-  parser.SetVerbose(false);
   parser.parse();
   parser.Summary();
-}
\ No newline at end of file
+}
+
+namespace {
+
+std::string writeProfile(const std::string &name, const std::string &content) {
+  auto path = std::filesystem::temp_directory_path() / name;
+  std::ofstream(path) << content;
+  return path.string();
+}
+
+std::vector<uint64_t> toVector(Span<const uint64_t> span) {
+  return {span.begin(), span.end()};
+}
+
+/* same functions, rows and calls in the same order */
+void expectSameProfile(const Profile &lhs, const Profile &rhs) {
+  ASSERT_EQ(lhs.functionCount(), rhs.functionCount());
+  for (Profile::FunctionId function = 0; function < lhs.functionCount();
+       ++function) {
+    EXPECT_EQ(lhs.object(function), rhs.object(function));
+    EXPECT_EQ(lhs.file(function), rhs.file(function));
+    EXPECT_EQ(lhs.symbol(function), rhs.symbol(function));
+    EXPECT_EQ(toVector(lhs.inclusiveCost(function)),
+              toVector(rhs.inclusiveCost(function)));
+  }
+  EXPECT_EQ(lhs.entries(), rhs.entries());
+  ASSERT_EQ(lhs.blocks().size(), rhs.blocks().size());
+  for (size_t iblock = 0; iblock < lhs.blocks().size(); ++iblock) {
+    const auto &block = lhs.blocks()[iblock];
+    EXPECT_EQ(block.function, rhs.blocks()[iblock].function);
+    ASSERT_EQ(block.nrows, rhs.blocks()[iblock].nrows);
+    for (uint32_t irow = 0; irow < block.nrows; ++irow) {
+      EXPECT_EQ(toVector(lhs.rowSubPositions(block.offset + irow)),
+                toVector(rhs.rowSubPositions(block.offset + irow)));
+    }
+  }
+  ASSERT_EQ(lhs.callCount(), rhs.callCount());
+  for (Profile::CallId call = 0; call < lhs.callCount(); ++call) {
+    EXPECT_EQ(lhs.call(call).callee, rhs.call(call).callee);
+    EXPECT_EQ(toVector(lhs.callSubPositions(call)),
+              toVector(rhs.callSubPositions(call)));
+    EXPECT_EQ(toVector(lhs.callTargetSubPositions(call)),
+              toVector(rhs.callTargetSubPositions(call)));
+  }
+}
+
+}  // namespace
+
+TEST(CallgrindParser, CostLines) {
+  auto filename = writeProfile("cursegrind.cost_lines.out",
+                               "events: Ir Dr\n"
+                               "positions: instr line\n"
+                               "\n"
+                               "ob=(1) a.out\n"
+                               "fl=(1) a.c\n"
+                               "fn=(1) main\n"
+                               "0x10 3 5 1\n"
+                               "+2 * 7\n"
+                               "cfn=(2) foo\n"
+                               "calls=2 0x20 10\n"
+                               "+1 -1 100 10\n"
+                               "* +4 1\n"
+                               "\n"
+                               "fn=(2)\n"
+                               "0x20 10 100 10\n");
+  CallgrindParser parser(filename);
+  parser.parse();
+
+  auto &entries = parser.getEntries();
+  ASSERT_EQ(entries.size(), 2);
+  auto &main_entry = entries[0];
+  EXPECT_EQ(main_entry->position->symbol, "main");
+  EXPECT_EQ(main_entry->position->binary, "a.out");
+  ASSERT_EQ(main_entry->costs.size(), 3);
+  EXPECT_EQ(toVector(main_entry->costs[1].sub_positions),
+            (std::vector<CallgrindParser::SubPosition>{0x12, 3}));
+  EXPECT_EQ(toVector(main_entry->costs[1].costs),
+            (std::vector<CallgrindParser::Cost>{7, 0}));
+  EXPECT_EQ(toVector(main_entry->costs[2].sub_positions),
+            (std::vector<CallgrindParser::SubPosition>{0x13, 6}));
+
+  ASSERT_EQ(main_entry->calls.size(), 1);
+  auto &call = main_entry->calls[0];
+  EXPECT_EQ(call.ncalls, 2);
+  EXPECT_EQ(call.entry, entries[1]);
+  EXPECT_EQ(call.totalCosts(), (std::vector<CallgrindParser::Cost>{100, 10}));
+  EXPECT_EQ(main_entry->selfCost(),
+            (std::vector<CallgrindParser::Cost>{13, 1}));
+  EXPECT_EQ(main_entry->totalCost(),
+            (std::vector<CallgrindParser::Cost>{113, 11}));
+}
+
+/* the decoders made for some numbers of positions and events and the one
+   for any other read the same */
+TEST(CallgrindParser, CostLineLayouts) {
+  for (std::string positions : {"line", "instr line", "instr bb line"}) {
+    for (size_t nevents : {1, 2, 3, 9, 13}) {
+      SCOPED_TRACE(positions + ", " + std::to_string(nevents) + " events");
+      const auto npositions =
+          size_t(std::count(begin(positions), end(positions), ' ') + 1);
+      std::string content = "positions: " + positions + "\nevents:";
+      for (size_t event = 0; event < nevents; ++event) {
+        content += " E" + std::to_string(event);
+      }
+      content += "\n\nfn=main\n";
+      for (size_t position = 0; position < npositions; ++position) {
+        content += "5 ";
+      }
+      for (size_t event = 0; event < nevents; ++event) {
+        content += std::to_string(event + 1) + " ";
+      }
+      /* hexadecimal and too long for the fast path */
+      content += "\n";
+      for (size_t position = 0; position < npositions; ++position) {
+        content += "+2\t";
+      }
+      content += "0x10";
+      for (size_t event = 1; event < nevents; ++event) {
+        content += event == 1 ? " 12345678901234567890"
+                              : " " + std::to_string(event + 1);
+      }
+      /* trailing zero costs left out */
+      content += "\n";
+      for (size_t position = 0; position < npositions; ++position) {
+        content += "* ";
+      }
+      content += "1\n";
+
+      const auto filename =
+          writeProfile("cursegrind.cost_line_layouts.out", content);
+      CallgrindParser parser(filename);
+      parser.parse();
+      const auto &entries = parser.getEntries();
+      ASSERT_EQ(entries.size(), 1);
+      ASSERT_EQ(entries[0]->costs.size(), 3);
+      EXPECT_EQ(toVector(entries[0]->costs[2].sub_positions),
+                std::vector<CallgrindParser::SubPosition>(npositions, 7));
+      std::vector<CallgrindParser::Cost> expected(nevents);
+      for (size_t event = 0; event < nevents; ++event) {
+        expected[event] = 2 * (event + 1);
+      }
+      expected[0] = 18;
+      if (nevents > 1) expected[1] = 12345678901234567890ull + 2;
+      EXPECT_EQ(entries[0]->selfCost(), expected);
+
+      writeProfile("cursegrind.cost_line_layouts.out",
+                   content + std::string(npositions, '+') + "\n");
+      CallgrindParser bad_parser(filename);
+      EXPECT_THROW(bad_parser.parse(), std::runtime_error);
+    }
+  }
+}
+
+TEST(CallgrindParser, InputModes) {
+  CallgrindParser mapped_parser("callgrind.out.18859");
+  mapped_parser.SetInputMode(CallgrindParser::InputMode::MemoryMapped);
+  mapped_parser.parse();
+
+  CallgrindParser stream_parser("callgrind.out.18859");
+  stream_parser.SetInputMode(CallgrindParser::InputMode::Stream);
+  stream_parser.parse();
+
+  auto &mapped = mapped_parser.getEntries();
+  auto &streamed = stream_parser.getEntries();
+  ASSERT_EQ(mapped.size(), streamed.size());
+  for (size_t i = 0; i < mapped.size(); ++i) {
+    EXPECT_EQ(*mapped[i]->position, *streamed[i]->position);
+    EXPECT_EQ(mapped[i]->totalCost(), streamed[i]->totalCost());
+  }
+}
+
+TEST(CallgrindParser, RepeatedFunctionBlocks) {
+  auto filename = writeProfile("cursegrind.repeated_blocks.out",
+                               "events: Ir\n"
+                               "\n"
+                               "fn=(1) main\n"
+                               "1 10\n"
+                               "cfn=(2) foo\n"
+                               "calls=1 1\n"
+                               "2 50\n"
+                               "\n"
+                               "fn=(2)\n"
+                               "1 50\n"
+                               "\n"
+                               "fn=(1)\n"
+                               "3 5\n"
+                               "cfn=(2)\n"
+                               "calls=2 1\n"
+                               "4 100\n");
+  CallgrindParser parser(filename);
+  parser.parse();
+
+  auto &entries = parser.getEntries();
+  ASSERT_EQ(entries.size(), 2);
+  auto &main_entry = entries[0];
+  auto &foo_entry = entries[1];
+  EXPECT_EQ(main_entry->position->symbol, "main");
+  EXPECT_EQ(main_entry->costs.size(), 2);
+  EXPECT_EQ(main_entry->calls.size(), 2);
+  EXPECT_EQ(main_entry->totalCost(), (std::vector<CallgrindParser::Cost>{165}));
+  for (auto &call : main_entry->calls) {
+    EXPECT_EQ(call.entry, foo_entry);
+  }
+  ASSERT_EQ(foo_entry->callers.size(), 1);
+  EXPECT_EQ(foo_entry->callers[0].lock(), main_entry);
+}
+
+TEST(CallgrindParser, ParallelParse) {
+  /* names defined and positions given relatively in one chunk are used by
+     the next ones, ob= and fl= carry over between entries */
+  auto filename = writeProfile("cursegrind.parallel.out",
+                               "positions: instr line\n"
+                               "events: Ir Dr\n"
+                               "\n"
+                               "ob=(1) a.out\n"
+                               "fl=(1) a.c\n"
+                               "fn=(1) main\n"
+                               "0x10 3 5 1\n"
+                               "cfn=(2) foo\n"
+                               "calls=1 +16 -1\n"
+                               "+1 * 20 2\n"
+                               "\n"
+                               "fn=(2)\n"
+                               "+4 +2 20 2\n"
+                               "cob=(2) libc.so\n"
+                               "cfn=(3) free\n"
+                               "calls=1 0x100 1\n"
+                               "* * 7\n"
+                               "\n"
+                               "fl=(2) b.c\n"
+                               "fn=(1)\n"
+                               "-2 0x30 1\n"
+                               "\n"
+                               "ob=(2)\n"
+                               "fn=(3)\n"
+                               "0x100 1 7\n");
+  CallgrindParser sequential(filename);
+  sequential.parse();
+
+  for (unsigned int threads : {2u, 3u}) {
+    CallgrindParser parallel(filename);
+    parallel.SetThreads(threads);
+    parallel.SetChunkSize(16);
+    parallel.parse();
+    expectSameProfile(*sequential.getProfile(), *parallel.getProfile());
+  }
+
+  CallgrindParser parallel("callgrind.out.18859");
+  parallel.SetThreads(4);
+  parallel.SetChunkSize(4096);
+  parallel.parse();
+  CallgrindParser reference("callgrind.out.18859");
+  reference.parse();
+  expectSameProfile(*reference.getProfile(), *parallel.getProfile());
+}
+
+TEST(CallgrindParser, Cache) {
+  const auto path = std::filesystem::temp_directory_path() / "cache.out";
+  const auto cache_path = ProfileCache::cachePath(path.string());
+  std::filesystem::copy_file("callgrind.out.18859", path,
+                             std::filesystem::copy_options::overwrite_existing);
+  std::filesystem::remove(cache_path);
+
+  CallgrindParser reference("callgrind.out.18859");
+  reference.parse();
+
+  CallgrindParser writer(path.string());
+  writer.SetCache(true);
+  writer.parse();
+  ASSERT_TRUE(std::filesystem::exists(cache_path));
+  EXPECT_EQ(writer.stats()->cache, "written");
+
+  CallgrindParser reader(path.string());
+  reader.SetCache(true);
+  reader.parse();
+  EXPECT_EQ(reader.stats()->cache, "loaded");
+  expectSameProfile(*reference.getProfile(), *reader.getProfile());
+  EXPECT_EQ(reader.progress().lines, reference.progress().lines);
+  EXPECT_EQ(reader.getSnapshot(), reader.getProfile());
+
+  /* a changed source makes the cache stale */
+  std::ofstream(path, std::ios::app) << "\nfn=added\n0 5\n";
+  CallgrindParser changed(path.string());
+  changed.SetCache(true);
+  changed.parse();
+  EXPECT_EQ(changed.getProfile()->functionCount(),
+            reference.getProfile()->functionCount() + 1);
+
+  /* a damaged cache is ignored */
+  std::filesystem::resize_file(cache_path,
+                               std::filesystem::file_size(cache_path) / 2);
+  CallgrindParser damaged(path.string());
+  damaged.SetCache(true);
+  damaged.parse();
+  EXPECT_EQ(damaged.getProfile()->functionCount(),
+            changed.getProfile()->functionCount());
+
+  std::filesystem::remove(path);
+  std::filesystem::remove(cache_path);
+}
+
+TEST(CallgrindParser, GzipInput) {
+  std::ifstream ifs("callgrind.out.18859", std::ios::binary);
+  const std::string content((std::istreambuf_iterator<char>(ifs)),
+                            std::istreambuf_iterator<char>());
+  const auto path = (std::filesystem::temp_directory_path() /
+                     "cursegrind.callgrind.out.gz")
+                        .string();
+  auto file = gzopen(path.c_str(), "wb");
+  gzwrite(file, content.data(), unsigned(content.size()));
+  gzclose(file);
+
+  CallgrindParser reference("callgrind.out.18859");
+  reference.parse();
+  CallgrindParser parser(path);
+  parser.parse();
+  expectSameProfile(*reference.getProfile(), *parser.getProfile());
+  EXPECT_EQ(parser.progress().lines, reference.progress().lines);
+  EXPECT_EQ(parser.progress().bytes_read, std::filesystem::file_size(path));
+  std::filesystem::remove(path);
+}
+
+TEST(CallgrindParser, MultiPartFile) {
+  /* the parts of a dump repeat the header and end with their totals */
+  auto filename = writeProfile("cursegrind.parts.out",
+                               "version: 1\n"
+                               "part: 1\n"
+                               "thread: 2\n"
+                               "positions: line\n"
+                               "events: Ir\n"
+                               "summary: 60\n"
+                               "\n"
+                               "fn=(1) main\n"
+                               "1 10\n"
+                               "cfn=(2) foo\n"
+                               "calls=1 1\n"
+                               "2 50\n"
+                               "\n"
+                               "fn=(2)\n"
+                               "1 50\n"
+                               "\n"
+                               "totals: 60\n"
+                               "part: 2\n"
+                               "positions: line\n"
+                               "events: Ir\n"
+                               "\n"
+                               "fn=(1)\n"
+                               "3 5\n"
+                               "\n"
+                               "totals: 5\n");
+  for (auto threads : {1u, 4u}) {
+    CallgrindParser parser(filename);
+    parser.SetThreads(threads);
+    parser.SetChunkSize(16);
+    parser.parse();
+
+    EXPECT_EQ(parser.parts(), 2);
+    EXPECT_EQ(parser.thread(), "2");
+    EXPECT_EQ(parser.totals(), (std::vector<CallgrindParser::Cost>{65}));
+    const auto &profile = *parser.getProfile();
+    ASSERT_EQ(profile.entries().size(), 2);
+    EXPECT_EQ(profile.symbol(profile.entries()[0]), "main");
+    EXPECT_EQ(profile.inclusiveCost(profile.entries()[0], 0), 65);
+  }
+}
+
+TEST(CallgrindParser, MultipleFiles) {
+  auto thread_1 = writeProfile("cursegrind.files.out-01",
+                               "thread: 1\n"
+                               "events: Ir Dr\n"
+                               "\n"
+                               "ob=(1) a.out\n"
+                               "fn=(1) main\n"
+                               "1 10 1\n"
+                               "cfn=(2) work\n"
+                               "calls=1 1\n"
+                               "2 50 5\n"
+                               "\n"
+                               "fn=(2)\n"
+                               "1 50 5\n"
+                               "\n"
+                               "totals: 60 6\n");
+  /* other compression ids for the same names */
+  auto thread_2 = writeProfile("cursegrind.files.out-02",
+                               "thread: 2\n"
+                               "events: Ir Dr\n"
+                               "\n"
+                               "ob=(3) a.out\n"
+                               "fn=(7) work\n"
+                               "4 30 3\n"
+                               "\n"
+                               "totals: 30 3\n");
+  for (auto threads : {1u, 2u}) {
+    CallgrindParser parser(std::vector<std::string>{thread_1, thread_2});
+    parser.SetThreads(threads);
+    parser.parse();
+
+    EXPECT_EQ(parser.totals(), (std::vector<CallgrindParser::Cost>{90, 9}));
+    const auto &profile = *parser.getProfile();
+    EXPECT_EQ(profile.functionCount(), 2);
+    ASSERT_EQ(profile.entries().size(), 2);
+    const auto work = profile.entries()[0];
+    EXPECT_EQ(profile.symbol(work), "work");
+    EXPECT_EQ(profile.inclusiveCost(work), (std::vector<Profile::Cost>{80, 8}));
+    EXPECT_EQ(profile.callers(work).size(), 1);
+  }
+
+  CallgrindParser parser(std::vector<std::string>{thread_1, thread_2});
+  parser.SetKeepParts(true);
+  parser.parse();
+  const auto &profile = *parser.getProfile();
+  EXPECT_EQ(profile.functionCount(), 3);
+  std::vector<std::string> objects;
+  for (auto function : profile.entries()) {
+    objects.emplace_back(profile.symbol(function));
+    objects.back() += " " + std::string(profile.object(function));
+  }
+  EXPECT_EQ(objects, (std::vector<std::string>{"main a.out [thread 1]",
+                                               "work a.out [thread 1]",
+                                               "work a.out [thread 2]"}));
+
+  auto other_events = writeProfile("cursegrind.files.other",
+                                   "events: Ir\n"
+                                   "\n"
+                                   "fn=(1) main\n"
+                                   "1 10\n");
+  CallgrindParser mismatch(std::vector<std::string>{thread_1, other_events});
+  EXPECT_THROW(mismatch.parse(), std::runtime_error);
+}
+
+TEST(CallgrindParser, Follow) {
+  const auto directory =
+      std::filesystem::temp_directory_path() / "cursegrind.follow";
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directory(directory);
+  const auto path = (directory / "callgrind.out.100").string();
+  std::ofstream(path) << "part: 1\n"
+                         "events: Ir\n"
+                         "\n"
+                         "fn=(1) main\n"
+                         "1 10\n"
+                         "cfn=(2) foo\n"
+                         "calls=1 1\n"
+                         "+1 50\n"
+                         "\n"
+                         "fn=(2)\n"
+                         "1 50\n"
+                         "\n";
+
+  CallgrindParser parser(path);
+  parser.SetFollow(true);
+  parser.parse();
+  auto inclusive = [&parser](std::string_view symbol) {
+    const auto profile = parser.getProfile();
+    for (auto function : profile->entries()) {
+      if (profile->symbol(function) == symbol) {
+        return profile->inclusiveCost(function, 0);
+      }
+    }
+    return Profile::Cost(0);
+  };
+  EXPECT_EQ(inclusive("main"), 60);
+  EXPECT_FALSE(parser.update());
+
+  /* the appended part goes on with the names and positions of the first */
+  std::ofstream(path, std::ios::app) << "part: 2\n"
+                                        "events: Ir\n"
+                                        "\n"
+                                        "fn=(2)\n"
+                                        "+1 5\n"
+                                        "\n"
+                                        "fn=(3) bar\n"
+                                        "* 7\n";
+  /* merged once it stayed the same */
+  EXPECT_FALSE(parser.update());
+  EXPECT_TRUE(parser.pending());
+  EXPECT_TRUE(parser.update());
+  EXPECT_FALSE(parser.pending());
+  EXPECT_EQ(inclusive("foo"), 55);
+  EXPECT_EQ(inclusive("bar"), 7);
+  EXPECT_EQ(parser.parts(), 2);
+  EXPECT_EQ(parser.getProfile()->functionCount(), 3);
+  /* with the rows for the annotation, as if parsed at once */
+  CallgrindParser at_once(path);
+  at_once.parse();
+  expectSameProfile(*at_once.getProfile(), *parser.getProfile());
+  EXPECT_EQ(parser.getEntries().size(), 3);
+
+  /* the lines appended go on with the entry the file ended in, a call is
+     merged once its cost line is there */
+  std::ofstream(path, std::ios::app) << "+1 3\n"
+                                        "cfn=(1)\n"
+                                        "calls=1 1\n";
+  EXPECT_FALSE(parser.update());
+  EXPECT_TRUE(parser.update());
+  EXPECT_TRUE(parser.pending());
+  EXPECT_EQ(inclusive("bar"), 10);
+  std::ofstream(path, std::ios::app) << "+1 4\n"
+                                        "\n";
+  EXPECT_FALSE(parser.update());
+  EXPECT_TRUE(parser.update());
+  EXPECT_FALSE(parser.pending());
+  EXPECT_EQ(inclusive("bar"), 14);
+  EXPECT_EQ(parser.getProfile()->functionCount(), 3);
+  at_once.parse();
+  expectSameProfile(*at_once.getProfile(), *parser.getProfile());
+
+  /* dumps of the run appear next to it, other files are left alone */
+  std::ofstream((directory / "callgrind.out.100.3").string())
+      << "events: Ir\n\nfn=(1) main\n1 3\n";
+  std::ofstream((directory / "other.out").string())
+      << "events: Ir\n\nfn=(1) other\n1 3\n";
+  EXPECT_FALSE(parser.update());
+  EXPECT_TRUE(parser.update());
+  EXPECT_EQ(inclusive("main"), 63);
+  EXPECT_EQ(parser.getEntries().front()->inclusive_cost.front(), 63);
+  EXPECT_EQ(inclusive("other"), 0);
+
+  /* a directory is followed for all the dumps in it */
+  CallgrindParser all(directory.string());
+  all.SetFollow(true);
+  all.parse();
+  EXPECT_EQ(all.getProfile()->entries().size(), 3);
+  EXPECT_EQ(all.followedDirectory(), directory.string());
+
+  /* a file written anew is parsed again, then the dumps next to it */
+  std::ofstream(path) << "events: Ir\n\nfn=(1) main\n1 1\n";
+  EXPECT_TRUE(parser.update());
+  EXPECT_EQ(inclusive("main"), 1);
+  EXPECT_EQ(inclusive("foo"), 0);
+  EXPECT_FALSE(parser.update());
+  EXPECT_TRUE(parser.update());
+  EXPECT_EQ(inclusive("main"), 4);
+
+  std::filesystem::remove_all(directory);
+}
+
+TEST(CallgrindParser, Stats) {
+  CallgrindParser parser("callgrind.out.18859");
+  EXPECT_EQ(parser.stats(), nullptr);
+  parser.parse();
+  const auto stats = parser.stats();
+  ASSERT_NE(stats, nullptr);
+  const auto &profile = *parser.getProfile();
+  EXPECT_EQ(stats->lines, parser.progress().lines);
+  EXPECT_EQ(stats->bytes, std::filesystem::file_size("callgrind.out.18859"));
+  EXPECT_EQ(stats->functions, profile.functionCount());
+  EXPECT_EQ(stats->calls, profile.callCount());
+  EXPECT_EQ(stats->cost_rows, profile.costRowCount());
+  EXPECT_EQ(stats->cache, "off");
+  EXPECT_GT(stats->seconds[ParseStats::kParse], 0);
+  EXPECT_GT(stats->peak_rss, 0);
+  for (auto seconds : stats->seconds) EXPECT_GE(seconds, 0);
+
+  std::stringstream json;
+  stats->writeJson(json);
+  EXPECT_NE(json.str().find("\"functions\": " +
+                            std::to_string(profile.functionCount())),
+            std::string::npos);
+  EXPECT_NE(json.str().find("\"link\": "), std::string::npos);
+
+  /* time goes to the innermost phase only */
+  ParseStats nested;
+  nested.start(ParseStats::kParse);
+  {
+    ParseStats::Scope merge(&nested, ParseStats::kMerge);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  nested.stop();
+  EXPECT_GE(nested.seconds[ParseStats::kMerge], 0.02);
+  EXPECT_LT(nested.seconds[ParseStats::kParse], 0.02);
+}
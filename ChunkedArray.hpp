@@ -0,0 +1,295 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CALLGRIND_VIEWER__CHUNKEDARRAY_HPP_
+#define CALLGRIND_VIEWER__CHUNKEDARRAY_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "Span.hpp"
+
+/* Array of rows of width values in chunks of kChunkRows rows, shared by
+   its copies. A copy takes the chunks instead of the rows, so an array
+   that keeps growing is copied for a reader in time proportional to its
+   chunks. A chunk is copied before one of its rows is written while it is
+   shared; rows appended to the array that made the chunk go in place past
+   the end of its copies, which never read them.
+
+   The rows appended at once are contiguous: they do not straddle chunks,
+   the rest of a chunk too small for them is left unused, and more rows
+   than a chunk holds get chunks laid out one after another. */
+template <typename T>
+class ChunkedArray {
+  static_assert(std::is_trivially_copyable_v<T>);
+
+ public:
+  static constexpr size_t kChunkShift = 10;
+  static constexpr size_t kChunkRows = size_t(1) << kChunkShift;
+
+  class const_iterator {
+   public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T *;
+    using reference = const T &;
+
+    const_iterator() = default;
+    const_iterator(const ChunkedArray *array, size_t row)
+        : array_(array), row_(row) {}
+
+    reference operator*() const { return (*array_)[row_]; }
+    pointer operator->() const { return &(*array_)[row_]; }
+    reference operator[](difference_type offset) const {
+      return (*array_)[row_ + offset];
+    }
+    const_iterator &operator++() {
+      ++row_;
+      return *this;
+    }
+    const_iterator operator++(int) {
+      auto old = *this;
+      ++row_;
+      return old;
+    }
+    const_iterator &operator--() {
+      --row_;
+      return *this;
+    }
+    const_iterator operator--(int) {
+      auto old = *this;
+      --row_;
+      return old;
+    }
+    const_iterator &operator+=(difference_type offset) {
+      row_ += offset;
+      return *this;
+    }
+    const_iterator &operator-=(difference_type offset) {
+      row_ -= offset;
+      return *this;
+    }
+    friend const_iterator operator+(const_iterator it,
+                                    difference_type offset) {
+      return it += offset;
+    }
+    friend const_iterator operator+(difference_type offset,
+                                    const_iterator it) {
+      return it += offset;
+    }
+    friend const_iterator operator-(const_iterator it,
+                                    difference_type offset) {
+      return it -= offset;
+    }
+    friend difference_type operator-(const const_iterator &lhs,
+                                     const const_iterator &rhs) {
+      return difference_type(lhs.row_) - difference_type(rhs.row_);
+    }
+    friend bool operator==(const const_iterator &lhs,
+                           const const_iterator &rhs) {
+      return lhs.row_ == rhs.row_;
+    }
+    friend bool operator!=(const const_iterator &lhs,
+                           const const_iterator &rhs) {
+      return lhs.row_ != rhs.row_;
+    }
+    friend bool operator<(const const_iterator &lhs,
+                          const const_iterator &rhs) {
+      return lhs.row_ < rhs.row_;
+    }
+    friend bool operator>(const const_iterator &lhs,
+                          const const_iterator &rhs) {
+      return lhs.row_ > rhs.row_;
+    }
+    friend bool operator<=(const const_iterator &lhs,
+                           const const_iterator &rhs) {
+      return lhs.row_ <= rhs.row_;
+    }
+    friend bool operator>=(const const_iterator &lhs,
+                           const const_iterator &rhs) {
+      return lhs.row_ >= rhs.row_;
+    }
+
+   private:
+    const ChunkedArray *array_{nullptr};
+    size_t row_{0};
+  };
+  using iterator = const_iterator;
+  using value_type = T;
+
+  explicit ChunkedArray(size_t width = 1) : width_(width) {}
+  /* the copy appends to a chunk it shares by copying the chunk */
+  ChunkedArray(const ChunkedArray &other)
+      : width_(other.width_),
+        size_(other.size_),
+        chunks_(other.chunks_),
+        owns_tail_(false) {}
+  ChunkedArray &operator=(const ChunkedArray &other) {
+    width_ = other.width_;
+    size_ = other.size_;
+    chunks_ = other.chunks_;
+    owns_tail_ = false;
+    return *this;
+  }
+  ChunkedArray(ChunkedArray &&other) noexcept { swap(other); }
+  ChunkedArray &operator=(ChunkedArray &&other) noexcept {
+    ChunkedArray moved(std::move(other));
+    swap(moved);
+    return *this;
+  }
+
+  void swap(ChunkedArray &other) noexcept {
+    std::swap(width_, other.width_);
+    std::swap(size_, other.size_);
+    chunks_.swap(other.chunks_);
+    std::swap(owns_tail_, other.owns_tail_);
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  size_t width() const { return width_; }
+  size_t chunkCount() const { return chunks_.size(); }
+
+  /* the first value of the row, the row itself for a width of one */
+  const T &operator[](size_t row) const {
+    assert(row < size_);
+    return chunks_[row >> kChunkShift][(row & kChunkMask) * width_];
+  }
+  Span<const T> row(size_t row) const { return {&(*this)[row], width_}; }
+  const T &front() const { return (*this)[0]; }
+  const T &back() const { return (*this)[size_ - 1]; }
+
+  const_iterator begin() const { return {this, 0}; }
+  const_iterator end() const { return {this, size_}; }
+
+  /* for writing the row now, its chunk is copied first if shared */
+  T *editRow(size_t row) {
+    assert(row < size_);
+    auto &chunk = chunks_[row >> kChunkShift];
+    /* other copies or the other chunks of its run hold it */
+    if (chunk.use_count() != 1) {
+      copyChunk(row >> kChunkShift);
+    } else {
+      /* the copies that released it are done reading it */
+      std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    return chunk.get() + (row & kChunkMask) * width_;
+  }
+  T &edit(size_t row) { return *editRow(row); }
+  T &editBack() { return edit(size_ - 1); }
+
+  /* returns the first of nrows contiguous new rows, value-initialized */
+  T *appendRows(size_t nrows) {
+    if (nrows == 0) return nullptr;
+    const auto slot = size_ & kChunkMask;
+    if (slot != 0 && slot + nrows <= kChunkRows) {
+      if (!owns_tail_) copyChunk(chunks_.size() - 1);
+      const auto rows = chunks_.back().get() + slot * width_;
+      size_ += nrows;
+      return rows;
+    }
+    if (slot != 0) size_ += kChunkRows - slot;
+    const auto nchunks = (nrows + kChunkMask) >> kChunkShift;
+    const auto chunk_size = kChunkRows * width_;
+    std::shared_ptr<T[]> run(new T[nchunks * chunk_size]());
+    for (size_t ichunk = 0; ichunk < nchunks; ++ichunk) {
+      chunks_.emplace_back(run, run.get() + ichunk * chunk_size);
+    }
+    owns_tail_ = true;
+    const auto rows = chunks_[size_ >> kChunkShift].get();
+    size_ += nrows;
+    return rows;
+  }
+  void push_back(const T &value) { *appendRows(1) = value; }
+
+  /* appends value-initialized rows up to nrows, without gaps */
+  void resize(size_t nrows) {
+    assert(nrows >= size_);
+    while (size_ < nrows) {
+      const auto slot = size_ & kChunkMask;
+      appendRows(std::min(nrows - size_, kChunkRows - slot));
+    }
+  }
+  void clear() {
+    chunks_.clear();
+    size_ = 0;
+    owns_tail_ = true;
+  }
+
+  /* the rows of values, width values each, contiguous */
+  void assign(const T *values, size_t nrows) {
+    clear();
+    if (nrows > 0) std::copy_n(values, nrows * width_, appendRows(nrows));
+  }
+  void assign(const std::vector<T> &values) {
+    assert(width_ > 0 && values.size() % width_ == 0);
+    assign(values.data(), width_ > 0 ? values.size() / width_ : 0);
+  }
+
+  /* calls handler(const T *rows, size_t nrows) for the runs of contiguous
+     rows in order */
+  template <typename RunHandler>
+  void forEachRun(RunHandler &&handler) const {
+    for (size_t row = 0; row < size_; row += kChunkRows) {
+      handler(chunks_[row >> kChunkShift].get(),
+              std::min(size_ - row, kChunkRows));
+    }
+  }
+
+  friend bool operator==(const ChunkedArray &lhs, const ChunkedArray &rhs) {
+    return lhs.width_ == rhs.width_ && lhs.size_ == rhs.size_ &&
+           std::equal(lhs.begin(), lhs.end(), rhs.begin());
+  }
+  friend bool operator==(const ChunkedArray &lhs, const std::vector<T> &rhs) {
+    return lhs.size_ == rhs.size() &&
+           std::equal(lhs.begin(), lhs.end(), rhs.begin());
+  }
+  friend bool operator==(const std::vector<T> &lhs, const ChunkedArray &rhs) {
+    return rhs == lhs;
+  }
+
+ private:
+  static constexpr size_t kChunkMask = kChunkRows - 1;
+
+  /* the rows of the copies sharing the chunk are only read, the ones past
+     their end may be written meanwhile and are not copied */
+  void copyChunk(size_t ichunk) {
+    const auto chunk_size = kChunkRows * width_;
+    std::shared_ptr<T[]> copy(new T[chunk_size]());
+    const auto nrows = std::min(size_ - (ichunk << kChunkShift), kChunkRows);
+    std::copy_n(chunks_[ichunk].get(), nrows * width_, copy.get());
+    chunks_[ichunk] = std::move(copy);
+    if (ichunk + 1 == chunks_.size()) owns_tail_ = true;
+  }
+
+  size_t width_{1};
+  size_t size_{0};
+  std::vector<std::shared_ptr<T[]> > chunks_;
+  /* rows are appended to the last chunk in place */
+  bool owns_tail_{true};
+};
+
+#endif  // CALLGRIND_VIEWER__CHUNKEDARRAY_HPP_
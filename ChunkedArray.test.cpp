@@ -0,0 +1,100 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ChunkedArray.hpp"
+
+#include <gtest/gtest.h>
+
+#include <numeric>
+
+TEST(ChunkedArray, Append) {
+  ChunkedArray<uint32_t> values;
+  /* enough values to span several chunks */
+  const uint32_t nvalues = 5000;
+  for (uint32_t i = 0; i < nvalues; ++i) values.push_back(i * 3);
+  ASSERT_EQ(values.size(), nvalues);
+  EXPECT_EQ(values.chunkCount(), 5);
+  EXPECT_EQ(values[4999], 4999 * 3);
+  EXPECT_TRUE(std::is_sorted(values.begin(), values.end()));
+  EXPECT_EQ(std::lower_bound(values.begin(), values.end(), 3001) -
+                values.begin(),
+            1001);
+  EXPECT_EQ(std::accumulate(values.begin(), values.end(), uint64_t(0)),
+            uint64_t(3) * nvalues * (nvalues - 1) / 2);
+
+  values.resize(6000);
+  EXPECT_EQ(values.back(), 0);
+  std::vector<uint32_t> copied(values.begin(), values.end());
+  ChunkedArray<uint32_t> assigned;
+  assigned.assign(copied);
+  EXPECT_EQ(assigned, values);
+  EXPECT_EQ(assigned, copied);
+}
+
+TEST(ChunkedArray, Share) {
+  ChunkedArray<uint64_t> values;
+  for (uint64_t i = 0; i < 1500; ++i) values.push_back(i);
+  const auto copy = values;
+
+  /* the rows appended later, into the shared chunk and new ones, are not
+     seen; a row written is copied out of the chunks the copy reads */
+  for (uint64_t i = 1500; i < 3000; ++i) values.push_back(i);
+  EXPECT_EQ(&copy[1200], &values[1200]);
+  values.edit(10) = 100;
+  values.edit(1499) = 200;
+  ASSERT_EQ(copy.size(), 1500);
+  EXPECT_EQ(copy[10], 10);
+  EXPECT_EQ(copy[1499], 1499);
+  EXPECT_EQ(values[10], 100);
+  EXPECT_EQ(values[1499], 200);
+  EXPECT_EQ(values[2999], 2999);
+  EXPECT_NE(&copy[1200], &values[1200]);
+
+  /* the copy appends to a copy of the chunk it shares */
+  auto grown = copy;
+  grown.push_back(7);
+  EXPECT_EQ(grown[1500], 7);
+  EXPECT_EQ(values[1500], 1500);
+  EXPECT_EQ(grown[1499], 1499);
+}
+
+TEST(ChunkedArray, Rows) {
+  ChunkedArray<uint64_t> rows(3);
+  auto first = rows.appendRows(1000);
+  first[999 * 3 + 2] = 5;
+  /* does not fit the rest of the chunk, so it starts the next one */
+  auto second = rows.appendRows(100);
+  second[0] = 7;
+  EXPECT_EQ(rows.size(), 1124);
+  EXPECT_EQ(rows.row(999)[2], 5);
+  EXPECT_EQ(rows[1024], 7);
+  EXPECT_EQ(rows.row(1024).size(), 3);
+
+  /* more rows than a chunk holds are contiguous all the same */
+  auto large = rows.appendRows(3000);
+  for (size_t value = 0; value < 3000 * 3; ++value) large[value] = value;
+  EXPECT_EQ(rows.size(), 2048 + 3000);
+  EXPECT_EQ(&rows.row(2048)[0] + 2999 * 3, &rows.row(5047)[0]);
+  EXPECT_EQ(rows.row(5047)[1], 2999 * 3 + 1);
+  size_t nrows = 0;
+  rows.forEachRun([&nrows](const uint64_t *, size_t count) {
+    nrows += count;
+  });
+  EXPECT_EQ(nrows, rows.size());
+}
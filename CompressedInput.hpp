@@ -0,0 +1,282 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CALLGRIND_VIEWER__COMPRESSEDINPUT_HPP_
+#define CALLGRIND_VIEWER__COMPRESSEDINPUT_HPP_
+
+#include <zlib.h>
+#ifdef CURSEGRIND_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/* Decompresses a gzip or zstd file on a thread of its own, handing out the
+   text in blocks of whole lines while the previous blocks are parsed. */
+class CompressedInput {
+ public:
+  enum class Compression { None, Gzip, Zstd };
+
+  static constexpr size_t kDefaultBlockSize = size_t(4) << 20;
+
+  struct Block {
+    /* complete lines, only the last block may lack the final '\n' */
+    std::string text;
+    /* compressed bytes consumed to produce the text so far */
+    uint64_t input_end{0};
+  };
+
+  /* by the magic number, a gzip file may also be a concatenation of gzip
+     members */
+  static Compression detect(const std::string &filename) {
+    unsigned char magic[4] = {};
+    std::ifstream ifs(filename, std::ios::binary);
+    ifs.read(reinterpret_cast<char *>(magic), sizeof(magic));
+    if (ifs.gcount() >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+      return Compression::Gzip;
+    }
+    if (ifs.gcount() == 4 && magic[0] == 0x28 && magic[1] == 0xb5 &&
+        magic[2] == 0x2f && magic[3] == 0xfd) {
+      return Compression::Zstd;
+    }
+    return Compression::None;
+  }
+
+  CompressedInput(const std::string &filename, Compression compression,
+                  size_t block_size = kDefaultBlockSize)
+      : block_size_(std::max<size_t>(block_size, 1)) {
+    decoder_ = makeDecoder(filename, compression);
+    thread_ = std::thread([this] { produce(); });
+  }
+
+  ~CompressedInput() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    changed_.notify_all();
+    thread_.join();
+  }
+
+  CompressedInput(const CompressedInput &) = delete;
+  CompressedInput &operator=(const CompressedInput &) = delete;
+
+  /* Replaces block with the next one, the old buffer is reused. Returns
+     false at the end of the input, throws if it cannot be decoded. */
+  bool next(Block &block) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [this] { return !ready_.empty() || finished_; });
+    if (ready_.empty()) {
+      if (error_) std::rethrow_exception(error_);
+      return false;
+    }
+    std::swap(block, ready_.front());
+    free_.push_back(std::move(ready_.front()));
+    ready_.pop_front();
+    lock.unlock();
+    changed_.notify_all();
+    return true;
+  }
+
+ private:
+  /* blocks decoded ahead of the parser */
+  static constexpr size_t kQueueBlocks = 4;
+
+  struct Decoder {
+    virtual ~Decoder() = default;
+    /* returns 0 at the end of the input */
+    virtual size_t read(char *buffer, size_t size) = 0;
+    virtual uint64_t consumed() const = 0;
+  };
+
+  struct GzipDecoder : Decoder {
+    explicit GzipDecoder(const std::string &filename)
+        : file(gzopen(filename.c_str(), "rb")) {
+      if (!file) throw std::runtime_error("Cannot open " + filename);
+      gzbuffer(file, 1 << 20);
+    }
+    ~GzipDecoder() override { gzclose(file); }
+
+    size_t read(char *buffer, size_t size) override {
+      const auto n = gzread(file, buffer, unsigned(std::min<size_t>(
+                                              size, 1u << 30)));
+      /* a truncated stream ends with Z_BUF_ERROR */
+      int error = Z_OK;
+      const auto message = n <= 0 ? gzerror(file, &error) : nullptr;
+      if (n < 0 || (error != Z_OK && error != Z_STREAM_END)) {
+        throw std::runtime_error(std::string("Cannot decompress: ") +
+                                 message);
+      }
+      return size_t(n);
+    }
+    uint64_t consumed() const override { return uint64_t(gzoffset(file)); }
+
+    gzFile file;
+  };
+
+#ifdef CURSEGRIND_WITH_ZSTD
+  struct ZstdDecoder : Decoder {
+    explicit ZstdDecoder(const std::string &filename)
+        : file(std::fopen(filename.c_str(), "rb")),
+          stream(ZSTD_createDStream()),
+          input_buffer(ZSTD_DStreamInSize()) {
+      if (!file) throw std::runtime_error("Cannot open " + filename);
+      ZSTD_initDStream(stream);
+    }
+    ~ZstdDecoder() override {
+      ZSTD_freeDStream(stream);
+      std::fclose(file);
+    }
+
+    size_t read(char *buffer, size_t size) override {
+      ZSTD_outBuffer output{buffer, size, 0};
+      while (output.pos < output.size) {
+        if (input.pos == input.size) {
+          input.size = std::fread(input_buffer.data(), 1,
+                                  input_buffer.size(), file);
+          input.src = input_buffer.data();
+          input.pos = 0;
+          consumed_bytes += input.size;
+          if (input.size == 0) {
+            if (frame_open) {
+              throw std::runtime_error("Truncated zstd input");
+            }
+            break;
+          }
+        }
+        const auto result = ZSTD_decompressStream(stream, &output, &input);
+        if (ZSTD_isError(result)) {
+          throw std::runtime_error(std::string("Cannot decompress: ") +
+                                   ZSTD_getErrorName(result));
+        }
+        frame_open = result != 0;
+      }
+      return output.pos;
+    }
+    uint64_t consumed() const override { return consumed_bytes; }
+
+    std::FILE *file;
+    ZSTD_DStream *stream;
+    std::vector<char> input_buffer;
+    ZSTD_inBuffer input{nullptr, 0, 0};
+    uint64_t consumed_bytes{0};
+    bool frame_open{false};
+  };
+#endif
+
+  static std::unique_ptr<Decoder> makeDecoder(const std::string &filename,
+                                              Compression compression) {
+    switch (compression) {
+      case Compression::Gzip:
+        return std::make_unique<GzipDecoder>(filename);
+      case Compression::Zstd:
+#ifdef CURSEGRIND_WITH_ZSTD
+        return std::make_unique<ZstdDecoder>(filename);
+#else
+        throw std::runtime_error("Built without zstd support: " + filename);
+#endif
+      case Compression::None:
+        break;
+    }
+    throw std::runtime_error("Not a compressed file: " + filename);
+  }
+
+  void produce() {
+    try {
+      /* the incomplete last line of the previous block */
+      std::string tail;
+      while (true) {
+        Block block;
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          changed_.wait(lock, [this] {
+            return stopping_ || ready_.size() < kQueueBlocks;
+          });
+          if (stopping_) return;
+          if (!free_.empty()) {
+            block = std::move(free_.back());
+            free_.pop_back();
+          }
+        }
+
+        block.text.swap(tail);
+        tail.clear();
+        const auto filled = block.text.size();
+        block.text.resize(filled + block_size_);
+        const auto nread = decoder_->read(block.text.data() + filled,
+                                          block_size_);
+        block.text.resize(filled + nread);
+        const bool end = nread == 0;
+        if (!end) {
+          const auto eol = block.text.rfind('\n');
+          if (eol == std::string::npos) {
+            /* a line longer than the block */
+            tail.swap(block.text);
+            continue;
+          }
+          tail.assign(block.text, eol + 1);
+          block.text.resize(eol + 1);
+        }
+        block.input_end = decoder_->consumed();
+
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          if (!block.text.empty()) ready_.push_back(std::move(block));
+          finished_ = end;
+        }
+        changed_.notify_all();
+        if (end) return;
+      }
+    } catch (...) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        error_ = std::current_exception();
+        finished_ = true;
+      }
+      changed_.notify_all();
+    }
+  }
+
+  size_t block_size_;
+  std::unique_ptr<Decoder> decoder_;
+
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  std::deque<Block> ready_;
+  std::vector<Block> free_;
+  bool finished_{false};
+  bool stopping_{false};
+  std::exception_ptr error_;
+  std::thread thread_;
+};
+
+#endif  // CALLGRIND_VIEWER__COMPRESSEDINPUT_HPP_
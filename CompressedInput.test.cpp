@@ -0,0 +1,109 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "CompressedInput.hpp"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+
+namespace {
+
+std::string writeGzip(const std::string &name, const std::string &content,
+                      int members = 1) {
+  auto path = (std::filesystem::temp_directory_path() / name).string();
+  auto file = gzopen(path.c_str(), "wb");
+  gzwrite(file, content.data(), unsigned(content.size()));
+  gzclose(file);
+  /* gzip members may be concatenated */
+  for (int member = 1; member < members; ++member) {
+    file = gzopen(path.c_str(), "ab");
+    gzwrite(file, content.data(), unsigned(content.size()));
+    gzclose(file);
+  }
+  return path;
+}
+
+std::string readAll(CompressedInput &input, size_t *nblocks = nullptr) {
+  std::string text;
+  CompressedInput::Block block;
+  size_t blocks = 0;
+  while (input.next(block)) {
+    text += block.text;
+    ++blocks;
+    if (block.text.back() != '\n') {
+      /* only the last block may end without a newline */
+      EXPECT_FALSE(input.next(block));
+      break;
+    }
+  }
+  if (nblocks) *nblocks = blocks;
+  return text;
+}
+
+}  // namespace
+
+TEST(CompressedInput, Detect) {
+  auto gzip = writeGzip("cursegrind.detect.gz", "events: Ir\n");
+  EXPECT_EQ(CompressedInput::detect(gzip), CompressedInput::Compression::Gzip);
+  EXPECT_EQ(CompressedInput::detect("callgrind.out.18859"),
+            CompressedInput::Compression::None);
+  EXPECT_EQ(CompressedInput::detect("empty.out"),
+            CompressedInput::Compression::None);
+  std::filesystem::remove(gzip);
+}
+
+TEST(CompressedInput, WholeLineBlocks) {
+  std::string content;
+  for (int line = 0; line < 1000; ++line) {
+    content += "line " + std::to_string(line) + "\n";
+    if (line % 100 == 0) content += std::string(300, 'x') + "\n";
+  }
+  content += "no newline";
+  auto path = writeGzip("cursegrind.blocks.gz", content, 2);
+
+  /* lines longer than a block are kept whole */
+  CompressedInput input(path, CompressedInput::Compression::Gzip, 64);
+  size_t nblocks = 0;
+  EXPECT_EQ(readAll(input, &nblocks), content + content);
+  EXPECT_GT(nblocks, 100);
+  std::filesystem::remove(path);
+}
+
+TEST(CompressedInput, Errors) {
+  EXPECT_THROW(CompressedInput("/nonexistent.gz",
+                               CompressedInput::Compression::Gzip),
+               std::runtime_error);
+
+  auto path = writeGzip("cursegrind.truncated.gz", std::string(100000, 'a'));
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) / 2);
+  CompressedInput input(path, CompressedInput::Compression::Gzip);
+  EXPECT_THROW(readAll(input), std::runtime_error);
+  std::filesystem::remove(path);
+}
+
+TEST(CompressedInput, StopsEarly) {
+  auto path = writeGzip("cursegrind.early.gz", std::string(1 << 20, '\n'));
+  {
+    CompressedInput input(path, CompressedInput::Compression::Gzip, 1024);
+    CompressedInput::Block block;
+    EXPECT_TRUE(input.next(block));
+  }
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,150 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef CALLGRIND_VIEWER__DISPLAYNAMES_HPP_
+#define CALLGRIND_VIEWER__DISPLAYNAMES_HPP_
+
+#include <array>
+#include <cassert>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "NameTable.hpp"
+#include "Profile.hpp"
+
+enum ENameView { kSymbolOnly, kFileSymbol, kObjectSymbol, kCollapsedSymbol };
+constexpr size_t kNameViewCount = 4;
+
+inline std::string short_path(std::string_view f) {
+  namespace fs = std::filesystem;
+  fs::path p(f);
+  return p.filename();
+}
+
+/* the symbol with its template arguments collapsed, e.g.
+   "std::vector<...>::push_back(int const&)"; the angle brackets of operator
+   names are kept, a symbol with unbalanced ones is left as it is */
+inline std::string collapseTemplates(std::string_view symbol) {
+  constexpr std::string_view kOperator = "operator";
+  constexpr std::string_view kOperatorChars = "<>=-";
+  std::string collapsed;
+  collapsed.reserve(symbol.size());
+  int depth = 0;
+  for (size_t pos = 0; pos < symbol.size(); ++pos) {
+    const auto c = symbol[pos];
+    if (depth == 0 && symbol.substr(pos, kOperator.size()) == kOperator) {
+      auto end = pos + kOperator.size();
+      while (end < symbol.size() &&
+             kOperatorChars.find(symbol[end]) != kOperatorChars.npos) {
+        ++end;
+      }
+      collapsed += symbol.substr(pos, end - pos);
+      pos = end - 1;
+    } else if (c == '<') {
+      if (depth++ == 0) collapsed += "<...>";
+    } else if (c == '>' && depth > 0) {
+      --depth;
+    } else if (depth == 0) {
+      collapsed += c;
+    }
+  }
+  return depth == 0 ? collapsed : std::string(symbol);
+}
+
+/* The names the tree shows for the functions of a profile in each name
+   view. The names of a view are made once, by build(), and interned in a
+   table of their own so that reading one is a lookup; the file and object
+   names without their directories are made once per name. The names made
+   are kept for a later snapshot of the profile, see extend(). */
+class DisplayNames {
+ public:
+  using FunctionId = Profile::FunctionId;
+  using NameId = NameTable::NameId;
+
+  explicit DisplayNames(const Profile &profile) : profile_(&profile) {}
+
+  const Profile &profile() const { return *profile_; }
+
+  void build(ENameView view) {
+    if (view == kSymbolOnly) return;
+    built_[view] = true;
+    const auto nfunctions = profile_->functionCount();
+    auto &names = names_[view];
+    names.reserve(nfunctions);
+    std::string name;
+    for (auto function = FunctionId(names.size()); function < nfunctions;
+         ++function) {
+      if (view == kCollapsedSymbol) {
+        name = collapseTemplates(profile_->symbol(function));
+      } else {
+        name = shortName(view == kFileSymbol ? profile_->fileName(function)
+                                             : profile_->objectName(function));
+        name += ":::";
+        name += profile_->symbol(function);
+      }
+      names.push_back(pool_.intern(name));
+    }
+  }
+
+  /* Switches to a later snapshot of the profile, whose ids mean the same
+     (see Profile::sameIds()); the views built get the names of the
+     functions added since. */
+  void extend(const Profile &later) {
+    assert(later.sameIds(*profile_) &&
+           later.functionCount() >= profile_->functionCount());
+    profile_ = &later;
+    for (size_t view = 0; view < kNameViewCount; ++view) {
+      if (built_[view]) build(ENameView(view));
+    }
+  }
+
+  /* build() has made the names of view */
+  std::string_view name(FunctionId function, ENameView view) const {
+    if (view == kSymbolOnly) return profile_->symbol(function);
+    assert(names_[view].size() == profile_->functionCount());
+    return pool_[names_[view][function]];
+  }
+
+  /* the file or object name of the profile without its directory */
+  std::string_view shortName(NameId name) {
+    if (short_names_.size() <= name) {
+      short_names_.resize(profile_->names().size(), kNotMade);
+    }
+    if (short_names_[name] == kNotMade) {
+      short_names_[name] = pool_.intern(short_path(profile_->names()[name]));
+    }
+    return pool_[short_names_[name]];
+  }
+
+ private:
+  static constexpr NameId kNotMade = NameId(-1);
+
+  const Profile *profile_;
+  NameTable pool_;
+  /* by view, then function */
+  std::array<std::vector<NameId>, kNameViewCount> names_;
+  std::array<bool, kNameViewCount> built_{};
+  /* by name of the profile */
+  std::vector<NameId> short_names_;
+};
+
+#endif  // CALLGRIND_VIEWER__DISPLAYNAMES_HPP_
@@ -0,0 +1,104 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "DisplayNames.hpp"
+
+#include <gtest/gtest.h>
+
+TEST(DisplayNames, CollapseTemplates) {
+  EXPECT_EQ(collapseTemplates("main"), "main");
+  EXPECT_EQ(collapseTemplates("std::vector<int, std::allocator<int> >::"
+                              "push_back(int const&)"),
+            "std::vector<...>::push_back(int const&)");
+  EXPECT_EQ(collapseTemplates("void f<std::pair<int, int> >(int)"),
+            "void f<...>(int)");
+  EXPECT_EQ(collapseTemplates("bool operator<(A const&, A const&)"),
+            "bool operator<(A const&, A const&)");
+  EXPECT_EQ(collapseTemplates("S<int>::operator<<=(int)"),
+            "S<...>::operator<<=(int)");
+  EXPECT_EQ(collapseTemplates("S<int>::operator->() const"),
+            "S<...>::operator->() const");
+  EXPECT_EQ(collapseTemplates("bool operator< <A>(A const&, A const&)"),
+            "bool operator< <...>(A const&, A const&)");
+  /* unbalanced */
+  EXPECT_EQ(collapseTemplates("f<int(int)"), "f<int(int)");
+}
+
+TEST(DisplayNames, Views) {
+  Profile profile;
+  profile.setPositions({"line"});
+  profile.setEvents({"Ir"});
+  auto object = profile.names().intern("/usr/lib/libfoo.so");
+  auto file = profile.names().intern("/src/foo.cpp");
+  const auto foo =
+      profile.addFunction(object, file, profile.names().intern("foo<int>()"));
+  const auto bar =
+      profile.addFunction(object, file, profile.names().intern("bar"));
+  const Profile::SubPosition line[] = {1};
+  const Profile::Cost cost[] = {1};
+  profile.addCost(foo, line, cost);
+  profile.addCost(bar, line, cost);
+  profile.finalize();
+
+  DisplayNames names(profile);
+  EXPECT_EQ(names.name(foo, kSymbolOnly), "foo<int>()");
+  for (auto view : {kFileSymbol, kObjectSymbol, kCollapsedSymbol}) {
+    names.build(view);
+  }
+  EXPECT_EQ(names.name(foo, kFileSymbol), "foo.cpp:::foo<int>()");
+  EXPECT_EQ(names.name(bar, kFileSymbol), "foo.cpp:::bar");
+  EXPECT_EQ(names.name(foo, kObjectSymbol), "libfoo.so:::foo<int>()");
+  EXPECT_EQ(names.name(foo, kCollapsedSymbol), "foo<...>()");
+  EXPECT_EQ(names.name(bar, kCollapsedSymbol), "bar");
+  EXPECT_EQ(names.shortName(file), "foo.cpp");
+  /* the names are kept */
+  EXPECT_EQ(names.name(bar, kFileSymbol).data(),
+            names.name(bar, kFileSymbol).data());
+}
+
+TEST(DisplayNames, Extend) {
+  auto profile = std::make_shared<Profile>();
+  profile->setPositions({"line"});
+  profile->setEvents({"Ir"});
+  auto &table = profile->names();
+  const auto object = table.intern("a.out");
+  const auto file = table.intern("/src/a.c");
+  const Profile::SubPosition line[] = {1};
+  const Profile::Cost cost[] = {1};
+  const auto foo = profile->addFunction(object, file, table.intern("foo"));
+  profile->addCost(foo, line, cost);
+  const auto first = profile->snapshot();
+
+  DisplayNames names(*first);
+  names.build(kFileSymbol);
+  const auto bar = profile->addFunction(object, file, table.intern("bar"));
+  profile->addCost(bar, line, cost);
+  const auto second = profile->snapshot();
+  ASSERT_TRUE(second->sameIds(*first));
+  EXPECT_TRUE(profile->sameIds(*second));
+  EXPECT_FALSE(second->sameIds(Profile()));
+
+  /* the names made before stay, the ones of the new functions are made */
+  const auto foo_name = names.name(foo, kFileSymbol);
+  names.extend(*second);
+  EXPECT_EQ(&names.profile(), second.get());
+  EXPECT_EQ(names.name(foo, kFileSymbol).data(), foo_name.data());
+  EXPECT_EQ(names.name(bar, kFileSymbol), "a.c:::bar");
+}
@@ -0,0 +1,84 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef CALLGRIND_VIEWER__FILEWATCHER_HPP_
+#define CALLGRIND_VIEWER__FILEWATCHER_HPP_
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+/* Wakes a follower when the files of a directory change, so it need not
+   poll them often: inotify on Linux, plain sleeping elsewhere or when the
+   directory cannot be watched. */
+class FileWatcher {
+ public:
+  explicit FileWatcher(const std::string &directory) {
+#ifdef __linux__
+    fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd_ >= 0 &&
+        inotify_add_watch(fd_, directory.c_str(),
+                          IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE |
+                              IN_MOVED_TO | IN_DELETE) < 0) {
+      close(fd_);
+      fd_ = -1;
+    }
+#else
+    (void)directory;
+#endif
+  }
+  ~FileWatcher() {
+#ifdef __linux__
+    if (fd_ >= 0) close(fd_);
+#endif
+  }
+  FileWatcher(const FileWatcher &) = delete;
+  FileWatcher &operator=(const FileWatcher &) = delete;
+
+  bool watching() const { return fd_ >= 0; }
+
+  /* waits for a change or the timeout, returns whether something changed;
+     the changes reported at once are consumed together */
+  bool wait(std::chrono::milliseconds timeout) {
+#ifdef __linux__
+    if (fd_ >= 0) {
+      pollfd poll_fd{fd_, POLLIN, 0};
+      if (poll(&poll_fd, 1, int(timeout.count())) <= 0) return false;
+      alignas(inotify_event) char events[4096];
+      bool changed = false;
+      while (read(fd_, events, sizeof(events)) > 0) changed = true;
+      return changed;
+    }
+#endif
+    std::this_thread::sleep_for(timeout);
+    return false;
+  }
+
+ private:
+  int fd_{-1};
+};
+
+#endif  // CALLGRIND_VIEWER__FILEWATCHER_HPP_
@@ -0,0 +1,106 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CALLGRIND_VIEWER__MAPPEDFILE_HPP_
+#define CALLGRIND_VIEWER__MAPPEDFILE_HPP_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+
+/* Read-only mapping of a whole regular file. Pages are loaded lazily by the
+   kernel, so mapping a multi-GB file is cheap until it is actually read. */
+class MappedFile {
+ public:
+  MappedFile() = default;
+  explicit MappedFile(const std::string &filename) { map(filename); }
+  ~MappedFile() { unmap(); }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  MappedFile(MappedFile &&other) noexcept
+      : data_(std::exchange(other.data_, nullptr)),
+        size_(std::exchange(other.size_, 0)) {}
+  MappedFile &operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+      unmap();
+      data_ = std::exchange(other.data_, nullptr);
+      size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+  }
+
+  /* returns false if the file cannot be mapped (missing, empty, not a regular
+     file), the caller is expected to fall back to stream reading */
+  bool map(const std::string &filename) {
+    unmap();
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st {};
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+      ::close(fd);
+      return false;
+    }
+    void *data = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) return false;
+    ::madvise(data, st.st_size, MADV_SEQUENTIAL);
+    data_ = static_cast<const char *>(data);
+    size_ = st.st_size;
+    return true;
+  }
+
+  void unmap() {
+    if (data_) {
+      ::munmap(const_cast<char *>(data_), size_);
+      data_ = nullptr;
+      size_ = 0;
+    }
+  }
+
+  explicit operator bool() const { return data_ != nullptr; }
+  std::string_view view() const { return {data_, size_}; }
+  size_t size() const { return size_; }
+
+  /* calls handler(std::string_view line) for every line of the text, the
+     trailing '\n' is not included */
+  template <typename LineHandler>
+  static void forEachLine(std::string_view text, LineHandler &&handler) {
+    const char *pos = text.data();
+    const char *end = text.data() + text.size();
+    while (pos < end) {
+      auto eol = static_cast<const char *>(std::memchr(pos, '\n', end - pos));
+      if (!eol) eol = end;
+      handler(std::string_view(pos, eol - pos));
+      pos = eol + 1;
+    }
+  }
+
+ private:
+  const char *data_{nullptr};
+  size_t size_{0};
+};
+
+#endif  // CALLGRIND_VIEWER__MAPPEDFILE_HPP_
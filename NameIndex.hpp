@@ -0,0 +1,137 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CALLGRIND_VIEWER__NAMEINDEX_HPP_
+#define CALLGRIND_VIEWER__NAMEINDEX_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "NameTable.hpp"
+
+/* Trigram index of a NameTable for substring search.
+
+   Trigrams are hashed into 2^20 buckets, each with the sorted ids of the
+   names containing one of its trigrams. A query intersects the buckets of
+   its trigrams, so only names that likely contain it are compared;
+   queries shorter than a trigram scan the table. */
+class NameIndex {
+ public:
+  using NameId = NameTable::NameId;
+
+  /* the table must outlive the index and not grow */
+  explicit NameIndex(const NameTable &names) : names_(&names) {
+    offsets_.assign(kBuckets + 1, 0);
+    std::vector<uint32_t> buckets;
+    /* counts, then fills the postings */
+    for (NameId id = 0; id < names.size(); ++id) {
+      nameBuckets(names[id], buckets);
+      for (auto bucket : buckets) offsets_[bucket + 1]++;
+    }
+    for (size_t ibucket = 0; ibucket < kBuckets; ++ibucket) {
+      offsets_[ibucket + 1] += offsets_[ibucket];
+    }
+    postings_.resize(offsets_.back());
+    auto positions = offsets_;
+    for (NameId id = 0; id < names.size(); ++id) {
+      nameBuckets(names[id], buckets);
+      for (auto bucket : buckets) postings_[positions[bucket]++] = id;
+    }
+  }
+
+  /* ids of the names containing text, in id order */
+  std::vector<NameId> find(std::string_view text) const {
+    std::vector<NameId> found;
+    if (text.size() < 3) {
+      for (NameId id = 0; id < names_->size(); ++id) {
+        if ((*names_)[id].find(text) != std::string_view::npos) {
+          found.push_back(id);
+        }
+      }
+      return found;
+    }
+
+    std::vector<uint32_t> buckets;
+    nameBuckets(text, buckets);
+    /* the shortest posting list first, the candidates only shrink */
+    std::sort(begin(buckets), end(buckets), [this](uint32_t lhs, uint32_t rhs) {
+      return bucketSize(lhs) < bucketSize(rhs);
+    });
+    found.assign(postings_.begin() + offsets_[buckets[0]],
+                 postings_.begin() + offsets_[buckets[0] + 1]);
+    for (size_t ibucket = 1; ibucket < buckets.size() && !found.empty();
+         ++ibucket) {
+      const auto first = postings_.begin() + offsets_[buckets[ibucket]];
+      const auto last = postings_.begin() + offsets_[buckets[ibucket] + 1];
+      found.erase(std::remove_if(begin(found), end(found),
+                                 [first, last](NameId id) {
+                                   return !std::binary_search(first, last, id);
+                                 }),
+                  end(found));
+    }
+    return refine(text, found);
+  }
+
+  /* the names of candidates which contain text, for a query extending the
+     one that found the candidates */
+  std::vector<NameId> refine(std::string_view text,
+                             const std::vector<NameId> &candidates) const {
+    std::vector<NameId> found;
+    for (auto id : candidates) {
+      if ((*names_)[id].find(text) != std::string_view::npos) {
+        found.push_back(id);
+      }
+    }
+    return found;
+  }
+
+ private:
+  static constexpr unsigned kBucketBits = 20;
+  static constexpr size_t kBuckets = size_t(1) << kBucketBits;
+
+  static uint32_t bucket(std::string_view trigram) {
+    const uint32_t key = uint32_t(uint8_t(trigram[0])) << 16 |
+                         uint32_t(uint8_t(trigram[1])) << 8 |
+                         uint32_t(uint8_t(trigram[2]));
+    return (key * 0x9E3779B1u) >> (32 - kBucketBits);
+  }
+
+  /* distinct buckets of the trigrams of name */
+  static void nameBuckets(std::string_view name,
+                          std::vector<uint32_t> &buckets) {
+    buckets.clear();
+    for (size_t pos = 0; pos + 3 <= name.size(); ++pos) {
+      buckets.push_back(bucket(name.substr(pos, 3)));
+    }
+    std::sort(begin(buckets), end(buckets));
+    buckets.erase(std::unique(begin(buckets), end(buckets)), end(buckets));
+  }
+
+  size_t bucketSize(uint32_t bucket) const {
+    return offsets_[bucket + 1] - offsets_[bucket];
+  }
+
+  const NameTable *names_;
+  std::vector<uint32_t> offsets_;
+  std::vector<NameId> postings_;
+};
+
+#endif  // CALLGRIND_VIEWER__NAMEINDEX_HPP_
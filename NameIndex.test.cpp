@@ -0,0 +1,73 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "NameIndex.hpp"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+
+namespace {
+
+std::vector<NameTable::NameId> bruteForce(const NameTable &names,
+                                          std::string_view text) {
+  std::vector<NameTable::NameId> found;
+  for (NameTable::NameId id = 0; id < names.size(); ++id) {
+    if (names[id].find(text) != std::string_view::npos) found.push_back(id);
+  }
+  return found;
+}
+
+}  // namespace
+
+TEST(NameIndex, Find) {
+  NameTable names;
+  const auto alloc = names.intern("std::allocator<char>::allocate");
+  const auto vector = names.intern("std::vector<int>::push_back");
+  const auto main = names.intern("main");
+  names.reserve();
+  NameIndex index(names);
+
+  using Ids = std::vector<NameTable::NameId>;
+  EXPECT_EQ(index.find("alloc"), (Ids{alloc}));
+  EXPECT_EQ(index.find("std::"), (Ids{alloc, vector}));
+  EXPECT_EQ(index.find("ma"), (Ids{main}));
+  EXPECT_EQ(index.find("main"), (Ids{main}));
+  EXPECT_EQ(index.find("nomatch"), Ids{});
+  EXPECT_EQ(index.refine("vector", index.find("std::")), (Ids{vector}));
+  /* the empty string is in every name */
+  EXPECT_EQ(index.find("").size(), names.size());
+}
+
+TEST(NameIndex, RandomNames) {
+  std::mt19937 random(7);
+  NameTable names;
+  for (int iname = 0; iname < 3000; ++iname) {
+    std::string name(3 + random() % 30, ' ');
+    for (auto &c : name) c = "abcdef:_<>"[random() % 10];
+    names.intern(name);
+  }
+  NameIndex index(names);
+  for (int iquery = 0; iquery < 300; ++iquery) {
+    std::string query(1 + random() % 6, ' ');
+    for (auto &c : query) c = "abcdef:_<>"[random() % 10];
+    EXPECT_EQ(index.find(query), bruteForce(names, query)) << query;
+  }
+}
@@ -0,0 +1,117 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CALLGRIND_VIEWER__NAMEMATCHER_HPP_
+#define CALLGRIND_VIEWER__NAMEMATCHER_HPP_
+
+#include <algorithm>
+#include <cctype>
+#include <future>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "NameTable.hpp"
+#include "ThreadPool.hpp"
+
+/* A search pattern compiled once and run against names: a substring, an
+   ECMAScript regular expression, or fuzzy, the characters of the pattern in
+   that order with anything between them, ignoring case. */
+class NameMatcher {
+ public:
+  enum class Mode { Substring, Regex, Fuzzy };
+  using NameId = NameTable::NameId;
+
+  /* throws std::regex_error for an invalid regular expression */
+  NameMatcher(Mode mode, std::string pattern)
+      : mode_(mode), pattern_(std::move(pattern)) {
+    if (mode_ == Mode::Regex) {
+      regex_.assign(pattern_, std::regex::ECMAScript | std::regex::optimize);
+    } else if (mode_ == Mode::Fuzzy) {
+      for (auto &c : pattern_) c = lower(c);
+    }
+  }
+
+  Mode mode() const { return mode_; }
+
+  bool matches(std::string_view name) const {
+    switch (mode_) {
+      case Mode::Substring:
+        return name.find(pattern_) != std::string_view::npos;
+      case Mode::Regex:
+        return std::regex_search(name.begin(), name.end(), regex_);
+      case Mode::Fuzzy: {
+        size_t matched = 0;
+        for (size_t pos = 0; pos < name.size() && matched < pattern_.size();
+             ++pos) {
+          if (lower(name[pos]) == pattern_[matched]) ++matched;
+        }
+        return matched == pattern_.size();
+      }
+    }
+    return false;
+  }
+
+  /* ids of the matching names in id order; big tables are split among the
+     threads of pool when one is given */
+  std::vector<NameId> findAll(const NameTable &names,
+                              ThreadPool *pool = nullptr) const {
+    const size_t chunks =
+        pool && names.size() >= kParallelNames ? pool->size() * 4 : 1;
+    const size_t chunk_size = (names.size() + chunks - 1) / chunks;
+    std::vector<std::vector<NameId> > found(chunks);
+    const auto find_chunk = [this, &names, &found, chunk_size](size_t ichunk) {
+      const auto last = std::min(names.size(), (ichunk + 1) * chunk_size);
+      for (auto id = NameId(ichunk * chunk_size); id < last; ++id) {
+        if (matches(names[id])) found[ichunk].push_back(id);
+      }
+    };
+    if (chunks == 1) {
+      find_chunk(0);
+      return std::move(found[0]);
+    }
+
+    std::vector<std::future<void> > done;
+    done.reserve(chunks);
+    for (size_t ichunk = 0; ichunk < chunks; ++ichunk) {
+      /* before what the pool still has queued, the user is waiting */
+      done.push_back(
+          pool->submit([&find_chunk, ichunk] { find_chunk(ichunk); }, true));
+    }
+    for (auto &chunk_done : done) chunk_done.get();
+    std::vector<NameId> all;
+    for (auto &chunk : found) all.insert(all.end(), begin(chunk), end(chunk));
+    return all;
+  }
+
+ private:
+  /* names below which the threads cost more than they save */
+  static constexpr size_t kParallelNames = size_t(1) << 14;
+
+  static char lower(char c) {
+    return char(std::tolower(static_cast<unsigned char>(c)));
+  }
+
+  Mode mode_;
+  std::string pattern_;
+  std::regex regex_;
+};
+
+#endif  // CALLGRIND_VIEWER__NAMEMATCHER_HPP_
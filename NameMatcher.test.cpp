@@ -0,0 +1,59 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "NameMatcher.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+using Mode = NameMatcher::Mode;
+
+TEST(NameMatcher, Modes) {
+  const NameMatcher substring(Mode::Substring, "alloc");
+  EXPECT_TRUE(substring.matches("std::allocator<char>"));
+  EXPECT_FALSE(substring.matches("std::Allocator<char>"));
+
+  const NameMatcher regex(Mode::Regex, "^std::.*allocator");
+  EXPECT_TRUE(regex.matches("std::vector<int, std::allocator<int> >"));
+  EXPECT_FALSE(regex.matches("__gnu_cxx::new_allocator<int>"));
+
+  const NameMatcher fuzzy(Mode::Fuzzy, "ZNSt6VecPush");
+  EXPECT_TRUE(fuzzy.matches("_ZNSt6vectorIiSaIiEE9push_backERKi"));
+  EXPECT_FALSE(fuzzy.matches("_ZNSt6vectorIiSaIiEE8pop_backEv"));
+  EXPECT_TRUE(NameMatcher(Mode::Fuzzy, "").matches("main"));
+
+  EXPECT_THROW(NameMatcher(Mode::Regex, "std::("), std::regex_error);
+}
+
+TEST(NameMatcher, FindAllInParallel) {
+  NameTable names;
+  for (int iname = 0; iname < 50000; ++iname) {
+    names.intern((iname % 7 == 0 ? "std::" : "ns::") + std::to_string(iname));
+  }
+  ThreadPool pool(3);
+  for (auto mode : {Mode::Substring, Mode::Regex, Mode::Fuzzy}) {
+    const NameMatcher matcher(mode, mode == Mode::Regex ? "^std::.*9$" : "d:");
+    const auto found = matcher.findAll(names);
+    EXPECT_FALSE(found.empty());
+    EXPECT_TRUE(std::is_sorted(begin(found), end(found)));
+    for (auto id : found) EXPECT_TRUE(matcher.matches(names[id]));
+    EXPECT_EQ(matcher.findAll(names, &pool), found);
+  }
+}
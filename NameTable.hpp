@@ -0,0 +1,87 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CALLGRIND_VIEWER__NAMETABLE_HPP_
+#define CALLGRIND_VIEWER__NAMETABLE_HPP_
+
+#include <cassert>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "ChunkedArray.hpp"
+
+/* Interned object, file and symbol names. Every distinct name is stored once
+   and identified by a dense id; id 0 is the empty name. */
+class NameTable {
+ public:
+  using NameId = uint32_t;
+  static constexpr NameId kEmpty = 0;
+
+  NameTable() { intern({}); }
+
+  NameTable(const NameTable &) = delete;
+  NameTable &operator=(const NameTable &) = delete;
+
+  /* Reads the names other has now instead of copying them, sharing the
+     chunks of their views; they never move and other may go on interning.
+     Other must outlive the table, which must be new and becomes
+     read-only. */
+  void share(const NameTable &other) {
+    assert(views_.size() == 1);
+    views_ = other.views_;
+    names_.clear();
+    ids_.clear();
+  }
+
+  NameId intern(std::string_view name) {
+    assert(names_.size() == views_.size());
+    auto found = ids_.find(name);
+    if (found != end(ids_)) {
+      return found->second;
+    }
+    /* std::deque never relocates its elements, so views stay valid */
+    const auto &stored = names_.emplace_back(name);
+    const auto id = NameId(views_.size());
+    views_.push_back(stored);
+    ids_.emplace(stored, id);
+    return id;
+  }
+
+  /* id with an empty name that intern() never returns, a placeholder for a
+     name which is not known yet */
+  NameId reserve() {
+    assert(names_.size() == views_.size());
+    views_.push_back(names_.emplace_back());
+    return NameId(views_.size() - 1);
+  }
+
+  std::string_view operator[](NameId id) const { return views_[id]; }
+  size_t size() const { return views_.size(); }
+
+ private:
+  std::deque<std::string> names_;
+  /* by id, into names_ or the names of the table shared */
+  ChunkedArray<std::string_view> views_;
+  std::unordered_map<std::string_view, NameId> ids_;
+};
+
+#endif  // CALLGRIND_VIEWER__NAMETABLE_HPP_
@@ -0,0 +1,350 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CALLGRIND_VIEWER__OUTLINELIST_HPP_
+#define CALLGRIND_VIEWER__OUTLINELIST_HPP_
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/* Rows of an outline: values with a nesting level, some of them selectable.
+
+   An implicit treap keyed by position, with the subtree size, the number of
+   selectable and of top-level rows and the minimal level kept in every
+   node. Inserting or erasing a run of k rows costs O(k + log n); indexing
+   and finding the next selectable row, the end of a subtree of the outline
+   or the k-th top-level row cost O(log n). */
+template <typename T>
+class OutlineList {
+ public:
+  static constexpr size_t npos = size_t(-1);
+
+  struct Row {
+    T value;
+    int level{0};
+    bool selectable{true};
+  };
+
+  OutlineList() = default;
+
+  size_t size() const { return size(root_); }
+  bool empty() const { return root_ == kNil; }
+
+  T &operator[](size_t index) { return nodes_[find(index)].row.value; }
+  const T &operator[](size_t index) const {
+    return nodes_[find(index)].row.value;
+  }
+  const Row &row(size_t index) const { return nodes_[find(index)].row; }
+
+  void clear() {
+    nodes_.clear();
+    free_.clear();
+    root_ = kNil;
+  }
+
+  /* inserts the rows before index */
+  void insert(size_t index, std::vector<Row> rows) {
+    assert(index <= size());
+    if (rows.empty()) return;
+    auto [left, right] = split(root_, index);
+    root_ = merge(merge(left, build(std::move(rows))), right);
+  }
+
+  /* erases the rows [first, last) */
+  void erase(size_t first, size_t last) {
+    assert(first <= last && last <= size());
+    if (first == last) return;
+    auto [left, rest] = split(root_, first);
+    auto [middle, right] = split(rest, last - first);
+    release(middle);
+    root_ = merge(left, right);
+  }
+
+  /* first selectable row after index, npos for none; index may be npos to
+     search from the beginning */
+  size_t nextSelectable(size_t index) const {
+    return findFirst(
+        root_, 0, index == npos ? 0 : index + 1,
+        [this](uint32_t node) { return nodes_[node].selectable_count > 0; },
+        [](const Row &row) { return row.selectable; });
+  }
+  /* last selectable row before index, npos for none */
+  size_t prevSelectable(size_t index) const {
+    if (index == 0) return npos;
+    return findLast(
+        root_, 0, index - 1,
+        [this](uint32_t node) { return nodes_[node].selectable_count > 0; },
+        [](const Row &row) { return row.selectable; });
+  }
+
+  /* first row after index with a level not above level, size() for none:
+     the end of the outline subtree of a row of that level */
+  size_t nextAtLevel(size_t index, int level) const {
+    const auto found = findFirst(
+        root_, 0, index + 1,
+        [this, level](uint32_t node) {
+          return nodes_[node].min_level <= level;
+        },
+        [level](const Row &row) { return row.level <= level; });
+    return found == npos ? size() : found;
+  }
+  /* last row before index with a level below level, npos for none: the
+     outline parent of a row of that level */
+  size_t prevBelowLevel(size_t index, int level) const {
+    if (index == 0) return npos;
+    return findLast(
+        root_, 0, index - 1,
+        [this, level](uint32_t node) {
+          return nodes_[node].min_level < level;
+        },
+        [level](const Row &row) { return row.level < level; });
+  }
+
+  /* index of the k-th row of level 0, npos if there are not that many */
+  size_t root(size_t k) const {
+    auto node = root_;
+    size_t base = 0;
+    while (node != kNil) {
+      const auto &n = nodes_[node];
+      const auto left_roots = rootCount(n.left);
+      if (k < left_roots) {
+        node = n.left;
+        continue;
+      }
+      k -= left_roots;
+      base += size(n.left);
+      if (n.row.level == 0) {
+        if (k == 0) return base;
+        --k;
+      }
+      base += 1;
+      node = n.right;
+    }
+    return npos;
+  }
+
+  /* visit(index, row) in order */
+  template <typename Visitor>
+  void forEach(Visitor &&visit) const {
+    size_t index = 0;
+    forEach(root_, index, visit);
+  }
+  template <typename Visitor>
+  void forEachValue(Visitor &&visit) {
+    forEachValue(root_, visit);
+  }
+
+ private:
+  static constexpr uint32_t kNil = UINT32_MAX;
+
+  struct Node {
+    Row row;
+    uint32_t priority;
+    uint32_t left{kNil};
+    uint32_t right{kNil};
+    uint32_t size{1};
+    uint32_t selectable_count{0};
+    uint32_t root_count{0};
+    int min_level{INT_MAX};
+  };
+
+  size_t size(uint32_t node) const {
+    return node == kNil ? 0 : nodes_[node].size;
+  }
+
+  size_t rootCount(uint32_t node) const {
+    return node == kNil ? 0 : nodes_[node].root_count;
+  }
+
+  void update(uint32_t node) {
+    auto &n = nodes_[node];
+    n.size = 1;
+    n.selectable_count = n.row.selectable;
+    n.root_count = n.row.level == 0;
+    n.min_level = n.row.level;
+    for (auto child : {n.left, n.right}) {
+      if (child == kNil) continue;
+      const auto &c = nodes_[child];
+      n.size += c.size;
+      n.selectable_count += c.selectable_count;
+      n.root_count += c.root_count;
+      n.min_level = std::min(n.min_level, c.min_level);
+    }
+  }
+
+  uint32_t random() {
+    /* xorshift32 */
+    seed_ ^= seed_ << 13;
+    seed_ ^= seed_ >> 17;
+    seed_ ^= seed_ << 5;
+    return seed_;
+  }
+
+  uint32_t allocate(Row &&row) {
+    uint32_t node;
+    if (!free_.empty()) {
+      node = free_.back();
+      free_.pop_back();
+      nodes_[node] = Node{std::move(row), random()};
+    } else {
+      node = uint32_t(nodes_.size());
+      nodes_.push_back(Node{std::move(row), random()});
+    }
+    return node;
+  }
+
+  void release(uint32_t node) {
+    if (node == kNil) return;
+    release(nodes_[node].left);
+    release(nodes_[node].right);
+    /* drops what the value holds */
+    nodes_[node].row.value = T();
+    free_.push_back(node);
+  }
+
+  uint32_t find(size_t index) const {
+    assert(index < size());
+    auto node = root_;
+    while (true) {
+      const auto left_size = size(nodes_[node].left);
+      if (index < left_size) {
+        node = nodes_[node].left;
+      } else if (index == left_size) {
+        return node;
+      } else {
+        index -= left_size + 1;
+        node = nodes_[node].right;
+      }
+    }
+  }
+
+  /* the first count rows and the others */
+  std::pair<uint32_t, uint32_t> split(uint32_t node, size_t count) {
+    if (node == kNil) return {kNil, kNil};
+    const auto left_size = size(nodes_[node].left);
+    if (count <= left_size) {
+      auto [left, right] = split(nodes_[node].left, count);
+      nodes_[node].left = right;
+      update(node);
+      return {left, node};
+    }
+    auto [left, right] = split(nodes_[node].right, count - left_size - 1);
+    nodes_[node].right = left;
+    update(node);
+    return {node, right};
+  }
+
+  uint32_t merge(uint32_t left, uint32_t right) {
+    if (left == kNil) return right;
+    if (right == kNil) return left;
+    if (nodes_[left].priority > nodes_[right].priority) {
+      nodes_[left].right = merge(nodes_[left].right, right);
+      update(left);
+      return left;
+    }
+    nodes_[right].left = merge(left, nodes_[right].left);
+    update(right);
+    return right;
+  }
+
+  /* treap of the rows in order in linear time, a Cartesian tree by
+     priority built with a stack of the right spine */
+  uint32_t build(std::vector<Row> rows) {
+    std::vector<uint32_t> spine;
+    for (auto &row : rows) {
+      const auto node = allocate(std::move(row));
+      auto last = kNil;
+      while (!spine.empty() &&
+             nodes_[spine.back()].priority < nodes_[node].priority) {
+        last = spine.back();
+        spine.pop_back();
+        /* its subtree is complete */
+        update(last);
+      }
+      nodes_[node].left = last;
+      if (!spine.empty()) nodes_[spine.back()].right = node;
+      spine.push_back(node);
+    }
+    for (auto it = spine.rbegin(); it != spine.rend(); ++it) update(*it);
+    return spine.front();
+  }
+
+  /* first index >= from of a row matching row_matches in the subtree at
+     base, skipping subtrees for which subtree_may_match is false */
+  template <typename SubtreeMayMatch, typename RowMatches>
+  size_t findFirst(uint32_t node, size_t base, size_t from,
+                   const SubtreeMayMatch &subtree_may_match,
+                   const RowMatches &row_matches) const {
+    if (node == kNil || base + nodes_[node].size <= from ||
+        !subtree_may_match(node)) {
+      return npos;
+    }
+    const auto &n = nodes_[node];
+    const auto found =
+        findFirst(n.left, base, from, subtree_may_match, row_matches);
+    if (found != npos) return found;
+    const auto index = base + size(n.left);
+    if (index >= from && row_matches(n.row)) return index;
+    return findFirst(n.right, index + 1, from, subtree_may_match, row_matches);
+  }
+
+  /* last index <= to, see findFirst() */
+  template <typename SubtreeMayMatch, typename RowMatches>
+  size_t findLast(uint32_t node, size_t base, size_t to,
+                  const SubtreeMayMatch &subtree_may_match,
+                  const RowMatches &row_matches) const {
+    if (node == kNil || base > to || !subtree_may_match(node)) {
+      return npos;
+    }
+    const auto &n = nodes_[node];
+    const auto index = base + size(n.left);
+    const auto found =
+        findLast(n.right, index + 1, to, subtree_may_match, row_matches);
+    if (found != npos) return found;
+    if (index <= to && row_matches(n.row)) return index;
+    return findLast(n.left, base, to, subtree_may_match, row_matches);
+  }
+
+  template <typename Visitor>
+  void forEach(uint32_t node, size_t &index, Visitor &visit) const {
+    if (node == kNil) return;
+    forEach(nodes_[node].left, index, visit);
+    visit(index++, nodes_[node].row);
+    forEach(nodes_[node].right, index, visit);
+  }
+  template <typename Visitor>
+  void forEachValue(uint32_t node, Visitor &visit) {
+    if (node == kNil) return;
+    forEachValue(nodes_[node].left, visit);
+    visit(nodes_[node].row.value);
+    forEachValue(nodes_[node].right, visit);
+  }
+
+  std::vector<Node> nodes_;
+  std::vector<uint32_t> free_;
+  uint32_t root_{kNil};
+  uint32_t seed_{2463534242u};
+};
+
+#endif  // CALLGRIND_VIEWER__OUTLINELIST_HPP_
@@ -0,0 +1,127 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "OutlineList.hpp"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+namespace {
+
+using List = OutlineList<int>;
+
+std::vector<List::Row> toRows(const List &list) {
+  std::vector<List::Row> rows;
+  list.forEach([&rows](size_t index, const List::Row &row) {
+    EXPECT_EQ(index, rows.size());
+    rows.push_back(row);
+  });
+  return rows;
+}
+
+}  // namespace
+
+TEST(OutlineList, Basics) {
+  List list;
+  EXPECT_TRUE(list.empty());
+  EXPECT_EQ(list.nextSelectable(List::npos), List::npos);
+  list.insert(0, {{1, 0, true}, {2, 0, true}});
+  /* children of the first row with a non-selectable one */
+  list.insert(1, {{10, 1, false}, {11, 1, true}, {12, 2, true}});
+  ASSERT_EQ(list.size(), 5);
+  EXPECT_EQ(list[0], 1);
+  EXPECT_EQ(list[1], 10);
+  EXPECT_EQ(list[4], 2);
+  EXPECT_EQ(list.nextSelectable(0), 2);
+  EXPECT_EQ(list.prevSelectable(2), 0);
+  EXPECT_EQ(list.nextSelectable(4), List::npos);
+  EXPECT_EQ(list.nextAtLevel(0, 0), 4);
+  EXPECT_EQ(list.nextAtLevel(2, 1), 4);
+  EXPECT_EQ(list.nextAtLevel(4, 0), 5);
+  EXPECT_EQ(list.prevBelowLevel(3, 2), 2);
+  EXPECT_EQ(list.prevBelowLevel(3, 1), 0);
+  EXPECT_EQ(list.prevBelowLevel(0, 1), List::npos);
+  EXPECT_EQ(list.root(0), 0);
+  EXPECT_EQ(list.root(1), 4);
+  EXPECT_EQ(list.root(2), List::npos);
+
+  list.erase(1, list.nextAtLevel(0, 0));
+  ASSERT_EQ(list.size(), 2);
+  EXPECT_EQ(list[1], 2);
+  list[1] = 3;
+  EXPECT_EQ(list.row(1).value, 3);
+}
+
+/* against a plain vector */
+TEST(OutlineList, RandomOperations) {
+  std::mt19937 random(1);
+  List list;
+  std::vector<List::Row> model;
+  for (int step = 0; step < 2000; ++step) {
+    const auto index = random() % (model.size() + 1);
+    if (random() % 3 != 0 || model.empty()) {
+      std::vector<List::Row> rows(random() % 20);
+      for (auto &row : rows) {
+        row = {int(random()), int(random() % 5), random() % 3 == 0};
+      }
+      model.insert(model.begin() + index, rows.begin(), rows.end());
+      list.insert(index, rows);
+    } else {
+      const auto last =
+          std::min(model.size(), index + random() % 30);
+      model.erase(model.begin() + std::min(index, last),
+                  model.begin() + last);
+      list.erase(std::min(index, last), last);
+    }
+    ASSERT_EQ(list.size(), model.size());
+    if (model.empty()) continue;
+
+    const auto at = random() % model.size();
+    EXPECT_EQ(list[at], model[at].value);
+    const int level = random() % 5;
+
+    size_t next = at + 1;
+    while (next < model.size() && !model[next].selectable) ++next;
+    EXPECT_EQ(list.nextSelectable(at), next < model.size() ? next : List::npos);
+    size_t prev = at;
+    while (prev > 0 && !model[prev - 1].selectable) --prev;
+    EXPECT_EQ(list.prevSelectable(at), prev > 0 ? prev - 1 : List::npos);
+
+    next = at + 1;
+    while (next < model.size() && model[next].level > level) ++next;
+    EXPECT_EQ(list.nextAtLevel(at, level), next);
+    prev = at;
+    while (prev > 0 && model[prev - 1].level >= level) --prev;
+    EXPECT_EQ(list.prevBelowLevel(at, level), prev > 0 ? prev - 1 : List::npos);
+
+    const auto k = random() % 10;
+    size_t root = 0, roots = 0;
+    for (; root < model.size(); ++root) {
+      if (model[root].level == 0 && roots++ == k) break;
+    }
+    EXPECT_EQ(list.root(k), root < model.size() ? root : List::npos);
+  }
+  const auto rows = toRows(list);
+  ASSERT_EQ(rows.size(), model.size());
+  for (size_t index = 0; index < rows.size(); ++index) {
+    EXPECT_EQ(rows[index].value, model[index].value);
+    EXPECT_EQ(rows[index].level, model[index].level);
+  }
+}
@@ -0,0 +1,200 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef CALLGRIND_VIEWER__PARSESTATS_HPP_
+#define CALLGRIND_VIEWER__PARSESTATS_HPP_
+
+#include <sys/resource.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/* counted by the operator new of a program that replaces it, as the
+   viewer does; stays 0 otherwise */
+inline std::atomic<uint64_t> allocation_count{0};
+
+/* What opening a profile took: the wall time of each phase and the sizes of
+   what was read and built. Time goes to the phase entered last, so nested
+   phases are not counted twice; when parsing in parallel the parse phase is
+   the time the parsing thread waited for the chunks. */
+struct ParseStats {
+  enum Phase {
+    /* mapping the file, waiting for decompressed input */
+    kRead,
+    /* lines to rows: tokenizing, interning the names */
+    kParse,
+    /* joining chunks and files */
+    kMerge,
+    /* self costs */
+    kAggregate,
+    /* inclusive costs, callee and caller indices */
+    kLink,
+    /* callees and entries by cost */
+    kSort,
+    /* copies of the profile shown while parsing */
+    kSnapshot,
+    /* loading or writing the ProfileCache */
+    kCache,
+    kPhaseCount
+  };
+  static constexpr std::array<const char *, kPhaseCount> kPhaseNames{
+      "read", "parse", "merge", "aggregate", "link", "sort", "snapshot",
+      "cache"};
+
+  std::array<double, kPhaseCount> seconds{};
+  uint64_t bytes{0};
+  uint64_t lines{0};
+  uint64_t entries{0};
+  uint64_t calls{0};
+  uint64_t functions{0};
+  uint64_t names{0};
+  uint64_t cost_rows{0};
+  unsigned int threads{1};
+  /* loaded, written, failed or off */
+  std::string cache{"off"};
+  /* of the process so far */
+  uint64_t peak_rss{0};
+  uint64_t allocations{0};
+
+  double totalSeconds() const {
+    double total = 0;
+    for (auto phase_seconds : seconds) total += phase_seconds;
+    return total;
+  }
+
+  /* starts the clock in the given phase */
+  void start(Phase phase) {
+    phase_ = phase;
+    since_ = std::chrono::steady_clock::now();
+    allocations_at_start_ = allocation_count;
+  }
+  /* the time since the last change goes to the current phase; returns the
+     phase left */
+  Phase enter(Phase phase) {
+    const auto now = std::chrono::steady_clock::now();
+    seconds[phase_] += std::chrono::duration<double>(now - since_).count();
+    since_ = now;
+    const auto left = phase_;
+    phase_ = phase;
+    return left;
+  }
+  /* ends the current phase, takes the process counters */
+  void stop() {
+    enter(phase_);
+    allocations = allocation_count - allocations_at_start_;
+    peak_rss = peakRss();
+  }
+
+  /* a phase for the lifetime of the scope, then back to the one before;
+     nothing without stats */
+  class Scope {
+   public:
+    Scope(ParseStats *stats, Phase phase)
+        : stats_(stats), left_(stats ? stats->enter(phase) : phase) {}
+    ~Scope() {
+      if (stats_) stats_->enter(left_);
+    }
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+   private:
+    ParseStats *stats_;
+    Phase left_;
+  };
+
+  static uint64_t peakRss() {
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return uint64_t(usage.ru_maxrss);
+#else
+    /* kilobytes */
+    return uint64_t(usage.ru_maxrss) * 1024;
+#endif
+  }
+
+  void writeJson(std::ostream &os) const {
+    os << "{\n  \"seconds\": {";
+    for (size_t phase = 0; phase < kPhaseCount; ++phase) {
+      os << (phase == 0 ? "" : ",") << "\n    \"" << kPhaseNames[phase]
+         << "\": " << seconds[phase];
+    }
+    os << ",\n    \"total\": " << totalSeconds() << "\n  },\n";
+    os << "  \"bytes\": " << bytes << ",\n"
+       << "  \"lines\": " << lines << ",\n"
+       << "  \"entries\": " << entries << ",\n"
+       << "  \"calls\": " << calls << ",\n"
+       << "  \"functions\": " << functions << ",\n"
+       << "  \"names\": " << names << ",\n"
+       << "  \"cost_rows\": " << cost_rows << ",\n"
+       << "  \"threads\": " << threads << ",\n"
+       << "  \"cache\": \"" << cache << "\",\n"
+       << "  \"peak_rss\": " << peak_rss << ",\n"
+       << "  \"allocations\": " << allocations << "\n}\n";
+  }
+
+  /* for the stats panel */
+  std::vector<std::string> textLines() const {
+    std::vector<std::string> text;
+    auto add = [&text](const std::string &name, const auto &value) {
+      std::stringstream line;
+      line << std::left << std::setw(12) << name << value;
+      text.push_back(line.str());
+    };
+    auto ms = [](double phase_seconds) {
+      std::stringstream value;
+      value << std::fixed << std::setprecision(1) << phase_seconds * 1000
+            << " ms";
+      return value.str();
+    };
+    for (size_t phase = 0; phase < kPhaseCount; ++phase) {
+      add(kPhaseNames[phase], ms(seconds[phase]));
+    }
+    add("total", ms(totalSeconds()));
+    text.emplace_back();
+    add("bytes", bytes);
+    add("lines", lines);
+    add("entries", entries);
+    add("calls", calls);
+    add("functions", functions);
+    add("names", names);
+    add("cost rows", cost_rows);
+    add("threads", threads);
+    add("cache", cache);
+    add("peak RSS", std::to_string(peak_rss >> 20) + " MB");
+    add("allocations", allocations);
+    return text;
+  }
+
+ private:
+  Phase phase_{kParse};
+  std::chrono::steady_clock::time_point since_{
+      std::chrono::steady_clock::now()};
+  uint64_t allocations_at_start_{0};
+};
+
+#endif  // CALLGRIND_VIEWER__PARSESTATS_HPP_
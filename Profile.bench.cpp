@@ -0,0 +1,138 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "NameTable.hpp"
+#include "Profile.hpp"
+
+namespace {
+
+std::vector<std::string> symbolNames(size_t count) {
+  std::vector<std::string> names;
+  names.reserve(count);
+  for (size_t id = 0; id < count; ++id) {
+    names.push_back("ns" + std::to_string(id % 53) + "::Class" +
+                    std::to_string(id % 1009) + "::method" +
+                    std::to_string(id) + "(int)");
+  }
+  return names;
+}
+
+/* functions with a cost line each and fanout calls to random callees */
+std::unique_ptr<Profile> syntheticProfile(size_t nfunctions, size_t fanout) {
+  auto profile = std::make_unique<Profile>();
+  profile->setPositions({"line"});
+  profile->setEvents({"Ir", "Dr"});
+  auto &names = profile->names();
+  const auto object = names.intern("a.out");
+  const auto file = names.intern("a.c");
+  std::vector<Profile::FunctionId> functions;
+  functions.reserve(nfunctions);
+  for (const auto &name : symbolNames(nfunctions)) {
+    functions.push_back(profile->addFunction(object, file, names.intern(name)));
+  }
+
+  std::mt19937_64 random(1);
+  const Profile::SubPosition line[] = {1};
+  for (auto function : functions) {
+    const Profile::Cost cost[] = {random() % 1000, random() % 100};
+    profile->addCost(function, line, cost);
+    for (size_t icall = 0; icall < fanout; ++icall) {
+      const auto callee = functions[random() % functions.size()];
+      const Profile::Cost call_cost[] = {random() % 100000, random() % 10000};
+      profile->addCall(function, callee, 1, line, line, call_cost);
+    }
+  }
+  return profile;
+}
+
+/* each name is interned several times in a mixed order, as the names of
+   calls are */
+void BM_Intern(benchmark::State &state) {
+  const auto names = symbolNames(size_t(state.range(0)));
+  std::vector<size_t> order;
+  for (size_t repeat = 0; repeat < 4; ++repeat) {
+    for (size_t id = 0; id < names.size(); ++id) order.push_back(id);
+  }
+  std::shuffle(begin(order), end(order), std::mt19937_64(1));
+  for (auto _ : state) {
+    NameTable table;
+    for (auto id : order) benchmark::DoNotOptimize(table.intern(names[id]));
+  }
+  state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(order.size()));
+}
+BENCHMARK(BM_Intern)->Arg(10000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+/* aggregating the costs and linking the calls to their callers and
+   callees */
+void BM_Finalize(benchmark::State &state) {
+  const auto nfunctions = size_t(state.range(0));
+  const auto fanout = size_t(state.range(1));
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto profile = syntheticProfile(nfunctions, fanout);
+    state.ResumeTiming();
+    profile->finalize();
+    benchmark::DoNotOptimize(profile->entries().back());
+  }
+  state.SetItemsProcessed(int64_t(state.iterations()) *
+                          int64_t(nfunctions * fanout));
+}
+BENCHMARK(BM_Finalize)
+    ->Args({10000, 4})
+    ->Args({1000000, 4})
+    ->Args({100000, 32})
+    ->Unit(benchmark::kMillisecond);
+
+void BM_EntriesBy(benchmark::State &state) {
+  auto profile = syntheticProfile(size_t(state.range(0)), 4);
+  profile->finalize();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(profile->entriesBy(1));
+  }
+  state.SetItemsProcessed(int64_t(state.iterations()) *
+                          int64_t(profile->entries().size()));
+}
+BENCHMARK(BM_EntriesBy)
+    ->Arg(10000)
+    ->Arg(1000000)
+    ->Unit(benchmark::kMillisecond);
+
+void BM_CallsBy(benchmark::State &state) {
+  auto profile = syntheticProfile(10000, size_t(state.range(0)));
+  profile->finalize();
+  for (auto _ : state) {
+    for (Profile::FunctionId function = 0;
+         function < profile->functionCount(); ++function) {
+      benchmark::DoNotOptimize(profile->callsBy(function, 1));
+    }
+  }
+  state.SetItemsProcessed(int64_t(state.iterations()) *
+                          int64_t(profile->callCount()));
+}
+BENCHMARK(BM_CallsBy)->Arg(4)->Arg(64)->Unit(benchmark::kMillisecond);
+
+}  // namespace
@@ -0,0 +1,1453 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CALLGRIND_VIEWER__PROFILE_HPP_
+#define CALLGRIND_VIEWER__PROFILE_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Arena.hpp"
+#include "ChunkedArray.hpp"
+#include "NameTable.hpp"
+#include "ParseStats.hpp"
+#include "Span.hpp"
+
+/* Compact representation of a parsed callgrind profile.
+
+   Functions are dense ids over parallel arrays of name ids. Every cost line
+   is a row of (sub-positions..., costs...) in arena-backed row storage that
+   lives as long as the profile; "fn=" blocks of a function are runs of
+   rows. Calls are (caller, callee, ncalls) records pointing to the row with
+   their inclusive cost. Per-function self and inclusive costs, callee and
+   caller lists are computed by finalize().
+
+   The arrays are chunked and shared by the snapshots of a profile still
+   being parsed; the lists of a function are runs in a store only appended
+   to, a list that changes is appended again. */
+class Profile : public std::enable_shared_from_this<Profile> {
+ public:
+  using Cost = uint64_t;
+  using SubPosition = uint64_t;
+  using NameId = NameTable::NameId;
+  using FunctionId = uint32_t;
+  using CallId = uint32_t;
+
+  struct CallEdge {
+    FunctionId caller;
+    FunctionId callee;
+    uint64_t ncalls;
+    /* index of the call cost row in the call rows */
+    uint64_t cost_offset;
+  };
+
+  struct CostBlock {
+    FunctionId function;
+    uint32_t nrows;
+    /* index of the first row in the cost rows */
+    uint64_t offset;
+  };
+
+  Profile() = default;
+  Profile(const Profile &) = delete;
+  Profile &operator=(const Profile &) = delete;
+
+  /* building */
+
+  NameTable &names() { return names_; }
+
+  /* both have to be set before the first row is added */
+  void setPositions(std::vector<std::string> positions) {
+    positions_ = std::move(positions);
+    updateRowWidths();
+  }
+  void setEvents(std::vector<std::string> events) {
+    events_ = std::move(events);
+    updateRowWidths();
+  }
+
+  /* returns the id of the (ob, fl, fn) position, registering it if new */
+  FunctionId addFunction(NameId object, NameId file, NameId symbol) {
+    /* most symbols belong to a single function, which is found by the symbol
+       id alone; only the other functions of a symbol are hashed */
+    if (symbol >= names_.size()) {
+      return addHashedFunction(object, file, symbol);
+    }
+    if (symbol >= symbol_functions_.size()) {
+      symbol_functions_.resize(names_.size(), kNoFunction);
+    }
+    auto &first = symbol_functions_[symbol];
+    if (first == kNoFunction) {
+      first = appendFunction(object, file, symbol);
+      return first;
+    }
+    if (objects_[first] == object && files_[first] == file) {
+      return first;
+    }
+    return addHashedFunction(object, file, symbol);
+  }
+
+  /* returns the index of the new row */
+  uint64_t addCost(FunctionId function, const SubPosition *sub_positions,
+                   const Cost *costs) {
+    if (blocks_.empty() || blocks_.back().function != function ||
+        blocks_.back().nrows == UINT32_MAX) {
+      blocks_.push_back({function, 0, cost_rows_.size()});
+    }
+    appendRow(cost_rows_, sub_positions, costs);
+    blocks_.editBack().nrows++;
+    return cost_rows_.size() - 1;
+  }
+
+  CallId addCall(FunctionId caller, FunctionId callee, uint64_t ncalls,
+                 const SubPosition *target_sub_positions,
+                 const SubPosition *sub_positions, const Cost *costs) {
+    calls_.push_back({caller, callee, ncalls, call_rows_.size()});
+    std::copy_n(target_sub_positions, positions_.size(),
+                call_targets_.append());
+    appendRow(call_rows_, sub_positions, costs);
+    return CallId(calls_.size() - 1);
+  }
+
+  /* Appending a part built separately, like a chunk of a file. appendPart()
+     appends the functions, blocks and calls of the parts in order and
+     reserves their rows; copyPartRows() then fills the rows and may run
+     concurrently for different parts. */
+
+  /* adds base[index] to the sub-position index of row */
+  struct RowFixup {
+    uint64_t row;
+    uint32_t index;
+  };
+
+  struct PartRows {
+    const Profile *part;
+    RowStore::Range cost_rows;
+    RowStore::Range call_rows;
+    RowStore::Range call_targets;
+  };
+
+  /* names maps the name ids of the part to the ones of this profile,
+     object_names the ids of object names when given */
+  PartRows appendPart(const Profile &part, const std::vector<NameId> &names,
+                      const std::vector<NameId> *object_names = nullptr) {
+    const auto &objects = object_names ? *object_names : names;
+    std::vector<FunctionId> functions(part.functionCount());
+    for (FunctionId function = 0; function < functions.size(); ++function) {
+      functions[function] = addFunction(objects[part.objects_[function]],
+                                        names[part.files_[function]],
+                                        names[part.symbols_[function]]);
+    }
+
+    uint64_t row = cost_rows_.size();
+    for (const auto &block : part.blocks_) {
+      const auto function = functions[block.function];
+      for (uint32_t nrows = block.nrows; nrows > 0;) {
+        if (blocks_.empty() || blocks_.back().function != function ||
+            blocks_.back().nrows == UINT32_MAX) {
+          blocks_.push_back({function, 0, row});
+        }
+        auto &last = blocks_.editBack();
+        const auto added = std::min(nrows, UINT32_MAX - last.nrows);
+        last.nrows += added;
+        nrows -= added;
+        row += added;
+      }
+    }
+
+    const auto first_call_row = call_rows_.size();
+    for (const auto &call : part.calls_) {
+      calls_.push_back({functions[call.caller], functions[call.callee],
+                        call.ncalls, first_call_row + call.cost_offset});
+    }
+
+    return {&part, cost_rows_.reserve(part.cost_rows_.size()),
+            call_rows_.reserve(part.call_rows_.size()),
+            call_targets_.reserve(part.call_targets_.size())};
+  }
+
+  /* fixups are in row order */
+  void copyPartRows(const PartRows &rows, const std::vector<SubPosition> &base,
+                    const std::vector<RowFixup> &cost_fixups,
+                    const std::vector<RowFixup> &call_fixups,
+                    const std::vector<RowFixup> &target_fixups) {
+    const auto &part = *rows.part;
+    copyRows(part.cost_rows_, rows.cost_rows, base, cost_fixups);
+    copyRows(part.call_rows_, rows.call_rows, base, call_fixups);
+    copyRows(part.call_targets_, rows.call_targets, base, target_fixups);
+  }
+
+  /* aggregates costs, builds the callee/caller indices and the sorted list
+     of entries; without sort_entries the entries stay in first block order,
+     for reading only the top ones, see topEntriesBy() */
+  void finalize(ParseStats *stats = nullptr, bool sort_entries = true) {
+    {
+      ParseStats::Scope aggregate(stats, ParseStats::kAggregate);
+      aggregateSelfCosts();
+    }
+    ParseStats::Scope link(stats, ParseStats::kLink);
+    buildIndices(stats, sort_entries);
+  }
+
+  /* Finalized copy of the profile built so far, for showing a profile that
+     is still being parsed. The indices of this profile are extended with
+     what was added since the last snapshot, then copied. The copy shares
+     the chunks of the arrays and the rows, as rows never move or change
+     once added, so it takes time in the number of chunks and keeps this
+     profile alive. The reserved rows must have been filled. */
+  std::shared_ptr<Profile> snapshot() {
+    extendIndices();
+    auto copy = std::make_shared<Profile>();
+    copy->names_.share(names_);
+    copy->positions_ = positions_;
+    copy->events_ = events_;
+    copy->updateRowWidths();
+    copy->objects_ = objects_;
+    copy->files_ = files_;
+    copy->symbols_ = symbols_;
+    copy->backing_ = shared_from_this();
+    copy->origin_ = this;
+    copy->cost_rows_.share(cost_rows_);
+    copy->blocks_ = blocks_;
+    copy->calls_ = calls_;
+    copy->call_rows_.share(call_rows_);
+    copy->call_targets_.share(call_targets_);
+    copy->total_self_costs_ = total_self_costs_;
+    copy->entries_ = entries_;
+    copy->entry_costs_ = entry_costs_;
+    copy->self_costs_ = self_costs_;
+    copy->inclusive_costs_ = inclusive_costs_;
+    copy->callee_lists_ = callee_lists_;
+    copy->callee_calls_ = callee_calls_;
+    copy->caller_lists_ = caller_lists_;
+    copy->callers_ = callers_;
+    copy->caller_calls_ = caller_calls_;
+    copy->caller_costs_ = caller_costs_;
+    copy->components_ = components_;
+    copy->component_recursive_ = component_recursive_;
+    copy->indexed_calls_ = indexed_calls_;
+    return copy;
+  }
+
+  /* reading */
+
+  static constexpr size_t kPrimaryEvent = 0;
+  static constexpr FunctionId kNoFunction = FunctionId(-1);
+
+  const NameTable &names() const { return names_; }
+  const std::vector<std::string> &positions() const { return positions_; }
+  const std::vector<std::string> &events() const { return events_; }
+
+  /* the snapshots of a profile and the profile itself number the functions
+     and names alike, a later one adding to the ones of an earlier one */
+  bool sameIds(const Profile &other) const {
+    return origin() == other.origin();
+  }
+
+  size_t functionCount() const { return symbols_.size(); }
+  std::string_view object(FunctionId function) const {
+    return names_[objects_[function]];
+  }
+  std::string_view file(FunctionId function) const {
+    return names_[files_[function]];
+  }
+  std::string_view symbol(FunctionId function) const {
+    return names_[symbols_[function]];
+  }
+  NameId objectName(FunctionId function) const { return objects_[function]; }
+  NameId fileName(FunctionId function) const { return files_[function]; }
+  NameId symbolName(FunctionId function) const { return symbols_[function]; }
+
+  /* functions with at least one "fn=" block, by inclusive cost unless
+     finalized without sorting them */
+  const ChunkedArray<FunctionId> &entries() const { return entries_; }
+  /* of all entries */
+  Cost totalEntryCost(size_t event) const { return entry_costs_[event]; }
+
+  /* the costs are stored by event, a column indexed by FunctionId each */
+  const ChunkedArray<Cost> &selfCosts(size_t event) const {
+    return self_costs_[event];
+  }
+  const ChunkedArray<Cost> &inclusiveCosts(size_t event) const {
+    return inclusive_costs_[event];
+  }
+  Cost selfCost(FunctionId function, size_t event) const {
+    return self_costs_[event][function];
+  }
+  Cost inclusiveCost(FunctionId function, size_t event) const {
+    return inclusive_costs_[event][function];
+  }
+  /* all events of a function, gathered from the columns */
+  std::vector<Cost> selfCost(FunctionId function) const {
+    return gatherCosts(self_costs_, function);
+  }
+  std::vector<Cost> inclusiveCost(FunctionId function) const {
+    return gatherCosts(inclusive_costs_, function);
+  }
+  /* of all functions */
+  Cost totalSelfCost(size_t event) const { return total_self_costs_[event]; }
+
+  /* entries by inclusive cost of event, the most expensive first; entries()
+     for the primary event */
+  std::vector<FunctionId> entriesBy(size_t event) const {
+    std::vector<FunctionId> sorted(entries_.begin(), entries_.end());
+    if (event != kPrimaryEvent) {
+      const auto &column = inclusiveCosts(event);
+      std::stable_sort(begin(sorted), end(sorted),
+                       [&column](FunctionId lhs, FunctionId rhs) {
+                         return column[lhs] > column[rhs];
+                       });
+    }
+    return sorted;
+  }
+  /* the first count of entriesBy(event), selected in linear time and
+     sorted alone, also when the entries were not sorted */
+  std::vector<FunctionId> topEntriesBy(size_t event, size_t count) const {
+    if (events_.empty() || (event == kPrimaryEvent && entries_sorted_)) {
+      return {entries_.begin(),
+              entries_.begin() + std::min(count, entries_.size())};
+    }
+    std::vector<uint32_t> ranks(entries_.size());
+    std::iota(begin(ranks), end(ranks), uint32_t(0));
+    /* ties keep the order of sorting the entries stably by the primary
+       event and then by event */
+    const auto &column = inclusiveCosts(event);
+    const auto &primary = inclusiveCosts(kPrimaryEvent);
+    auto before = [this, &column, &primary](uint32_t lhs, uint32_t rhs) {
+      const auto lhs_function = entries_[lhs];
+      const auto rhs_function = entries_[rhs];
+      if (column[lhs_function] != column[rhs_function]) {
+        return column[lhs_function] > column[rhs_function];
+      }
+      if (primary[lhs_function] != primary[rhs_function]) {
+        return primary[lhs_function] > primary[rhs_function];
+      }
+      return lhs < rhs;
+    };
+    if (count < ranks.size()) {
+      std::nth_element(begin(ranks), begin(ranks) + count, end(ranks),
+                       before);
+      ranks.resize(count);
+    }
+    std::sort(begin(ranks), end(ranks), before);
+    std::vector<FunctionId> top;
+    top.reserve(ranks.size());
+    for (auto rank : ranks) top.push_back(entries_[rank]);
+    return top;
+  }
+
+  /* the number of entries costing at least min_cost by event, what the
+     others cost together in hidden; found by bisecting the entries for the
+     primary event when they are sorted */
+  size_t countEntriesCosting(size_t event, Cost min_cost,
+                             Cost *hidden) const {
+    *hidden = 0;
+    if (events_.empty()) return entries_.size();
+    const auto &column = inclusiveCosts(event);
+    size_t count = 0;
+    if (event == kPrimaryEvent && entries_sorted_) {
+      const auto costing = [&column, min_cost](FunctionId function) {
+        return column[function] >= min_cost;
+      };
+      count = size_t(
+          std::partition_point(entries_.begin(), entries_.end(), costing) -
+          entries_.begin());
+      *hidden = entry_costs_[event];
+      for (size_t rank = 0; rank < count; ++rank) {
+        *hidden -= column[entries_[rank]];
+      }
+      return count;
+    }
+    for (auto function : entries_) {
+      if (column[function] >= min_cost) {
+        ++count;
+      } else {
+        *hidden += column[function];
+      }
+    }
+    return count;
+  }
+
+  const CallEdge &call(CallId call) const { return calls_[call]; }
+  size_t callCount() const { return calls_.size(); }
+  uint64_t costRowCount() const { return cost_rows_.size(); }
+  Span<const Cost> callCost(CallId call) const {
+    return rowCosts(call_rows_, calls_[call].cost_offset);
+  }
+  /* position of the call site */
+  Span<const SubPosition> callSubPositions(CallId call) const {
+    return {call_rows_[calls_[call].cost_offset], positions_.size()};
+  }
+  /* position in the callee as given by the "calls=" line */
+  Span<const SubPosition> callTargetSubPositions(CallId call) const {
+    return call_targets_.row(call);
+  }
+
+  /* outgoing calls, the most expensive first */
+  Span<const CallId> calls(FunctionId function) const {
+    return listSpan(callee_calls_, callee_lists_[function]);
+  }
+  /* by the cost of event */
+  std::vector<CallId> callsBy(FunctionId function, size_t event) const {
+    const auto span = calls(function);
+    std::vector<CallId> sorted(span.begin(), span.end());
+    if (event != kPrimaryEvent) {
+      std::stable_sort(begin(sorted), end(sorted),
+                       [this, event](CallId lhs, CallId rhs) {
+                         return callCost(lhs)[event] > callCost(rhs)[event];
+                       });
+    }
+    return sorted;
+  }
+  /* the strongly connected component of the function in the call graph;
+     functions of a recursion share one. finalize() numbers them callees
+     first, a snapshot numbers the ones of the functions added since the
+     last full build after the others. */
+  uint32_t component(FunctionId function) const {
+    return components_[function];
+  }
+  size_t componentCount() const { return component_recursive_.size(); }
+  bool recursive(FunctionId function) const {
+    return component_recursive_[components_[function]];
+  }
+  /* distinct calling functions, the most expensive by the primary event
+     first */
+  Span<const FunctionId> callers(FunctionId function) const {
+    return listSpan(callers_, caller_lists_[function]);
+  }
+  /* Caller edges: the calls of each of callers(function) into function,
+     summed over the call sites. They are numbered callee by callee in the
+     order of callers(), from firstCallerEdge(function) on. */
+  CallId firstCallerEdge(FunctionId function) const {
+    return CallId(caller_lists_[function].offset);
+  }
+  FunctionId edgeCaller(CallId edge) const { return callers_[edge]; }
+  uint64_t edgeCalls(CallId edge) const { return caller_calls_[edge]; }
+  Span<const Cost> edgeCost(CallId edge) const {
+    return {&caller_costs_[edge], events_.size()};
+  }
+  /* the caller edges of function, the most expensive by event first */
+  std::vector<CallId> callerEdgesBy(FunctionId function, size_t event) const {
+    std::vector<CallId> sorted(callers(function).size());
+    std::iota(begin(sorted), end(sorted), firstCallerEdge(function));
+    if (event != kPrimaryEvent) {
+      std::stable_sort(begin(sorted), end(sorted),
+                       [this, event](CallId lhs, CallId rhs) {
+                         return edgeCost(lhs)[event] > edgeCost(rhs)[event];
+                       });
+    }
+    return sorted;
+  }
+
+  /* rows of a block are block.offset, block.offset + 1, ... */
+  const ChunkedArray<CostBlock> &blocks() const { return blocks_; }
+  Span<const SubPosition> rowSubPositions(uint64_t row) const {
+    return {cost_rows_[row], positions_.size()};
+  }
+  Span<const Cost> rowCosts(uint64_t row) const {
+    return rowCosts(cost_rows_, row);
+  }
+  size_t rowSize() const { return positions_.size() + events_.size(); }
+
+  /* bytes taken by the cost and call rows */
+  size_t rowBytes() const { return arena_.bytesAllocated(); }
+
+ private:
+  /* dumps and restores the arrays as they are */
+  friend class ProfileCache;
+
+  struct FunctionKey {
+    NameId object;
+    NameId file;
+    NameId symbol;
+    bool operator==(const FunctionKey &rhs) const {
+      return symbol == rhs.symbol && object == rhs.object && file == rhs.file;
+    }
+  };
+
+  struct FunctionKeyHash {
+    size_t operator()(const FunctionKey &key) const {
+      uint64_t hash = key.symbol;
+      hash = hash * 0x9E3779B97F4A7C15ull + key.file;
+      hash = hash * 0x9E3779B97F4A7C15ull + key.object;
+      return std::hash<uint64_t>()(hash ^ (hash >> 29));
+    }
+  };
+
+  /* the run of a list in its store */
+  struct ListRef {
+    uint64_t offset;
+    uint64_t size;
+  };
+
+  FunctionId appendFunction(NameId object, NameId file, NameId symbol) {
+    objects_.push_back(object);
+    files_.push_back(file);
+    symbols_.push_back(symbol);
+    return FunctionId(symbols_.size() - 1);
+  }
+
+  FunctionId addHashedFunction(NameId object, NameId file, NameId symbol) {
+    auto [found, inserted] = function_ids_.emplace(
+        FunctionKey{object, file, symbol}, FunctionId(symbols_.size()));
+    if (inserted) appendFunction(object, file, symbol);
+    return found->second;
+  }
+
+  const Profile *origin() const { return origin_ ? origin_ : this; }
+
+  std::vector<Cost> gatherCosts(const std::vector<ChunkedArray<Cost> > &costs,
+                                FunctionId function) const {
+    std::vector<Cost> gathered(events_.size());
+    for (size_t ic = 0; ic < gathered.size(); ++ic) {
+      gathered[ic] = costs[ic][function];
+    }
+    return gathered;
+  }
+
+  template <typename T>
+  static Span<const T> listSpan(const ChunkedArray<T> &store,
+                                const ListRef &list) {
+    if (list.size == 0) return {};
+    return {&store[list.offset], list.size};
+  }
+
+  /* appends the list as one run of the store */
+  template <typename T>
+  static ListRef appendList(ChunkedArray<T> &store,
+                            const std::vector<T> &values) {
+    const auto nrows = values.size() / store.width();
+    std::copy(values.begin(), values.end(), store.appendRows(nrows));
+    return {store.size() - nrows, nrows};
+  }
+
+  /* Stores the lists anew without the versions replaced since they were
+     stored last, when those take most of the stores; the stores are
+     parallel arrays of the rows of the lists. */
+  template <typename... Stores>
+  static void compactLists(ChunkedArray<ListRef> &lists, uint64_t &replaced,
+                           Stores &...stores) {
+    const auto size = std::get<0>(std::tie(stores...)).size();
+    if (2 * replaced <= size + ChunkedArray<ListRef>::kChunkRows) return;
+    std::vector<ListRef> compact(lists.size());
+    uint64_t nrows = 0;
+    for (size_t list = 0; list < compact.size(); ++list) {
+      compact[list] = {nrows, lists[list].size};
+      nrows += lists[list].size;
+    }
+    (compactStore(lists, compact, nrows, stores), ...);
+    lists.assign(compact);
+    replaced = 0;
+  }
+
+  template <typename T>
+  static void compactStore(const ChunkedArray<ListRef> &lists,
+                           const std::vector<ListRef> &compact,
+                           uint64_t nrows, ChunkedArray<T> &store) {
+    const auto width = store.width();
+    ChunkedArray<T> copy(width);
+    const auto rows = copy.appendRows(nrows);
+    for (size_t list = 0; list < compact.size(); ++list) {
+      if (compact[list].size == 0) continue;
+      std::copy_n(&store[lists[list].offset], compact[list].size * width,
+                  rows + compact[list].offset * width);
+    }
+    store = std::move(copy);
+  }
+
+  /* the self costs from the rows summed per function, entries are in the
+     first block order; the rows are summed once, so aggregating a profile
+     that keeps growing costs only its new rows */
+  void aggregateSelfCosts() {
+    aggregateNewRows();
+    const auto nevents = events_.size();
+    const auto nfunctions = functionCount();
+    self_costs_.assign(nevents, ChunkedArray<Cost>());
+    std::vector<Cost> column(nfunctions);
+    for (size_t ic = 0; ic < nevents; ++ic) {
+      for (FunctionId function = 0; function < nfunctions; ++function) {
+        column[function] = running_self_costs_[function * nevents + ic];
+      }
+      self_costs_[ic].assign(column);
+    }
+  }
+
+  void buildIndices(ParseStats *stats = nullptr, bool sort_entries = true) {
+    const auto nfunctions = functionCount();
+    const auto nevents = events_.size();
+
+    /* callees: calls grouped by caller, the most expensive first */
+    std::vector<CallId> all_calls(calls_.size());
+    std::iota(begin(all_calls), end(all_calls), CallId(0));
+    std::vector<size_t> offsets;
+    std::vector<CallId> callee_calls;
+    buildIndex(
+        nfunctions, all_calls,
+        [this](CallId call) { return calls_[call].caller; },
+        [](CallId call) { return call; }, offsets, callee_calls);
+    /* sorted while the calls are still in the cache from grouping them;
+       the components do not depend on the order */
+    if (nevents > 0) {
+      ParseStats::Scope sort(stats, ParseStats::kSort);
+      /* the primary costs of the calls in call order, so comparing two
+         reads two elements of an array instead of two rows */
+      std::vector<Cost> primary_costs(calls_.size());
+      for (CallId call = 0; call < calls_.size(); ++call) {
+        primary_costs[call] = callCost(call)[kPrimaryEvent];
+      }
+      for (FunctionId function = 0; function < nfunctions; ++function) {
+        sortRun(callee_calls.begin() + offsets[function],
+                callee_calls.begin() + offsets[function + 1],
+                [&primary_costs](CallId lhs, CallId rhs) {
+                  return primary_costs[lhs] > primary_costs[rhs];
+                });
+      }
+    }
+    callee_calls_.assign(callee_calls);
+    callee_lists_.assign(listRefs(offsets));
+    replaced_callees_ = 0;
+
+    buildComponents();
+    costComponents();
+
+    buildCallerEdges(stats);
+
+    entries_sorted_ = sort_entries;
+    if (nevents > 0 && sort_entries) {
+      ParseStats::Scope sort(stats, ParseStats::kSort);
+      sortEntries();
+    } else {
+      sortEntries();
+    }
+    indexed_calls_ = calls_.size();
+  }
+
+  /* the entries in first block order, sorted unless they are not to be;
+     the ties keep that order */
+  void sortEntries() {
+    const auto nevents = events_.size();
+    std::vector<FunctionId> entries = running_entries_;
+    if (nevents > 0 && entries_sorted_) {
+      const auto &primary = inclusive_costs_[kPrimaryEvent];
+      std::vector<Cost> costs(entries.size());
+      for (size_t rank = 0; rank < entries.size(); ++rank) {
+        costs[rank] = primary[entries[rank]];
+      }
+      std::vector<uint32_t> ranks(entries.size());
+      std::iota(begin(ranks), end(ranks), uint32_t(0));
+      std::stable_sort(begin(ranks), end(ranks),
+                       [&costs](uint32_t lhs, uint32_t rhs) {
+                         return costs[lhs] > costs[rhs];
+                       });
+      for (size_t rank = 0; rank < ranks.size(); ++rank) {
+        entries[rank] = running_entries_[ranks[rank]];
+      }
+    }
+    entries_.assign(entries);
+    sumEntryCosts();
+  }
+
+  void sumEntryCosts() {
+    entry_costs_.assign(events_.size(), 0);
+    for (size_t ic = 0; ic < entry_costs_.size(); ++ic) {
+      const auto &column = inclusive_costs_[ic];
+      for (auto function : entries_) entry_costs_[ic] += column[function];
+    }
+  }
+
+  /* the inclusive costs from the self costs: the call costs within a
+     recursion include the costs of the nested calls, so a recursion is
+     costed as a whole, the self costs of its functions and the calls
+     leaving it */
+  void costComponents() {
+    const auto nfunctions = functionCount();
+    const auto nevents = events_.size();
+    const std::vector<uint32_t> components(components_.begin(),
+                                           components_.end());
+    std::vector<Cost> component_costs(component_recursive_.size() * nevents);
+    for (size_t ic = 0; ic < nevents; ++ic) {
+      const auto &column = self_costs_[ic];
+      for (FunctionId function = 0; function < nfunctions; ++function) {
+        component_costs[components[function] * nevents + ic] +=
+            column[function];
+      }
+    }
+    for (const auto &call : calls_) {
+      const auto component = components[call.caller];
+      if (component == components[call.callee]) continue;
+      auto row = rowCosts(call_rows_, call.cost_offset);
+      auto costs = component_costs.data() + component * nevents;
+      for (size_t ic = 0; ic < nevents; ++ic) costs[ic] += row[ic];
+    }
+    inclusive_costs_.assign(nevents, ChunkedArray<Cost>());
+    std::vector<Cost> column(nfunctions);
+    for (size_t ic = 0; ic < nevents; ++ic) {
+      for (FunctionId function = 0; function < nfunctions; ++function) {
+        column[function] = component_costs[components[function] * nevents + ic];
+      }
+      inclusive_costs_[ic].assign(column);
+    }
+  }
+
+  /* Brings the indices up to date with the calls and rows added since they
+     were built, in time for what was added: the new calls are merged into
+     the lists of their callers and callees, which are stored again, and
+     what they and the new rows cost is added to the components they leave
+     and to the functions of those. The entries whose costs grew move up
+     in place. A new call against the order of the components reorders the
+     ones in between, only one closing a recursion makes the components be
+     found again. */
+  void extendIndices() {
+    if (components_.empty() || !entries_sorted_) {
+      aggregateSelfCosts();
+      buildIndices();
+      return;
+    }
+    const auto nfunctions = functionCount();
+    const auto nevents = events_.size();
+    const auto indexed_functions = components_.size();
+    const auto indexed_entries = entries_.size();
+    const auto first_call = CallId(indexed_calls_);
+
+    std::vector<FunctionId> grown;
+    for (auto iblock = aggregated_blocks_; iblock < blocks_.size(); ++iblock) {
+      grown.push_back(blocks_[iblock].function);
+    }
+    std::sort(begin(grown), end(grown));
+    grown.erase(std::unique(begin(grown), end(grown)), end(grown));
+    aggregateNewRows();
+
+    /* a new function is a component of its own, ordered below the new
+       functions found earlier as those are mostly their callers */
+    for (auto function = FunctionId(indexed_functions); function < nfunctions;
+         ++function) {
+      for (auto &column : self_costs_) column.push_back(0);
+      for (auto &column : inclusive_costs_) column.push_back(0);
+      callee_lists_.push_back({0, 0});
+      caller_lists_.push_back({0, 0});
+      components_.push_back(uint32_t(component_recursive_.size()));
+      component_recursive_.push_back(false);
+      component_order_.push_back(--lowest_order_);
+      component_lists_.push_back({component_members_.size(), 1});
+      component_members_.push_back(function);
+    }
+
+    extendCallees(first_call);
+    extendCallers(first_call);
+
+    bool renumber = false;
+    for (auto call = first_call; !renumber && call < calls_.size(); ++call) {
+      const auto &edge = calls_[call];
+      const auto caller = components_[edge.caller];
+      const auto callee = components_[edge.callee];
+      if (edge.caller == edge.callee && !component_recursive_[caller]) {
+        component_recursive_.edit(caller) = true;
+      }
+      if (caller != callee &&
+          component_order_[callee] > component_order_[caller]) {
+        renumber = !reorderComponents(caller, callee);
+      }
+    }
+
+    /* what the new rows and calls add to each component they touch */
+    std::unordered_map<uint32_t, size_t> slots;
+    std::vector<Cost> added;
+    auto slot = [&slots, &added, nevents](uint32_t component) {
+      const auto [found, inserted] =
+          slots.try_emplace(component, added.size());
+      if (inserted) added.resize(added.size() + nevents, 0);
+      return found->second;
+    };
+    for (auto function : grown) {
+      const auto costs = running_self_costs_.data() + function * nevents;
+      const auto offset = slot(components_[function]);
+      for (size_t ic = 0; ic < nevents; ++ic) {
+        if (costs[ic] == self_costs_[ic][function]) continue;
+        added[offset + ic] += costs[ic] - self_costs_[ic][function];
+        self_costs_[ic].edit(function) = costs[ic];
+      }
+    }
+    if (renumber) {
+      buildComponents();
+      costComponents();
+      sortEntries();
+      indexed_calls_ = calls_.size();
+      return;
+    }
+    for (auto call = first_call; call < calls_.size(); ++call) {
+      const auto &edge = calls_[call];
+      const auto component = components_[edge.caller];
+      if (component == components_[edge.callee]) continue;
+      const auto row = rowCosts(call_rows_, edge.cost_offset);
+      const auto offset = slot(component);
+      for (size_t ic = 0; ic < nevents; ++ic) added[offset + ic] += row[ic];
+    }
+
+    /* the entries costing more by the primary event, by what they cost
+       before, and the costs of the entries there were */
+    std::unordered_map<FunctionId, Cost> moved;
+    for (const auto &[component, offset] : slots) {
+      const auto list = component_lists_[component];
+      for (auto member : listSpan(component_members_, list)) {
+        const bool entry = running_has_body_[member] &&
+                           running_ranks_[member] < indexed_entries;
+        if (entry && nevents > 0 && added[offset + kPrimaryEvent] > 0) {
+          moved.emplace(member, inclusive_costs_[kPrimaryEvent][member]);
+        }
+        for (size_t ic = 0; ic < nevents; ++ic) {
+          if (added[offset + ic] == 0) continue;
+          inclusive_costs_[ic].edit(member) += added[offset + ic];
+          if (entry) entry_costs_[ic] += added[offset + ic];
+        }
+      }
+    }
+    extendEntries(indexed_entries, moved);
+    indexed_calls_ = calls_.size();
+  }
+
+  /* Keeps the entries sorted: the entries in moved, by the primary cost
+     they had, move up one by one, looked up by that cost; the entries from
+     indexed_entries on are sorted and merged in from where the first goes.
+     Costs only grow, so the entries in between keep their order. */
+  void extendEntries(size_t indexed_entries,
+                     std::unordered_map<FunctionId, Cost> &moved) {
+    const auto nevents = events_.size();
+    const auto *primary =
+        nevents > 0 ? &inclusive_costs_[kPrimaryEvent] : nullptr;
+    const auto cost = [&moved, primary](FunctionId function) {
+      if (const auto found = moved.find(function); found != moved.end()) {
+        return found->second;
+      }
+      return (*primary)[function];
+    };
+    const auto less = [this, &cost, primary](FunctionId lhs, FunctionId rhs) {
+      if (primary) {
+        const auto lhs_cost = cost(lhs);
+        const auto rhs_cost = cost(rhs);
+        if (lhs_cost != rhs_cost) return lhs_cost > rhs_cost;
+      }
+      return running_ranks_[lhs] < running_ranks_[rhs];
+    };
+    std::vector<FunctionId> functions;
+    functions.reserve(moved.size());
+    for (const auto &entry : moved) functions.push_back(entry.first);
+    for (auto function : functions) {
+      const auto from =
+          size_t(std::lower_bound(entries_.begin(), entries_.end(), function,
+                                  less) -
+                 entries_.begin());
+      moved.erase(function);
+      const auto to =
+          size_t(std::lower_bound(entries_.begin(), entries_.begin() + from,
+                                  function, less) -
+                 entries_.begin());
+      for (auto rank = from; rank > to; --rank) {
+        entries_.edit(rank) = entries_[rank - 1];
+      }
+      if (to != from) entries_.edit(to) = function;
+    }
+
+    std::vector<FunctionId> added(running_entries_.begin() + indexed_entries,
+                                  running_entries_.end());
+    if (added.empty()) return;
+    for (size_t ic = 0; ic < nevents; ++ic) {
+      const auto &column = inclusive_costs_[ic];
+      for (auto function : added) entry_costs_[ic] += column[function];
+    }
+    std::sort(begin(added), end(added), less);
+    const auto first =
+        size_t(std::lower_bound(entries_.begin(), entries_.end(),
+                                added.front(), less) -
+               entries_.begin());
+    std::vector<FunctionId> merged(entries_.size() - first + added.size());
+    std::merge(entries_.begin() + first, entries_.end(), begin(added),
+               end(added), begin(merged), less);
+    entries_.resize(entries_.size() + added.size());
+    for (size_t rank = 0; rank < merged.size(); ++rank) {
+      entries_.edit(first + rank) = merged[rank];
+    }
+  }
+
+  /* Pearce and Kelly's dynamic topological order for a call from the
+     component caller into callee ordered above it. The components callee
+     reaches and the ones reaching caller, ordered in between, swap places:
+     the former take the lowest of their orders, each group keeping its
+     own order. Returns false if callee reaches caller, the call closes a
+     recursion. Only calls along the order are followed, the ones against
+     it are reordered in turn. */
+  bool reorderComponents(uint32_t caller, uint32_t callee) {
+    const auto lower = component_order_[caller];
+    const auto upper = component_order_[callee];
+    std::vector<uint32_t> reached{callee};
+    std::unordered_set<uint32_t> seen{callee};
+    for (size_t next = 0; next < reached.size(); ++next) {
+      const auto component = reached[next];
+      const auto order = component_order_[component];
+      const auto members = component_lists_[component];
+      for (auto member : listSpan(component_members_, members)) {
+        for (auto call : calls(member)) {
+          const auto target = components_[calls_[call].callee];
+          if (target == caller) return false;
+          const auto target_order = component_order_[target];
+          if (target_order <= lower || target_order >= order) continue;
+          if (seen.insert(target).second) reached.push_back(target);
+        }
+      }
+    }
+    std::vector<uint32_t> reaching{caller};
+    seen = {caller};
+    for (size_t next = 0; next < reaching.size(); ++next) {
+      const auto component = reaching[next];
+      const auto order = component_order_[component];
+      const auto members = component_lists_[component];
+      for (auto member : listSpan(component_members_, members)) {
+        for (auto source : callers(member)) {
+          const auto source_component = components_[source];
+          const auto source_order = component_order_[source_component];
+          if (source_order <= order || source_order >= upper) continue;
+          if (seen.insert(source_component).second) {
+            reaching.push_back(source_component);
+          }
+        }
+      }
+    }
+
+    const auto by_order = [this](uint32_t lhs, uint32_t rhs) {
+      return component_order_[lhs] < component_order_[rhs];
+    };
+    std::sort(begin(reached), end(reached), by_order);
+    std::sort(begin(reaching), end(reaching), by_order);
+    std::vector<int64_t> orders;
+    orders.reserve(reached.size() + reaching.size());
+    for (const auto *group : {&reached, &reaching}) {
+      for (auto component : *group) {
+        orders.push_back(component_order_[component]);
+      }
+    }
+    std::sort(begin(orders), end(orders));
+    auto order = orders.begin();
+    for (const auto *group : {&reached, &reaching}) {
+      for (auto component : *group) component_order_.edit(component) = *order++;
+    }
+    return true;
+  }
+
+  /* merges the calls from first_call on into the callee lists, each sorted
+     and merged into the list of its caller, which is stored again */
+  void extendCallees(CallId first_call) {
+    std::vector<CallId> added(calls_.size() - first_call);
+    std::iota(begin(added), end(added), first_call);
+    std::stable_sort(begin(added), end(added),
+                     [this](CallId lhs, CallId rhs) {
+                       return calls_[lhs].caller < calls_[rhs].caller;
+                     });
+    const auto by_cost = [this](CallId lhs, CallId rhs) {
+      return callCost(lhs)[kPrimaryEvent] > callCost(rhs)[kPrimaryEvent];
+    };
+    std::vector<CallId> calls;
+    for (auto next = added.begin(); next != added.end();) {
+      const auto function = calls_[*next].caller;
+      const auto old_calls = this->calls(function);
+      calls.assign(old_calls.begin(), old_calls.end());
+      for (; next != added.end() && calls_[*next].caller == function; ++next) {
+        calls.push_back(*next);
+      }
+      if (!events_.empty()) {
+        const auto middle = calls.begin() + old_calls.size();
+        sortRun(middle, calls.end(), by_cost);
+        std::inplace_merge(calls.begin(), middle, calls.end(), by_cost);
+      }
+      replaced_callees_ += old_calls.size();
+      callee_lists_.edit(function) = appendList(callee_calls_, calls);
+    }
+    compactLists(callee_lists_, replaced_callees_, callee_calls_);
+  }
+
+  /* merges the calls from first_call on into the caller edges; only the
+     edges of the callees called are summed, sorted and stored again */
+  void extendCallers(CallId first_call) {
+    const auto nevents = events_.size();
+    std::vector<CallId> added(calls_.size() - first_call);
+    std::iota(begin(added), end(added), first_call);
+    std::sort(begin(added), end(added), [this](CallId lhs, CallId rhs) {
+      const auto &lhs_call = calls_[lhs];
+      const auto &rhs_call = calls_[rhs];
+      return std::tie(lhs_call.callee, lhs_call.caller) <
+             std::tie(rhs_call.callee, rhs_call.caller);
+    });
+    std::vector<FunctionId> callers;
+    std::vector<uint64_t> edge_calls;
+    std::vector<Cost> edge_costs;
+    /* (caller, edge) of the edges of a callee before the new calls */
+    std::vector<std::pair<FunctionId, size_t> > found;
+    std::vector<uint32_t> order;
+    std::vector<FunctionId> sorted_callers;
+    std::vector<uint64_t> sorted_calls;
+    std::vector<Cost> sorted_costs;
+    for (auto next = added.begin(); next != added.end();) {
+      const auto function = calls_[*next].callee;
+      const auto list = caller_lists_[function];
+      callers.clear();
+      edge_calls.clear();
+      edge_costs.clear();
+      found.clear();
+      for (uint64_t edge = 0; edge < list.size; ++edge) {
+        const auto id = CallId(list.offset + edge);
+        callers.push_back(callers_[id]);
+        edge_calls.push_back(caller_calls_[id]);
+        const auto costs = edgeCost(id);
+        edge_costs.insert(edge_costs.end(), costs.begin(), costs.end());
+        found.emplace_back(callers_[id], size_t(edge));
+      }
+      std::sort(begin(found), end(found));
+      for (; next != added.end() && calls_[*next].callee == function; ++next) {
+        const auto &call = calls_[*next];
+        size_t edge;
+        if (const auto it =
+                std::lower_bound(begin(found), end(found),
+                                 std::make_pair(call.caller, size_t(0)));
+            it != end(found) && it->first == call.caller) {
+          edge = it->second;
+        } else if (callers.size() > list.size &&
+                   callers.back() == call.caller) {
+          edge = callers.size() - 1;
+        } else {
+          edge = callers.size();
+          callers.push_back(call.caller);
+          edge_calls.push_back(0);
+          edge_costs.resize(edge_costs.size() + nevents, 0);
+        }
+        edge_calls[edge] += call.ncalls;
+        const auto row = rowCosts(call_rows_, call.cost_offset);
+        auto costs = edge_costs.data() + edge * nevents;
+        for (size_t ic = 0; ic < nevents; ++ic) costs[ic] += row[ic];
+      }
+
+      /* the same order as sorting the edges in caller order stably */
+      order.resize(callers.size());
+      std::iota(begin(order), end(order), uint32_t(0));
+      sortRun(order.begin(), order.end(),
+              [&, nevents](uint32_t lhs, uint32_t rhs) {
+                if (nevents > 0 && edge_costs[lhs * nevents] !=
+                                       edge_costs[rhs * nevents]) {
+                  return edge_costs[lhs * nevents] > edge_costs[rhs * nevents];
+                }
+                return callers[lhs] < callers[rhs];
+              });
+      sorted_callers.clear();
+      sorted_calls.clear();
+      sorted_costs.clear();
+      for (auto edge : order) {
+        sorted_callers.push_back(callers[edge]);
+        sorted_calls.push_back(edge_calls[edge]);
+        sorted_costs.insert(sorted_costs.end(),
+                            edge_costs.begin() + edge * nevents,
+                            edge_costs.begin() + (edge + 1) * nevents);
+      }
+      replaced_callers_ += list.size;
+      caller_lists_.edit(function) = appendList(callers_, sorted_callers);
+      appendList(caller_calls_, sorted_calls);
+      appendCosts(caller_costs_, sorted_costs, order.size());
+    }
+    compactLists(caller_lists_, replaced_callers_, callers_, caller_calls_,
+                 caller_costs_);
+  }
+
+  /* nrows rows of costs, zeros without events */
+  static void appendCosts(ChunkedArray<Cost> &store,
+                          const std::vector<Cost> &costs, size_t nrows) {
+    const auto rows = store.appendRows(nrows);
+    std::copy(costs.begin(), costs.end(), rows);
+  }
+
+  /* callers: the calls into each function summed by calling function, the
+     most expensive first */
+  void buildCallerEdges(ParseStats *stats) {
+    const auto nfunctions = functionCount();
+    const auto nevents = events_.size();
+
+    /* the edges in caller order, found in one pass over the calls: the
+       calls of a caller are together, so the last edge into a callee is
+       the caller's one if there is one */
+    struct LastEdge {
+      FunctionId caller;
+      uint32_t edge;
+    };
+    std::vector<LastEdge> last_edges(nfunctions, {kNoFunction, 0});
+    std::vector<FunctionId> edge_callees;
+    std::vector<FunctionId> edge_callers;
+    std::vector<uint64_t> edge_calls;
+    std::vector<Cost> edge_costs;
+    edge_callees.reserve(calls_.size());
+    edge_callers.reserve(calls_.size());
+    edge_calls.reserve(calls_.size());
+    edge_costs.reserve(calls_.size() * nevents);
+    for (FunctionId caller = 0; caller < nfunctions; ++caller) {
+      for (auto call : calls(caller)) {
+        const auto &edge = calls_[call];
+        auto &last = last_edges[edge.callee];
+        if (last.caller != caller) {
+          last = {caller, uint32_t(edge_callees.size())};
+          edge_callees.push_back(edge.callee);
+          edge_callers.push_back(caller);
+          edge_calls.push_back(0);
+          edge_costs.resize(edge_costs.size() + nevents, 0);
+        }
+        edge_calls[last.edge] += edge.ncalls;
+        const auto row = rowCosts(call_rows_, edge.cost_offset);
+        auto costs = edge_costs.data() + size_t(last.edge) * nevents;
+        for (size_t ic = 0; ic < nevents; ++ic) costs[ic] += row[ic];
+      }
+    }
+
+    /* grouped by callee, the most expensive first */
+    const auto nedges = edge_callees.size();
+    std::vector<size_t> offsets(nfunctions + 1, 0);
+    for (auto callee : edge_callees) offsets[callee + 1]++;
+    std::partial_sum(begin(offsets), end(offsets), begin(offsets));
+    std::vector<uint32_t> order(nedges);
+    auto positions = offsets;
+    for (size_t edge = 0; edge < nedges; ++edge) {
+      order[positions[edge_callees[edge]]++] = uint32_t(edge);
+    }
+    if (nevents > 0) {
+      ParseStats::Scope sort(stats, ParseStats::kSort);
+      for (FunctionId function = 0; function < nfunctions; ++function) {
+        sortRun(order.begin() + offsets[function],
+                order.begin() + offsets[function + 1],
+                [&edge_costs, nevents](uint32_t lhs, uint32_t rhs) {
+                  return edge_costs[lhs * nevents] > edge_costs[rhs * nevents];
+                });
+      }
+    }
+    std::vector<FunctionId> callers(nedges);
+    std::vector<uint64_t> calls(nedges);
+    std::vector<Cost> costs(nedges * nevents);
+    for (size_t edge = 0; edge < nedges; ++edge) {
+      const auto from = order[edge];
+      callers[edge] = edge_callers[from];
+      calls[edge] = edge_calls[from];
+      std::copy_n(edge_costs.begin() + size_t(from) * nevents, nevents,
+                  costs.begin() + edge * nevents);
+    }
+    caller_lists_.assign(listRefs(offsets));
+    callers_.assign(callers);
+    caller_calls_.assign(calls);
+    caller_costs_.clear();
+    appendCosts(caller_costs_, costs, nedges);
+    replaced_callers_ = 0;
+  }
+
+  /* Strongly connected components of the call graph by Tarjan's algorithm,
+     iterative so deep call chains do not overflow the stack; a component is
+     recursive if it has several functions or one calling itself. The
+     components are numbered callees first, which is their first order.
+     Needs the callee index; the walk reads the callees in its order from
+     one array and keeps the low links in the frames, so a call costs a
+     single random access. */
+  void buildComponents() {
+    constexpr uint32_t kUnvisited = UINT32_MAX;
+    /* the order of a function once its component is made */
+    constexpr uint32_t kDone = UINT32_MAX - 1;
+    const auto nfunctions = functionCount();
+    std::vector<size_t> offsets(nfunctions + 1, 0);
+    std::vector<FunctionId> callees;
+    callees.reserve(calls_.size());
+    for (FunctionId function = 0; function < nfunctions; ++function) {
+      for (auto call : calls(function)) {
+        callees.push_back(calls_[call].callee);
+      }
+      offsets[function + 1] = callees.size();
+    }
+    std::vector<uint32_t> components(nfunctions);
+    std::vector<uint8_t> component_recursive;
+    std::vector<uint32_t> order(nfunctions, kUnvisited);
+    std::vector<FunctionId> stack;
+    struct Frame {
+      FunctionId function;
+      uint32_t low;
+      size_t next_call;
+      size_t end_call;
+      bool calls_itself;
+    };
+    std::vector<Frame> frames;
+    uint32_t visited = 0;
+    auto visit = [&](FunctionId function) {
+      order[function] = visited;
+      stack.push_back(function);
+      frames.push_back({function, visited++, offsets[function],
+                        offsets[function + 1], false});
+    };
+    for (FunctionId root = 0; root < nfunctions; ++root) {
+      if (order[root] != kUnvisited) continue;
+      visit(root);
+      while (!frames.empty()) {
+        auto &frame = frames.back();
+        if (frame.next_call < frame.end_call) {
+          const auto callee = callees[frame.next_call++];
+          const auto callee_order = order[callee];
+          if (callee_order == kUnvisited) {
+            visit(callee);
+          } else if (callee_order != kDone) {
+            /* still on the stack */
+            frame.low = std::min(frame.low, callee_order);
+            frame.calls_itself |= callee == frame.function;
+          }
+          continue;
+        }
+        const auto done = frame;
+        frames.pop_back();
+        if (!frames.empty()) {
+          frames.back().low = std::min(frames.back().low, done.low);
+        }
+        if (done.low != order[done.function]) continue;
+        const auto component = uint32_t(component_recursive.size());
+        const bool recursive = stack.back() != done.function;
+        FunctionId member;
+        do {
+          member = stack.back();
+          stack.pop_back();
+          components[member] = component;
+          order[member] = kDone;
+        } while (member != done.function);
+        component_recursive.push_back(recursive || done.calls_itself);
+      }
+    }
+
+    /* the members of each component, and the order numbering them */
+    const auto ncomponents = component_recursive.size();
+    std::vector<size_t> member_offsets(ncomponents + 1, 0);
+    for (auto component : components) member_offsets[component + 1]++;
+    std::partial_sum(begin(member_offsets), end(member_offsets),
+                     begin(member_offsets));
+    std::vector<FunctionId> members(nfunctions);
+    auto positions = member_offsets;
+    for (FunctionId function = 0; function < nfunctions; ++function) {
+      members[positions[components[function]]++] = function;
+    }
+    std::vector<int64_t> orders(ncomponents);
+    std::iota(begin(orders), end(orders), int64_t(0));
+    components_.assign(components);
+    component_recursive_.assign(component_recursive);
+    component_lists_.assign(listRefs(member_offsets));
+    component_members_.assign(members);
+    component_order_.assign(orders);
+    lowest_order_ = 0;
+  }
+
+  static std::vector<ListRef> listRefs(const std::vector<size_t> &offsets) {
+    std::vector<ListRef> lists(offsets.size() - 1);
+    for (size_t list = 0; list < lists.size(); ++list) {
+      lists[list] = {offsets[list], offsets[list + 1] - offsets[list]};
+    }
+    return lists;
+  }
+
+  /* stable sort of one function's list: the lists are mostly short, and
+     std::stable_sort takes a buffer for each */
+  template <typename Iterator, typename Less>
+  static void sortRun(Iterator first, Iterator last, Less less) {
+    constexpr ptrdiff_t kInsertionSortSize = 16;
+    if (last - first > kInsertionSortSize) {
+      std::stable_sort(first, last, less);
+      return;
+    }
+    for (auto it = first; it != last; ++it) {
+      auto value = std::move(*it);
+      auto hole = it;
+      for (; hole != first && less(value, *(hole - 1)); --hole) {
+        *hole = std::move(*(hole - 1));
+      }
+      *hole = std::move(value);
+    }
+  }
+
+  /* groups items by key_of(item) into CSR offsets/values, keeping order */
+  template <typename Value, typename KeyOf, typename ValueOf>
+  static void buildIndex(size_t nkeys, const std::vector<CallId> &items,
+                         KeyOf key_of, ValueOf value_of,
+                         std::vector<size_t> &offsets,
+                         std::vector<Value> &values) {
+    offsets.assign(nkeys + 1, 0);
+    for (auto item : items) offsets[key_of(item) + 1]++;
+    std::partial_sum(begin(offsets), end(offsets), begin(offsets));
+    values.resize(items.size());
+    auto positions = offsets;
+    for (auto item : items) values[positions[key_of(item)]++] = value_of(item);
+  }
+
+  void updateRowWidths() {
+    if (cost_rows_.size() > 0 || call_rows_.size() > 0) {
+      throw std::runtime_error("Positions and events must precede costs");
+    }
+    cost_rows_.setWidth(rowSize());
+    call_rows_.setWidth(rowSize());
+    call_targets_.setWidth(positions_.size());
+    /* a row by edge also without events, as the other stores have */
+    caller_costs_ = ChunkedArray<Cost>(std::max<size_t>(events_.size(), 1));
+  }
+
+  static void copyRows(const RowStore &from, const RowStore::Range &to,
+                       const std::vector<SubPosition> &base,
+                       const std::vector<RowFixup> &fixups) {
+    auto fixup = fixups.begin();
+    for (size_t row = 0; row < from.size(); ++row) {
+      auto copy = to[row];
+      std::copy_n(from[row], from.width(), copy);
+      for (; fixup != fixups.end() && fixup->row == row; ++fixup) {
+        copy[fixup->index] += base[fixup->index];
+      }
+    }
+  }
+
+  void appendRow(RowStore &rows, const SubPosition *sub_positions,
+                 const Cost *costs) {
+    auto row = rows.append();
+    row = std::copy_n(sub_positions, positions_.size(), row);
+    std::copy_n(costs, events_.size(), row);
+  }
+
+  Span<const Cost> rowCosts(const RowStore &rows, uint64_t row) const {
+    return {rows[row] + positions_.size(), events_.size()};
+  }
+
+  /* adds the rows appended since the last call to the running self costs
+     and totals; the last block may have grown since */
+  void aggregateNewRows() {
+    const auto nevents = events_.size();
+    running_self_costs_.resize(functionCount() * nevents, 0);
+    running_has_body_.resize(functionCount(), false);
+    running_ranks_.resize(functionCount(), 0);
+    total_self_costs_.resize(nevents, 0);
+    /* the rows of a block are summed across all events at once */
+    std::vector<Cost> sum(nevents);
+    const auto row_width = rowSize();
+    for (auto iblock = aggregated_blocks_; iblock < blocks_.size(); ++iblock) {
+      const auto &block = blocks_[iblock];
+      const auto skipped = iblock == aggregated_blocks_ ? aggregated_rows_ : 0;
+      if (!running_has_body_[block.function]) {
+        running_has_body_[block.function] = true;
+        running_ranks_[block.function] = uint32_t(running_entries_.size());
+        running_entries_.push_back(block.function);
+      }
+      std::fill(begin(sum), end(sum), 0);
+      cost_rows_.forEachRun(
+          block.offset + skipped, block.nrows - skipped,
+          [&](const uint64_t *rows, size_t nrows) {
+            for (size_t irow = 0; irow < nrows; ++irow) {
+              const auto costs = rows + irow * row_width + positions_.size();
+              for (size_t ic = 0; ic < nevents; ++ic) sum[ic] += costs[ic];
+            }
+          });
+      auto costs = running_self_costs_.data() + block.function * nevents;
+      for (size_t ic = 0; ic < nevents; ++ic) {
+        costs[ic] += sum[ic];
+        total_self_costs_[ic] += sum[ic];
+      }
+    }
+    if (!blocks_.empty()) {
+      aggregated_blocks_ = blocks_.size() - 1;
+      aggregated_rows_ = blocks_.back().nrows;
+    }
+  }
+
+  NameTable names_;
+  std::vector<std::string> positions_;
+  std::vector<std::string> events_;
+
+  /* functions, indexed by FunctionId */
+  ChunkedArray<NameId> objects_;
+  ChunkedArray<NameId> files_;
+  ChunkedArray<NameId> symbols_;
+  /* first function of each symbol, indexed by NameId */
+  std::vector<FunctionId> symbol_functions_;
+  /* the other functions */
+  std::unordered_map<FunctionKey, FunctionId, FunctionKeyHash> function_ids_;
+
+  /* backs all rows below, released at once with the profile */
+  Arena arena_;
+  /* keeps rows adopted from elsewhere alive, see ProfileCache and
+     snapshot() */
+  std::shared_ptr<const void> backing_;
+  /* the profile a snapshot was taken of */
+  const Profile *origin_{nullptr};
+
+  /* rows of (sub-positions..., costs...) */
+  RowStore cost_rows_{arena_};
+  ChunkedArray<CostBlock> blocks_;
+
+  ChunkedArray<CallEdge> calls_;
+  RowStore call_rows_{arena_};
+  /* rows of sub-positions, indexed by CallId */
+  RowStore call_targets_{arena_};
+
+  /* self costs of the rows summed so far by function, then event, the
+     functions having a block in first block order and their ranks in it,
+     and the position after the last summed row */
+  std::vector<Cost> running_self_costs_;
+  std::vector<bool> running_has_body_;
+  std::vector<FunctionId> running_entries_;
+  std::vector<uint32_t> running_ranks_;
+  size_t aggregated_blocks_{0};
+  uint32_t aggregated_rows_{0};
+  /* of the rows summed, by event */
+  std::vector<Cost> total_self_costs_;
+
+  /* filled by finalize(), and extended by snapshot() for the calls from
+     indexed_calls_ on */
+  size_t indexed_calls_{0};
+  ChunkedArray<FunctionId> entries_;
+  bool entries_sorted_{true};
+  /* the inclusive costs of the entries summed, by event */
+  std::vector<Cost> entry_costs_;
+  /* a column by event */
+  std::vector<ChunkedArray<Cost> > self_costs_;
+  std::vector<ChunkedArray<Cost> > inclusive_costs_;
+  /* by function, into the stores after them */
+  ChunkedArray<ListRef> callee_lists_;
+  ChunkedArray<CallId> callee_calls_;
+  ChunkedArray<ListRef> caller_lists_;
+  ChunkedArray<FunctionId> callers_;
+  ChunkedArray<uint64_t> caller_calls_;
+  /* a row of the events by edge */
+  ChunkedArray<Cost> caller_costs_{1};
+  /* the rows of the lists stored again since the stores were compacted */
+  uint64_t replaced_callees_{0};
+  uint64_t replaced_callers_{0};
+  ChunkedArray<uint32_t> components_;
+  ChunkedArray<uint8_t> component_recursive_;
+  /* Extending the indices only: the functions of each component, and an
+     order of the components in which a callee is below its callers,
+     lowest_order_ being the lowest */
+  ChunkedArray<ListRef> component_lists_;
+  ChunkedArray<FunctionId> component_members_;
+  ChunkedArray<int64_t> component_order_;
+  int64_t lowest_order_{0};
+};
+
+#endif  // CALLGRIND_VIEWER__PROFILE_HPP_
@@ -0,0 +1,288 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "Profile.hpp"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+std::vector<Profile::Cost> toVector(Span<const Profile::Cost> span) {
+  return {span.begin(), span.end()};
+}
+
+/* the steps a profile of a running program grows by: calls along the
+   order of the components, then calls closing a recursion and into a new
+   function, then rows and a call against the order of the components that
+   closes none */
+void grow(Profile &profile, int step) {
+  auto function = [&profile](const char *symbol) {
+    auto &names = profile.names();
+    return profile.addFunction(names.intern("a.out"), names.intern("a.c"),
+                               names.intern(symbol));
+  };
+  auto cost = [&profile](Profile::FunctionId function, Profile::Cost ir) {
+    const Profile::SubPosition line[] = {1};
+    const Profile::Cost costs[] = {ir, ir % 3};
+    profile.addCost(function, line, costs);
+  };
+  auto call = [&profile](Profile::FunctionId caller,
+                         Profile::FunctionId callee, Profile::Cost ir) {
+    const Profile::SubPosition line[] = {1};
+    const Profile::Cost costs[] = {ir, ir % 3};
+    profile.addCall(caller, callee, 1, line, line, costs);
+  };
+  if (step == 0) {
+    profile.setPositions({"line"});
+    profile.setEvents({"Ir", "Dr"});
+    cost(function("main"), 10);
+    call(function("main"), function("foo"), 70);
+    cost(function("foo"), 50);
+    call(function("foo"), function("bar"), 20);
+    cost(function("bar"), 20);
+  } else if (step == 1) {
+    cost(function("main"), 5);
+    call(function("main"), function("foo"), 30);
+    call(function("main"), function("bar"), 4);
+    cost(function("foo"), 30);
+    call(function("foo"), function("foo"), 6);
+    cost(function("baz"), 7);
+    call(function("baz"), function("bar"), 3);
+    call(function("baz"), function("zip"), 1);
+    cost(function("zip"), 1);
+  } else if (step == 2) {
+    cost(function("bar"), 2);
+    call(function("bar"), function("main"), 2);
+    call(function("foo"), function("qux"), 1);
+    cost(function("qux"), 1);
+  } else {
+    cost(function("bar"), 40);
+    cost(function("zip"), 1);
+    call(function("qux"), function("zip"), 1);
+  }
+}
+
+void expectSameIndices(const Profile &lhs, const Profile &rhs) {
+  using Functions = std::vector<Profile::FunctionId>;
+  ASSERT_EQ(lhs.functionCount(), rhs.functionCount());
+  EXPECT_EQ(lhs.entries(), rhs.entries());
+  EXPECT_EQ(lhs.blocks().size(), rhs.blocks().size());
+  for (Profile::FunctionId function = 0; function < lhs.functionCount();
+       ++function) {
+    EXPECT_EQ(toVector(lhs.selfCost(function)),
+              toVector(rhs.selfCost(function)));
+    EXPECT_EQ(toVector(lhs.inclusiveCost(function)),
+              toVector(rhs.inclusiveCost(function)));
+    const auto lhs_calls = lhs.calls(function);
+    const auto rhs_calls = rhs.calls(function);
+    EXPECT_EQ(std::vector<Profile::CallId>(lhs_calls.begin(), lhs_calls.end()),
+              std::vector<Profile::CallId>(rhs_calls.begin(), rhs_calls.end()));
+    const auto lhs_callers = lhs.callers(function);
+    const auto rhs_callers = rhs.callers(function);
+    ASSERT_EQ(Functions(lhs_callers.begin(), lhs_callers.end()),
+              Functions(rhs_callers.begin(), rhs_callers.end()));
+    for (size_t icaller = 0; icaller < lhs_callers.size(); ++icaller) {
+      const auto lhs_edge = lhs.firstCallerEdge(function) + icaller;
+      const auto rhs_edge = rhs.firstCallerEdge(function) + icaller;
+      EXPECT_EQ(lhs.edgeCalls(lhs_edge), rhs.edgeCalls(rhs_edge));
+      EXPECT_EQ(toVector(lhs.edgeCost(lhs_edge)),
+                toVector(rhs.edgeCost(rhs_edge)));
+    }
+    EXPECT_EQ(lhs.recursive(function), rhs.recursive(function));
+    /* the numbering may differ, not what is a component */
+    for (Profile::FunctionId other = 0; other < lhs.functionCount();
+         ++other) {
+      EXPECT_EQ(lhs.component(function) == lhs.component(other),
+                rhs.component(function) == rhs.component(other));
+    }
+  }
+}
+
+}  // namespace
+
+TEST(Profile, Finalize) {
+  Profile profile;
+  profile.setPositions({"line"});
+  profile.setEvents({"Ir", "Dr"});
+  auto object = profile.names().intern("a.out");
+  auto file = profile.names().intern("a.c");
+  auto main_function =
+      profile.addFunction(object, file, profile.names().intern("main"));
+  auto foo = profile.addFunction(object, file, profile.names().intern("foo"));
+  auto bar = profile.addFunction(object, file, profile.names().intern("bar"));
+  EXPECT_EQ(profile.addFunction(object, file, profile.names().intern("foo")),
+            foo);
+
+  const Profile::SubPosition line[] = {1};
+  const Profile::Cost main_cost[] = {10, 1};
+  const Profile::Cost foo_cost[] = {20, 2};
+  const Profile::Cost cheap_call[] = {5, 0};
+  const Profile::Cost expensive_call[] = {20, 2};
+  profile.addCost(main_function, line, main_cost);
+  profile.addCall(main_function, bar, 1, line, line, cheap_call);
+  profile.addCall(main_function, foo, 3, line, line, expensive_call);
+  profile.addCost(foo, line, foo_cost);
+  profile.addCall(foo, bar, 1, line, line, cheap_call);
+  profile.addCall(foo, bar, 1, line, line, cheap_call);
+  profile.addCost(main_function, line, main_cost);
+  profile.finalize();
+
+  EXPECT_EQ(profile.functionCount(), 3);
+  EXPECT_EQ(profile.entries(), (std::vector<Profile::FunctionId>{
+                                   main_function, foo}));
+  EXPECT_EQ(toVector(profile.selfCost(main_function)),
+            (std::vector<Profile::Cost>{20, 2}));
+  EXPECT_EQ(toVector(profile.inclusiveCost(main_function)),
+            (std::vector<Profile::Cost>{45, 4}));
+  EXPECT_EQ(toVector(profile.inclusiveCost(bar)),
+            (std::vector<Profile::Cost>{0, 0}));
+
+  auto main_calls = profile.calls(main_function);
+  ASSERT_EQ(main_calls.size(), 2);
+  EXPECT_EQ(profile.call(main_calls[0]).callee, foo);
+  EXPECT_EQ(profile.call(main_calls[0]).ncalls, 3);
+  EXPECT_EQ(profile.call(main_calls[1]).callee, bar);
+
+  /* the two calls from foo are summed and cost more than the one from
+     main */
+  auto bar_callers = profile.callers(bar);
+  EXPECT_EQ(std::vector<Profile::FunctionId>(bar_callers.begin(),
+                                             bar_callers.end()),
+            (std::vector<Profile::FunctionId>{foo, main_function}));
+  EXPECT_TRUE(profile.callers(main_function).empty());
+  const auto foo_edge = profile.firstCallerEdge(bar);
+  EXPECT_EQ(profile.edgeCaller(foo_edge), foo);
+  EXPECT_EQ(profile.edgeCalls(foo_edge), 2);
+  EXPECT_EQ(toVector(profile.edgeCost(foo_edge)),
+            (std::vector<Profile::Cost>{10, 0}));
+  EXPECT_EQ(profile.edgeCaller(foo_edge + 1), main_function);
+  EXPECT_EQ(profile.edgeCalls(foo_edge + 1), 1);
+  EXPECT_EQ(profile.callerEdgesBy(bar, 0),
+            (std::vector<Profile::CallId>{foo_edge, foo_edge + 1}));
+}
+
+TEST(Profile, SortByEvent) {
+  Profile profile;
+  profile.setPositions({"line"});
+  profile.setEvents({"Ir", "D1mr", "Bcm"});
+  auto object = profile.names().intern("a.out");
+  auto file = profile.names().intern("a.c");
+  auto main_function =
+      profile.addFunction(object, file, profile.names().intern("main"));
+  auto hot = profile.addFunction(object, file, profile.names().intern("hot"));
+  auto missing =
+      profile.addFunction(object, file, profile.names().intern("missing"));
+
+  const Profile::SubPosition line[] = {1};
+  const Profile::Cost main_cost[] = {1, 0, 0};
+  const Profile::Cost hot_cost[] = {100, 1, 3};
+  const Profile::Cost missing_cost[] = {10, 50, 1};
+  profile.addCost(main_function, line, main_cost);
+  profile.addCall(main_function, hot, 1, line, line, hot_cost);
+  profile.addCall(main_function, missing, 1, line, line, missing_cost);
+  profile.addCost(hot, line, hot_cost);
+  profile.addCost(missing, line, missing_cost);
+  profile.finalize();
+
+  using Functions = std::vector<Profile::FunctionId>;
+  EXPECT_EQ(profile.entries(), (Functions{main_function, hot, missing}));
+  EXPECT_EQ(profile.entriesBy(0), profile.entries());
+  EXPECT_EQ(profile.entriesBy(1), (Functions{main_function, missing, hot}));
+  EXPECT_EQ(profile.entriesBy(2), (Functions{main_function, hot, missing}));
+  EXPECT_EQ(profile.topEntriesBy(1, 2), (Functions{main_function, missing}));
+  EXPECT_EQ(profile.topEntriesBy(0, 5), profile.entries());
+
+  const auto by_misses = profile.callsBy(main_function, 1);
+  ASSERT_EQ(by_misses.size(), 2);
+  EXPECT_EQ(profile.call(by_misses[0]).callee, missing);
+  EXPECT_EQ(profile.call(profile.calls(main_function)[0]).callee, hot);
+
+  EXPECT_EQ(profile.inclusiveCost(main_function, 1), 51);
+  EXPECT_EQ(profile.inclusiveCosts(1),
+            (std::vector<Profile::Cost>{51, 1, 50}));
+  EXPECT_EQ(profile.selfCost(hot, 2), 3);
+  EXPECT_EQ(profile.totalSelfCost(0), 111);
+}
+
+TEST(Profile, TopEntriesBy) {
+  auto build = [](Profile &profile) {
+    profile.setPositions({"line"});
+    profile.setEvents({"Ir", "D1mr"});
+    auto object = profile.names().intern("a.out");
+    auto file = profile.names().intern("a.c");
+    const Profile::SubPosition line[] = {1};
+    for (int ifunction = 0; ifunction < 200; ++ifunction) {
+      auto function = profile.addFunction(
+          object, file,
+          profile.names().intern("f" + std::to_string(ifunction)));
+      /* ties in both events, many in the second */
+      const Profile::Cost cost[] = {Profile::Cost(ifunction * 7919 % 150),
+                                    Profile::Cost(ifunction % 5)};
+      profile.addCost(function, line, cost);
+    }
+  };
+  Profile profile;
+  build(profile);
+  profile.finalize();
+  /* the same top entries without sorting all of them first */
+  Profile unsorted;
+  build(unsorted);
+  unsorted.finalize(nullptr, false);
+
+  for (size_t event : {0, 1}) {
+    const auto sorted = profile.entriesBy(event);
+    for (size_t count : {0, 1, 7, 199, 200, 300}) {
+      const std::vector<Profile::FunctionId> expected(
+          sorted.begin(), sorted.begin() + std::min(count, sorted.size()));
+      EXPECT_EQ(profile.topEntriesBy(event, count), expected);
+      EXPECT_EQ(unsorted.topEntriesBy(event, count), expected);
+    }
+  }
+}
+
+TEST(Profile, Snapshot) {
+  auto profile = std::make_shared<Profile>();
+  std::vector<std::shared_ptr<const Profile> > snapshots;
+  for (int step = 0; step < 4; ++step) {
+    grow(*profile, step);
+    snapshots.push_back(profile->snapshot());
+
+    Profile finalized;
+    for (int done = 0; done <= step; ++done) grow(finalized, done);
+    finalized.finalize();
+    SCOPED_TRACE(step);
+    expectSameIndices(*snapshots.back(), finalized);
+  }
+
+  /* the snapshots keep their indices and the rows, which stay as they
+     were */
+  profile.reset();
+  const auto &first = *snapshots.front();
+  Profile finalized;
+  grow(finalized, 0);
+  finalized.finalize();
+  expectSameIndices(first, finalized);
+  ASSERT_EQ(first.blocks().size(), 3);
+  EXPECT_EQ(first.blocks().back().nrows, 1);
+  EXPECT_EQ(toVector(first.rowCosts(first.blocks().back().offset)),
+            (std::vector<Profile::Cost>{20, 2}));
+  EXPECT_EQ(toVector(first.callCost(first.calls(0)[0])),
+            (std::vector<Profile::Cost>{70, 1}));
+  EXPECT_EQ(snapshots.back()->costRowCount(), 11);
+}
@@ -0,0 +1,426 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CALLGRIND_VIEWER__PROFILECACHE_HPP_
+#define CALLGRIND_VIEWER__PROFILECACHE_HPP_
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "MappedFile.hpp"
+#include "Profile.hpp"
+
+/* Binary sidecar cache of a finalized Profile, "<file>.cgidx".
+
+   The cache is a raw dump of the profile arrays in native byte order, each
+   padded to 8 bytes. Loading copies the small arrays out of the mapped
+   file and uses the rows in place, the mapping lives as long as the
+   profile. It is keyed by the size, modification time and a hash of the source
+   file; any mismatch or damage makes load() fail and the source is parsed
+   again. */
+class ProfileCache {
+ public:
+  struct SourceKey {
+    uint64_t size;
+    int64_t mtime_ns;
+    /* of the head and the tail of the file, hashing all of it would cost
+       as much as reading it */
+    uint64_t hash;
+
+    bool operator==(const SourceKey &rhs) const {
+      return size == rhs.size && mtime_ns == rhs.mtime_ns && hash == rhs.hash;
+    }
+  };
+
+  static std::string cachePath(const std::string &filename) {
+    return filename + ".cgidx";
+  }
+
+  /* the directory of the cache can be written to, save() is not tried
+     otherwise */
+  static bool writable(const std::string &cache_path) {
+    auto directory = cache_path.substr(0, cache_path.rfind('/') + 1);
+    if (directory.empty()) directory = ".";
+    return ::access(directory.c_str(), W_OK) == 0;
+  }
+
+  /* empty for anything but a non-empty regular file */
+  static std::optional<SourceKey> sourceKey(const std::string &filename) {
+    struct stat st {};
+    if (::stat(filename.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+      return {};
+    }
+    MappedFile mapped_file;
+    if (!mapped_file.map(filename)) return {};
+    const auto text = mapped_file.view();
+    const auto sample = std::min<size_t>(text.size(), kHashedBytes);
+    auto hash = hashBytes(kHashSeed, text.substr(0, sample));
+    hash = hashBytes(hash, text.substr(text.size() - sample));
+    return SourceKey{uint64_t(st.st_size),
+                     int64_t(st.st_mtim.tv_sec) * 1000000000 +
+                         st.st_mtim.tv_nsec,
+                     hash};
+  }
+
+  /* returns null if there is no valid cache for the key */
+  static std::shared_ptr<Profile> load(const std::string &cache_path,
+                                       const SourceKey &key,
+                                       uint64_t *lines = nullptr) {
+    auto mapped_file = std::make_shared<MappedFile>();
+    if (!mapped_file->map(cache_path)) return nullptr;
+    try {
+      Reader reader{mapped_file->view()};
+      Header header;
+      reader.read(header);
+      if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+          header.version != kVersion || header.byte_order != kByteOrder ||
+          !(header.key == key)) {
+        return nullptr;
+      }
+
+      auto profile = std::make_shared<Profile>();
+      auto &names = profile->names_;
+      std::vector<std::string> name_list;
+      reader.readStrings(name_list);
+      if (name_list.empty()) return nullptr;
+      for (size_t id = 1; id < name_list.size(); ++id) {
+        /* empty names other than id 0 are reserved slots */
+        const auto name_id = name_list[id].empty()
+                                 ? names.reserve()
+                                 : names.intern(name_list[id]);
+        if (name_id != id) return nullptr;
+      }
+
+      std::vector<std::string> positions, events;
+      reader.readStrings(positions);
+      reader.readStrings(events);
+      profile->setPositions(std::move(positions));
+      profile->setEvents(std::move(events));
+
+      reader.readArray(profile->objects_);
+      reader.readArray(profile->files_);
+      reader.readArray(profile->symbols_);
+      reader.readArray(profile->blocks_);
+      reader.readArray(profile->calls_);
+      reader.readRows(profile->cost_rows_);
+      reader.readRows(profile->call_rows_);
+      reader.readRows(profile->call_targets_);
+
+      const auto nevents = profile->events_.size();
+      reader.readArray(profile->entries_);
+      profile->self_costs_.resize(nevents);
+      for (auto &column : profile->self_costs_) reader.readArray(column);
+      profile->inclusive_costs_.resize(nevents);
+      for (auto &column : profile->inclusive_costs_) reader.readArray(column);
+      reader.readArray(profile->callee_lists_);
+      reader.readArray(profile->callee_calls_);
+      reader.readArray(profile->caller_lists_);
+      reader.readArray(profile->callers_);
+      reader.readArray(profile->caller_calls_);
+      reader.readArray(profile->caller_costs_);
+      reader.readArray(profile->components_);
+      reader.readArray(profile->component_recursive_);
+      profile->indexed_calls_ = profile->calls_.size();
+
+      uint64_t end_mark = 0;
+      reader.read(end_mark);
+      if (end_mark != kEndMark || !consistent(*profile)) return nullptr;
+      /* the sums kept instead of being stored */
+      profile->total_self_costs_.assign(nevents, 0);
+      for (size_t ic = 0; ic < nevents; ++ic) {
+        const auto &column = profile->self_costs_[ic];
+        profile->total_self_costs_[ic] =
+            std::accumulate(column.begin(), column.end(), Profile::Cost(0));
+      }
+      profile->sumEntryCosts();
+      if (lines) *lines = header.lines;
+      profile->backing_ = std::move(mapped_file);
+      return profile;
+    } catch (const std::runtime_error &) {
+      return nullptr;
+    }
+  }
+
+  /* writes a temporary file renamed over the cache, so readers never see
+     a partial cache; returns false if it cannot be written */
+  static bool save(const Profile &profile, const std::string &cache_path,
+                   const SourceKey &key, uint64_t lines = 0) {
+    const auto temp_path = cache_path + ".tmp";
+    {
+      std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+      if (!out) return false;
+      Writer writer{out};
+
+      Header header{};
+      std::memcpy(header.magic, kMagic, sizeof(kMagic));
+      header.version = kVersion;
+      header.byte_order = kByteOrder;
+      header.key = key;
+      header.lines = lines;
+      writer.write(header);
+
+      const auto &names = profile.names_;
+      writer.write(uint64_t(names.size()));
+      for (NameId id = 0; id < names.size(); ++id) {
+        writer.writeString(names[id]);
+      }
+      writer.writeStrings(profile.positions_);
+      writer.writeStrings(profile.events_);
+
+      writer.writeArray(profile.objects_);
+      writer.writeArray(profile.files_);
+      writer.writeArray(profile.symbols_);
+      writer.writeArray(profile.blocks_);
+      writer.writeArray(profile.calls_);
+      writer.writeRows(profile.cost_rows_);
+      writer.writeRows(profile.call_rows_);
+      writer.writeRows(profile.call_targets_);
+
+      writer.writeArray(profile.entries_);
+      for (const auto &column : profile.self_costs_) writer.writeArray(column);
+      for (const auto &column : profile.inclusive_costs_) {
+        writer.writeArray(column);
+      }
+      writer.writeArray(profile.callee_lists_);
+      writer.writeArray(profile.callee_calls_);
+      writer.writeArray(profile.caller_lists_);
+      writer.writeArray(profile.callers_);
+      writer.writeArray(profile.caller_calls_);
+      writer.writeArray(profile.caller_costs_);
+      writer.writeArray(profile.components_);
+      writer.writeArray(profile.component_recursive_);
+
+      writer.write(kEndMark);
+      out.flush();
+      if (!out) {
+        std::remove(temp_path.c_str());
+        return false;
+      }
+    }
+    if (std::rename(temp_path.c_str(), cache_path.c_str()) != 0) {
+      std::remove(temp_path.c_str());
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  using NameId = Profile::NameId;
+
+  static constexpr char kMagic[8] = {'C', 'G', 'I', 'D', 'X', '\0', '\0', '\0'};
+  static constexpr uint32_t kVersion = 5;
+  static constexpr uint32_t kByteOrder = 0x01020304;
+  static constexpr uint64_t kEndMark = 0x444e455844494743ull;
+  static constexpr size_t kHashedBytes = size_t(1) << 20;
+  static constexpr uint64_t kHashSeed = 0xcbf29ce484222325ull;
+
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    SourceKey key;
+    uint64_t lines;
+  };
+
+  /* FNV-1a */
+  static uint64_t hashBytes(uint64_t hash, std::string_view bytes) {
+    for (unsigned char byte : bytes) {
+      hash = (hash ^ byte) * 0x100000001b3ull;
+    }
+    return hash;
+  }
+
+  /* the arrays refer to each other within bounds and the callee and
+     caller lists lie within their stores, so no span a damaged cache gives
+     reaches out of its array */
+  static bool consistent(const Profile &profile) {
+    const auto nfunctions = profile.functionCount();
+    if (profile.objects_.size() != nfunctions ||
+        profile.files_.size() != nfunctions ||
+        profile.callee_lists_.size() != nfunctions ||
+        profile.caller_lists_.size() != nfunctions ||
+        profile.caller_calls_.size() != profile.callers_.size() ||
+        profile.caller_costs_.size() != profile.callers_.size() ||
+        profile.call_rows_.size() != profile.calls_.size() ||
+        profile.call_targets_.size() != profile.calls_.size() ||
+        profile.components_.size() != nfunctions) {
+      return false;
+    }
+    for (const auto *columns :
+         {&profile.self_costs_, &profile.inclusive_costs_}) {
+      for (const auto &column : *columns) {
+        if (column.size() != nfunctions) return false;
+      }
+    }
+    auto within = [](const ChunkedArray<Profile::ListRef> &lists,
+                     uint64_t size) {
+      return std::all_of(lists.begin(), lists.end(),
+                         [size](const Profile::ListRef &list) {
+                           return list.size <= size &&
+                                  list.offset <= size - list.size;
+                         });
+    };
+    if (!within(profile.callee_lists_, profile.callee_calls_.size()) ||
+        !within(profile.caller_lists_, profile.callers_.size())) {
+      return false;
+    }
+    for (auto component : profile.components_) {
+      if (component >= profile.component_recursive_.size()) return false;
+    }
+    const auto nnames = profile.names_.size();
+    for (const auto *names :
+         {&profile.objects_, &profile.files_, &profile.symbols_}) {
+      for (auto name : *names) {
+        if (name >= nnames) return false;
+      }
+    }
+    for (const auto &block : profile.blocks_) {
+      if (block.function >= nfunctions ||
+          block.offset + block.nrows > profile.cost_rows_.size()) {
+        return false;
+      }
+    }
+    for (const auto &call : profile.calls_) {
+      if (call.caller >= nfunctions || call.callee >= nfunctions ||
+          call.cost_offset >= profile.call_rows_.size()) {
+        return false;
+      }
+    }
+    for (auto function : profile.entries_) {
+      if (function >= nfunctions) return false;
+    }
+    for (auto call : profile.callee_calls_) {
+      if (call >= profile.calls_.size()) return false;
+    }
+    for (auto function : profile.callers_) {
+      if (function >= nfunctions) return false;
+    }
+    return true;
+  }
+
+  static constexpr uint64_t padding(uint64_t size) { return -size & 7; }
+
+  struct Writer {
+    std::ofstream &out;
+
+    void writeBytes(const void *bytes, uint64_t size) {
+      static constexpr char kZeros[8] = {};
+      out.write(static_cast<const char *>(bytes), size);
+      out.write(kZeros, padding(size));
+    }
+    template <typename T>
+    void write(const T &value) {
+      static_assert(std::is_trivially_copyable_v<T>);
+      writeBytes(&value, sizeof(T));
+    }
+    /* the rows, padded as a whole */
+    template <typename T>
+    void writeArray(const ChunkedArray<T> &values) {
+      static constexpr char kZeros[8] = {};
+      const auto row_bytes = values.width() * sizeof(T);
+      write(uint64_t(values.size()));
+      values.forEachRun([this, row_bytes](const T *run, size_t nrows) {
+        out.write(reinterpret_cast<const char *>(run), nrows * row_bytes);
+      });
+      out.write(kZeros, padding(values.size() * row_bytes));
+    }
+    void writeString(std::string_view string) {
+      write(uint64_t(string.size()));
+      writeBytes(string.data(), string.size());
+    }
+    void writeStrings(const std::vector<std::string> &strings) {
+      write(uint64_t(strings.size()));
+      for (const auto &string : strings) writeString(string);
+    }
+    void writeRows(const RowStore &rows) {
+      write(uint64_t(rows.size()));
+      rows.forEachRun([this, &rows](const uint64_t *run, size_t nrows) {
+        out.write(reinterpret_cast<const char *>(run),
+                  nrows * rows.width() * sizeof(uint64_t));
+      });
+    }
+  };
+
+  struct Reader {
+    std::string_view data;
+
+    /* the data starts 8-byte aligned and stays so */
+    const char *take(uint64_t size) {
+      if (size > data.size() || padding(size) > data.size() - size) {
+        throw std::runtime_error("Truncated profile cache");
+      }
+      const auto taken = data.data();
+      data.remove_prefix(size + padding(size));
+      return taken;
+    }
+    template <typename T>
+    void read(T &value) {
+      static_assert(std::is_trivially_copyable_v<T>);
+      std::memcpy(&value, take(sizeof(T)), sizeof(T));
+    }
+    uint64_t readCount(size_t element_size) {
+      uint64_t count = 0;
+      read(count);
+      if (element_size > 0 && count > data.size() / element_size) {
+        throw std::runtime_error("Truncated profile cache");
+      }
+      return count;
+    }
+    /* copied out as one run, so the lists stay contiguous */
+    template <typename T>
+    void readArray(ChunkedArray<T> &values) {
+      const auto row_bytes = values.width() * sizeof(T);
+      const auto nrows = readCount(row_bytes);
+      const auto bytes = take(nrows * row_bytes);
+      values.clear();
+      if (nrows > 0) {
+        std::memcpy(values.appendRows(nrows), bytes, nrows * row_bytes);
+      }
+    }
+    void readStrings(std::vector<std::string> &strings) {
+      strings.resize(readCount(sizeof(uint64_t)));
+      for (auto &string : strings) {
+        const auto size = readCount(1);
+        string.assign(take(size), size);
+      }
+    }
+    void readRows(RowStore &rows) {
+      const auto row_bytes = rows.width() * sizeof(uint64_t);
+      const auto nrows = readCount(row_bytes);
+      rows.adoptRows(
+          reinterpret_cast<const uint64_t *>(take(nrows * row_bytes)), nrows);
+    }
+  };
+};
+
+#endif  // CALLGRIND_VIEWER__PROFILECACHE_HPP_
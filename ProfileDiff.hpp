@@ -0,0 +1,252 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CALLGRIND_VIEWER__PROFILEDIFF_HPP_
+#define CALLGRIND_VIEWER__PROFILEDIFF_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Profile.hpp"
+
+/* Differences between a base and a current profile of the same program.
+
+   The compared profiles are joined into one profile of the union of their
+   functions, matched on their (ob, fl, fn) names, and of their calls,
+   matched on (caller, callee). Its events are those of the current
+   profile followed by the same events named "E (base)" with the costs of
+   the base profile, so the usual inclusive costs and indices of the joined
+   profile hold both sides. Events are matched by name, the
+   ones missing from the base profile cost 0 there.
+
+   Functions keep their self costs only, by a single row; the positions of
+   cost lines and calls are not compared. Names are joined through the
+   hash table of the joined names, calls through the callee lists of each
+   caller; both are linear in the size of the profiles. */
+class ProfileDiff {
+ public:
+  using FunctionId = Profile::FunctionId;
+  using CallId = Profile::CallId;
+  using Cost = Profile::Cost;
+  using Delta = int64_t;
+
+  /* both profiles are finalized */
+  ProfileDiff(const Profile &base, const Profile &current) {
+    const auto nevents = current.events().size();
+    nevents_ = nevents;
+    auto profile = std::make_shared<Profile>();
+    auto events = current.events();
+    for (const auto &event : current.events()) {
+      events.push_back(event + " (base)");
+    }
+    profile->setPositions(current.positions());
+    profile->setEvents(std::move(events));
+
+    /* the column of each current event in the base profile */
+    std::vector<size_t> base_columns(nevents, kNoColumn);
+    for (size_t event = 0; event < nevents; ++event) {
+      const auto &base_events = base.events();
+      const auto found = std::find(begin(base_events), end(base_events),
+                                   current.events()[event]);
+      if (found != end(base_events)) {
+        base_columns[event] = size_t(found - begin(base_events));
+      }
+    }
+
+    const auto current_functions = joinFunctions(current, *profile);
+    const auto base_functions = joinFunctions(base, *profile);
+    const auto nfunctions = profile->functionCount();
+
+    /* self costs, a row for every function with a body on either side */
+    const auto width = 2 * nevents;
+    std::vector<Cost> self_costs(nfunctions * width, 0);
+    std::vector<bool> has_body(nfunctions, false);
+    for (auto function : current.entries()) {
+      const auto joined = current_functions[function];
+      has_body[joined] = true;
+      for (size_t event = 0; event < nevents; ++event) {
+        self_costs[joined * width + event] = current.selfCost(function, event);
+      }
+    }
+    for (auto function : base.entries()) {
+      const auto joined = base_functions[function];
+      has_body[joined] = true;
+      for (size_t event = 0; event < nevents; ++event) {
+        if (base_columns[event] == kNoColumn) continue;
+        self_costs[joined * width + nevents + event] =
+            base.selfCost(function, base_columns[event]);
+      }
+    }
+    const std::vector<Profile::SubPosition> positions(
+        current.positions().size(), 0);
+    for (FunctionId function = 0; function < nfunctions; ++function) {
+      if (has_body[function]) {
+        profile->addCost(function, positions.data(),
+                         self_costs.data() + function * width);
+      }
+    }
+
+    /* calls summed by (caller, callee): the calls of both sides of each
+       joined caller, the callees seen for it marked in an array */
+    std::vector<FunctionId> current_of(nfunctions, Profile::kNoFunction);
+    std::vector<FunctionId> base_of(nfunctions, Profile::kNoFunction);
+    for (FunctionId function = 0; function < current_functions.size();
+         ++function) {
+      current_of[current_functions[function]] = function;
+    }
+    for (FunctionId function = 0; function < base_functions.size();
+         ++function) {
+      base_of[base_functions[function]] = function;
+    }
+    struct JoinedCall {
+      FunctionId caller;
+      FunctionId callee;
+      uint64_t ncalls;
+      uint64_t base_ncalls;
+    };
+    std::vector<JoinedCall> calls;
+    std::vector<Cost> call_costs;
+    std::vector<FunctionId> marks(nfunctions, Profile::kNoFunction);
+    std::vector<size_t> slots(nfunctions);
+    auto joinCall = [&](FunctionId caller, FunctionId callee) {
+      if (marks[callee] != caller) {
+        marks[callee] = caller;
+        slots[callee] = calls.size();
+        calls.push_back({caller, callee, 0, 0});
+        call_costs.resize(call_costs.size() + width, 0);
+      }
+      return slots[callee];
+    };
+    for (FunctionId caller = 0; caller < nfunctions; ++caller) {
+      if (current_of[caller] != Profile::kNoFunction) {
+        for (auto call : current.calls(current_of[caller])) {
+          const auto &edge = current.call(call);
+          const auto joined = joinCall(caller, current_functions[edge.callee]);
+          calls[joined].ncalls += edge.ncalls;
+          const auto costs = current.callCost(call);
+          auto joined_costs = call_costs.data() + joined * width;
+          for (size_t event = 0; event < nevents; ++event) {
+            joined_costs[event] += costs[event];
+          }
+        }
+      }
+      if (base_of[caller] != Profile::kNoFunction) {
+        for (auto call : base.calls(base_of[caller])) {
+          const auto &edge = base.call(call);
+          const auto joined = joinCall(caller, base_functions[edge.callee]);
+          calls[joined].base_ncalls += edge.ncalls;
+          const auto costs = base.callCost(call);
+          auto joined_costs = call_costs.data() + joined * width + nevents;
+          for (size_t event = 0; event < nevents; ++event) {
+            if (base_columns[event] == kNoColumn) continue;
+            joined_costs[event] += costs[base_columns[event]];
+          }
+        }
+      }
+    }
+    base_ncalls_.reserve(calls.size());
+    for (size_t call = 0; call < calls.size(); ++call) {
+      profile->addCall(calls[call].caller, calls[call].callee,
+                       calls[call].ncalls, positions.data(), positions.data(),
+                       call_costs.data() + call * width);
+      base_ncalls_.push_back(calls[call].base_ncalls);
+    }
+
+    profile->finalize();
+    profile_ = std::move(profile);
+  }
+
+  /* the joined profile */
+  const std::shared_ptr<const Profile> &profile() const { return profile_; }
+  /* the compared events, the first ones of the joined profile */
+  size_t eventCount() const { return nevents_; }
+  size_t baseEvent(size_t event) const { return nevents_ + event; }
+
+  /* current minus base */
+  Delta inclusiveDelta(FunctionId function, size_t event) const {
+    return Delta(profile_->inclusiveCost(function, event)) -
+           Delta(profile_->inclusiveCost(function, baseEvent(event)));
+  }
+  Delta selfDelta(FunctionId function, size_t event) const {
+    return Delta(profile_->selfCost(function, event)) -
+           Delta(profile_->selfCost(function, baseEvent(event)));
+  }
+  Delta callDelta(CallId call, size_t event) const {
+    const auto costs = profile_->callCost(call);
+    return Delta(costs[event]) - Delta(costs[baseEvent(event)]);
+  }
+  /* the number of calls in the base profile, the one of the joined call is
+     the current one */
+  uint64_t baseCalls(CallId call) const { return base_ncalls_[call]; }
+
+  /* the entries by inclusive delta of event, the most slowed down first */
+  std::vector<FunctionId> entriesByDelta(size_t event) const {
+    const auto &entries = profile_->entries();
+    std::vector<FunctionId> sorted(entries.begin(), entries.end());
+    std::vector<Delta> deltas(profile_->functionCount());
+    for (auto function : sorted) {
+      deltas[function] = inclusiveDelta(function, event);
+    }
+    std::stable_sort(begin(sorted), end(sorted),
+                     [&deltas](FunctionId lhs, FunctionId rhs) {
+                       return deltas[lhs] > deltas[rhs];
+                     });
+    return sorted;
+  }
+  /* outgoing calls by delta of event */
+  std::vector<CallId> callsByDelta(FunctionId function, size_t event) const {
+    const auto span = profile_->calls(function);
+    std::vector<CallId> sorted(span.begin(), span.end());
+    std::stable_sort(begin(sorted), end(sorted),
+                     [this, event](CallId lhs, CallId rhs) {
+                       return callDelta(lhs, event) > callDelta(rhs, event);
+                     });
+    return sorted;
+  }
+
+ private:
+  static constexpr size_t kNoColumn = size_t(-1);
+
+  /* the joined function of every function of profile */
+  static std::vector<FunctionId> joinFunctions(const Profile &profile,
+                                               Profile &joined) {
+    const auto &names = profile.names();
+    std::vector<Profile::NameId> joined_names(names.size());
+    for (Profile::NameId name = 0; name < names.size(); ++name) {
+      joined_names[name] = joined.names().intern(names[name]);
+    }
+    std::vector<FunctionId> functions(profile.functionCount());
+    for (FunctionId function = 0; function < functions.size(); ++function) {
+      functions[function] =
+          joined.addFunction(joined_names[profile.objectName(function)],
+                             joined_names[profile.fileName(function)],
+                             joined_names[profile.symbolName(function)]);
+    }
+    return functions;
+  }
+
+  std::shared_ptr<const Profile> profile_;
+  size_t nevents_{0};
+  std::vector<uint64_t> base_ncalls_;
+};
+
+#endif  // CALLGRIND_VIEWER__PROFILEDIFF_HPP_
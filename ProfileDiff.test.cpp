@@ -0,0 +1,122 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ProfileDiff.hpp"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+struct Call {
+  const char *callee;
+  uint64_t ncalls;
+  Profile::Cost cost;
+};
+
+/* main with a self cost of 10 calling functions which cost what they are
+   called for */
+void buildProfile(Profile &profile, std::vector<std::string> events,
+                  const std::vector<Call> &calls) {
+  profile.setPositions({"line"});
+  const auto nevents = events.size();
+  profile.setEvents(std::move(events));
+  auto &names = profile.names();
+  auto object = names.intern("a.out");
+  auto file = names.intern("a.c");
+  auto main_function = profile.addFunction(object, file, names.intern("main"));
+  const Profile::SubPosition line[] = {1};
+  const std::vector<Profile::Cost> main_cost(nevents, 10);
+  profile.addCost(main_function, line, main_cost.data());
+  for (const auto &call : calls) {
+    auto callee = profile.addFunction(object, file, names.intern(call.callee));
+    const std::vector<Profile::Cost> cost(nevents, call.cost);
+    profile.addCall(main_function, callee, call.ncalls, line, line,
+                    cost.data());
+    profile.addCost(callee, line, cost.data());
+  }
+  profile.finalize();
+}
+
+Profile::FunctionId findFunction(const Profile &profile,
+                                 std::string_view symbol) {
+  for (Profile::FunctionId function = 0; function < profile.functionCount();
+       ++function) {
+    if (profile.symbol(function) == symbol) return function;
+  }
+  return Profile::kNoFunction;
+}
+
+}  // namespace
+
+TEST(ProfileDiff, JoinsFunctionsAndCalls) {
+  Profile base;
+  buildProfile(base, {"Ir"},
+               {{"same", 1, 5}, {"slower", 1, 10}, {"gone", 4, 20}});
+  Profile current;
+  buildProfile(current, {"Ir"},
+               {{"slower", 3, 40}, {"new", 1, 7}, {"same", 1, 5}});
+  const ProfileDiff diff(base, current);
+  const auto &profile = *diff.profile();
+
+  EXPECT_EQ(diff.eventCount(), 1);
+  EXPECT_EQ(profile.events(), (std::vector<std::string>{"Ir", "Ir (base)"}));
+  ASSERT_EQ(profile.functionCount(), 5);
+  const auto main_function = findFunction(profile, "main");
+  const auto slower = findFunction(profile, "slower");
+  const auto added = findFunction(profile, "new");
+  const auto gone = findFunction(profile, "gone");
+  const auto same = findFunction(profile, "same");
+
+  EXPECT_EQ(diff.inclusiveDelta(main_function, 0), (10 + 40 + 7 + 5) -
+                                                       (10 + 5 + 10 + 20));
+  EXPECT_EQ(diff.inclusiveDelta(slower, 0), 30);
+  EXPECT_EQ(diff.inclusiveDelta(added, 0), 7);
+  EXPECT_EQ(diff.inclusiveDelta(gone, 0), -20);
+  EXPECT_EQ(diff.selfDelta(same, 0), 0);
+  EXPECT_EQ(diff.entriesByDelta(0),
+            (std::vector<Profile::FunctionId>{slower, main_function, added,
+                                              same, gone}));
+
+  const auto calls = diff.callsByDelta(main_function, 0);
+  ASSERT_EQ(calls.size(), 4);
+  EXPECT_EQ(profile.call(calls[0]).callee, slower);
+  EXPECT_EQ(profile.call(calls[0]).ncalls, 3);
+  EXPECT_EQ(diff.baseCalls(calls[0]), 1);
+  EXPECT_EQ(diff.callDelta(calls[0], 0), 30);
+  EXPECT_EQ(profile.call(calls[3]).callee, gone);
+  EXPECT_EQ(profile.call(calls[3]).ncalls, 0);
+  EXPECT_EQ(diff.baseCalls(calls[3]), 4);
+}
+
+TEST(ProfileDiff, MatchesEventsByName) {
+  Profile base;
+  buildProfile(base, {"D1mr", "Ir"}, {{"f", 1, 5}});
+  Profile current;
+  buildProfile(current, {"Ir", "Bcm"}, {{"f", 1, 8}});
+  const ProfileDiff diff(base, current);
+  const auto &profile = *diff.profile();
+
+  EXPECT_EQ(profile.events(), (std::vector<std::string>{
+                                  "Ir", "Bcm", "Ir (base)", "Bcm (base)"}));
+  const auto f = findFunction(profile, "f");
+  EXPECT_EQ(diff.inclusiveDelta(f, 0), 3);
+  /* no Bcm in the base */
+  EXPECT_EQ(diff.inclusiveDelta(f, 1), 8);
+  EXPECT_EQ(profile.inclusiveCost(f, diff.baseEvent(0)), 5);
+}
@@ -0,0 +1,307 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CALLGRIND_VIEWER__PROFILEGENERATOR_HPP_
+#define CALLGRIND_VIEWER__PROFILEGENERATOR_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/* Writes a synthetic callgrind profile for benchmarks: "fn=" blocks of
+   cost lines and calls over a fixed set of functions, repeated until the
+   text reaches the requested size. The output is the same for the same
+   options. */
+class ProfileGenerator {
+ public:
+  struct Options {
+    /* bytes of text, the last block ends a little after it */
+    uint64_t size{uint64_t(10) << 20};
+    /* if not 0, the number of "fn=" blocks instead of the size, the same
+       profile whatever the compression */
+    uint64_t blocks{0};
+    size_t symbols{10000};
+    size_t objects{16};
+    size_t files{1000};
+    size_t events{2};
+    /* cost lines and calls per "fn=" block */
+    size_t lines{8};
+    size_t fanout{4};
+    /* "instr line" positions instead of "line" */
+    bool instructions{false};
+    /* "(id)" for names seen before and relative sub-positions, what
+       valgrind writes by default */
+    bool compress_names{true};
+    bool compress_positions{true};
+    uint64_t seed{1};
+  };
+
+  /* text is produced in buffers of about this size */
+  static constexpr size_t kBufferSize = size_t(1) << 20;
+
+  explicit ProfileGenerator(Options options) : options_(std::move(options)) {
+    options_.symbols = std::max<size_t>(options_.symbols, 1);
+    options_.objects = std::max<size_t>(options_.objects, 1);
+    options_.files = std::max<size_t>(options_.files, 1);
+    options_.events = std::clamp<size_t>(options_.events, 1, kEventCount);
+  }
+
+  /* calls output(std::string_view) with consecutive pieces of the text,
+     returns its size */
+  template <typename Output>
+  uint64_t write(Output &&output) {
+    std::mt19937_64 random(options_.seed);
+    const size_t npositions = options_.instructions ? 2 : 1;
+    std::vector<bool> object_seen(options_.objects);
+    std::vector<bool> file_seen(options_.files);
+    std::vector<bool> symbol_seen(options_.symbols);
+    std::vector<uint64_t> position(npositions, 0);
+    std::vector<uint64_t> totals(options_.events, 0);
+    size_t object = SIZE_MAX;
+    size_t file = SIZE_MAX;
+
+    uint64_t written = 0;
+    std::string buffer;
+    buffer.reserve(kBufferSize + 4096);
+    auto flush = [&] {
+      output(std::string_view(buffer));
+      written += buffer.size();
+      buffer.clear();
+    };
+
+    buffer += "# callgrind format\nversion: 1\n"
+              "creator: cursegrind_generate\npid: 1\ncmd: synthetic\n"
+              "part: 1\n\npositions: ";
+    buffer += options_.instructions ? "instr line" : "line";
+    buffer += "\nevents:";
+    for (size_t event = 0; event < options_.events; ++event) {
+      buffer += ' ';
+      buffer += kEvents[event];
+    }
+    buffer += "\n\n";
+
+    /* a function has a fixed object and file, its lines are near a base
+       depending on it */
+    auto objectOf = [this](size_t symbol) {
+      return symbol % options_.objects;
+    };
+    auto fileOf = [this](size_t symbol) {
+      return symbol * options_.files / options_.symbols;
+    };
+    auto baseOf = [](size_t symbol) { return 10 + symbol * 37 % 5000; };
+
+    auto name = [&](const char *key, std::vector<bool> &seen, size_t id,
+                    auto &&text) {
+      buffer += key;
+      buffer += '=';
+      if (options_.compress_names) {
+        buffer += '(';
+        buffer += std::to_string(id + 1);
+        buffer += ')';
+        if (seen[id]) {
+          buffer += '\n';
+          return;
+        }
+        seen[id] = true;
+        buffer += ' ';
+      }
+      text();
+      buffer += '\n';
+    };
+    auto objectName = [&](const char *key, size_t id) {
+      name(key, object_seen, id, [&] {
+        buffer += "/usr/lib/libsynthetic";
+        buffer += std::to_string(id);
+        buffer += ".so";
+      });
+    };
+    auto fileName = [&](const char *key, size_t id) {
+      name(key, file_seen, id, [&] {
+        buffer += "/src/module";
+        buffer += std::to_string(id % 97);
+        buffer += "/file";
+        buffer += std::to_string(id);
+        buffer += ".cpp";
+      });
+    };
+    auto symbolName = [&](const char *key, size_t id) {
+      name(key, symbol_seen, id, [&] {
+        buffer += "ns";
+        buffer += std::to_string(id % 53);
+        buffer += "::Class";
+        buffer += std::to_string(id % 1009);
+        buffer += "::method";
+        buffer += std::to_string(id);
+        buffer += "(std::vector<int, std::allocator<int> > const&, int)";
+      });
+    };
+
+    /* a line of sub-positions, moved from the current ones by a small
+       step */
+    auto subPositions = [&](const std::vector<uint64_t> &target,
+                            bool update) {
+      for (size_t index = 0; index < npositions; ++index) {
+        if (index > 0) buffer += ' ';
+        const auto value = target[index];
+        const auto current = position[index];
+        if (!options_.compress_positions) {
+          appendNumber(buffer, value, index == 0 && options_.instructions);
+        } else if (value == current) {
+          buffer += '*';
+        } else if (value > current) {
+          buffer += '+';
+          appendNumber(buffer, value - current, false);
+        } else {
+          buffer += '-';
+          appendNumber(buffer, current - value, false);
+        }
+      }
+      if (update) position = target;
+    };
+    auto costs = [&](uint64_t scale, bool self) {
+      for (size_t event = 0; event < options_.events; ++event) {
+        const auto cost = (random() % 100 + 1) * scale >> event;
+        if (self) totals[event] += cost;
+        buffer += ' ';
+        appendNumber(buffer, cost, false);
+      }
+      buffer += '\n';
+    };
+
+    /* visits the functions in an order that mixes the objects and files */
+    const auto stride = coprimeStride(options_.symbols);
+    std::vector<uint64_t> target(npositions);
+    for (uint64_t block = 0;
+         options_.blocks != 0 ? block < options_.blocks
+                              : written + buffer.size() < options_.size;
+         ++block) {
+      const auto symbol = size_t(block * stride % options_.symbols);
+      if (objectOf(symbol) != object) {
+        object = objectOf(symbol);
+        objectName("ob", object);
+      }
+      if (fileOf(symbol) != file) {
+        file = fileOf(symbol);
+        fileName("fl", file);
+      }
+      symbolName("fn", symbol);
+
+      auto line = baseOf(symbol);
+      auto address = 0x400000 + uint64_t(symbol) * 0x100;
+      auto step = [&] {
+        line += random() % 3;
+        address += random() % 8 + 1;
+        if (options_.instructions) {
+          target[0] = address;
+          target[1] = line;
+        } else {
+          target[0] = line;
+        }
+      };
+      for (size_t iline = 0; iline < options_.lines; ++iline) {
+        step();
+        subPositions(target, true);
+        costs(1, true);
+      }
+      for (size_t icall = 0; icall < options_.fanout; ++icall) {
+        /* calls go mostly to a few hot functions */
+        const auto callee =
+            random() % 4 == 0
+                ? size_t(random() % std::min<size_t>(options_.symbols, 64))
+                : size_t(random() % options_.symbols);
+        if (objectOf(callee) != object) objectName("cob", objectOf(callee));
+        if (fileOf(callee) != file) fileName("cfi", fileOf(callee));
+        symbolName("cfn", callee);
+        buffer += "calls=";
+        appendNumber(buffer, random() % 16 + 1, false);
+        buffer += ' ';
+        std::vector<uint64_t> callee_position(npositions);
+        callee_position[npositions - 1] = baseOf(callee);
+        if (options_.instructions) {
+          callee_position[0] = 0x400000 + uint64_t(callee) * 0x100;
+        }
+        subPositions(callee_position, false);
+        buffer += '\n';
+        step();
+        subPositions(target, true);
+        costs(1000, false);
+      }
+      buffer += '\n';
+      if (buffer.size() >= kBufferSize) flush();
+    }
+
+    buffer += "totals:";
+    for (auto total : totals) {
+      buffer += ' ';
+      appendNumber(buffer, total, false);
+    }
+    buffer += '\n';
+    flush();
+    return written;
+  }
+
+  uint64_t writeFile(const std::string &filename) {
+    std::FILE *file = std::fopen(filename.c_str(), "wb");
+    if (!file) throw std::runtime_error("Cannot open " + filename);
+    bool failed = false;
+    const auto written = write([&](std::string_view text) {
+      failed = failed ||
+               std::fwrite(text.data(), 1, text.size(), file) != text.size();
+    });
+    failed = std::fclose(file) != 0 || failed;
+    if (failed) throw std::runtime_error("Cannot write " + filename);
+    return written;
+  }
+
+ private:
+  static constexpr size_t kEventCount = 9;
+  static constexpr const char *kEvents[kEventCount] = {
+      "Ir", "Dr", "Dw", "I1mr", "D1mr", "D1mw", "ILmr", "DLmr", "DLmw"};
+
+  static void appendNumber(std::string &buffer, uint64_t value, bool hex) {
+    char digits[24];
+    auto end = digits + sizeof(digits);
+    auto begin = end;
+    const unsigned base = hex ? 16 : 10;
+    do {
+      *--begin = "0123456789abcdef"[value % base];
+      value /= base;
+    } while (value != 0);
+    if (hex) buffer += "0x";
+    buffer.append(begin, end);
+  }
+
+  /* a step near n / 2 that visits all of [0, n) */
+  static uint64_t coprimeStride(uint64_t n) {
+    auto stride = std::max<uint64_t>(n / 2 + 1, 1);
+    while (std::gcd(stride, n) != 1) ++stride;
+    return stride;
+  }
+
+  Options options_;
+};
+
+#endif  // CALLGRIND_VIEWER__PROFILEGENERATOR_HPP_
@@ -0,0 +1,87 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ProfileGenerator.hpp"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+
+#include "CallgrindParser.hpp"
+
+namespace {
+
+std::shared_ptr<const Profile> generateAndParse(
+    const std::string &name, const ProfileGenerator::Options &options) {
+  const auto path = (std::filesystem::temp_directory_path() / name).string();
+  ProfileGenerator(options).writeFile(path);
+  CallgrindParser parser(path);
+  parser.parse();
+  EXPECT_EQ(parser.totals().size(), options.events);
+  for (size_t event = 0; event < parser.totals().size(); ++event) {
+    EXPECT_EQ(parser.totals()[event],
+              parser.getProfile()->totalSelfCost(event));
+  }
+  std::filesystem::remove(path);
+  return parser.getProfile();
+}
+
+}  // namespace
+
+TEST(ProfileGenerator, Parses) {
+  ProfileGenerator::Options options;
+  options.size = 256 << 10;
+  options.symbols = 300;
+  options.events = 3;
+  const auto profile = generateAndParse("generated.out", options);
+  EXPECT_EQ(profile->functionCount(), options.symbols);
+  EXPECT_EQ(profile->events().size(), 3);
+  EXPECT_GT(profile->callCount(), 0);
+  for (Profile::FunctionId function = 0; function < profile->functionCount();
+       ++function) {
+    EXPECT_GT(profile->selfCost(function, Profile::kPrimaryEvent), 0);
+  }
+}
+
+TEST(ProfileGenerator, CompressionKeepsTheProfile) {
+  ProfileGenerator::Options options;
+  options.blocks = 500;
+  options.symbols = 100;
+  options.instructions = true;
+  const auto compressed = generateAndParse("compressed.out", options);
+  options.compress_names = false;
+  options.compress_positions = false;
+  const auto plain = generateAndParse("plain.out", options);
+
+  ASSERT_EQ(compressed->functionCount(), plain->functionCount());
+  ASSERT_EQ(compressed->callCount(), plain->callCount());
+  for (Profile::FunctionId function = 0;
+       function < compressed->functionCount(); ++function) {
+    EXPECT_EQ(compressed->symbol(function), plain->symbol(function));
+    EXPECT_EQ(compressed->selfCost(function), plain->selfCost(function));
+    EXPECT_EQ(compressed->inclusiveCost(function),
+              plain->inclusiveCost(function));
+  }
+  for (Profile::CallId call = 0; call < compressed->callCount(); ++call) {
+    const auto lhs = compressed->callTargetSubPositions(call);
+    const auto rhs = plain->callTargetSubPositions(call);
+    EXPECT_EQ(std::vector<uint64_t>(lhs.begin(), lhs.end()),
+              std::vector<uint64_t>(rhs.begin(), rhs.end()));
+  }
+}
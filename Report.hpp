@@ -0,0 +1,186 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CALLGRIND_VIEWER__REPORT_HPP_
+#define CALLGRIND_VIEWER__REPORT_HPP_
+
+#include <cstdio>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "Profile.hpp"
+
+/* Hotspot summary of a profile for scripts and CI: the top entries by the
+   inclusive cost of an event with their self cost and share of the total,
+   as text, CSV or JSON. Rows are written as they are formatted. */
+class Report {
+ public:
+  enum class Format { Text, Csv, Json };
+
+  static Format parseFormat(std::string_view name) {
+    if (name == "text") return Format::Text;
+    if (name == "csv") return Format::Csv;
+    if (name == "json") return Format::Json;
+    throw std::runtime_error("Unknown report format " + std::string(name) +
+                             ", expected text, csv or json");
+  }
+
+  /* index of the event called name */
+  static size_t findEvent(const Profile &profile, std::string_view name) {
+    const auto &events = profile.events();
+    for (size_t event = 0; event < events.size(); ++event) {
+      if (events[event] == name) return event;
+    }
+    std::string known;
+    for (const auto &event : events) known += " " + event;
+    throw std::runtime_error("Unknown event " + std::string(name) +
+                             ", the profile has:" + known);
+  }
+
+  Report(const Profile &profile, size_t event, size_t top)
+      : profile_(profile), event_(event), top_(top) {
+    if (event_ >= profile_.events().size()) {
+      throw std::runtime_error("The profile has no events");
+    }
+  }
+
+  /* the name of the profile, e.g. its file, is written in the header */
+  void write(std::ostream &os, Format format,
+             std::string_view title = {}) const {
+    const auto total = profile_.totalSelfCost(event_);
+    const auto &event = profile_.events()[event_];
+    const auto entries = profile_.topEntriesBy(event_, top_);
+
+    switch (format) {
+      case Format::Text:
+        if (!title.empty()) os << title << "\n";
+        os << event << " total " << total << ", top " << entries.size()
+           << " of " << profile_.entries().size()
+           << " entries by inclusive cost\n\n";
+        {
+          char header[96];
+          std::snprintf(header, sizeof(header), "%9s %17s %17s  %s\n",
+                        "share", "inclusive", "self", "symbol (object)");
+          os << header;
+        }
+        break;
+      case Format::Csv:
+        os << "rank,event,inclusive,self,percent,symbol,file,object\n";
+        break;
+      case Format::Json:
+        os << "{\"title\": ";
+        writeJsonString(os, title);
+        os << ", \"event\": ";
+        writeJsonString(os, event);
+        os << ", \"total\": " << total
+           << ", \"entries_count\": " << profile_.entries().size()
+           << ", \"entries\": [";
+        break;
+    }
+
+    for (size_t rank = 0; rank < entries.size(); ++rank) {
+      const auto function = entries[rank];
+      const auto inclusive = profile_.inclusiveCost(function, event_);
+      const auto self = profile_.selfCost(function, event_);
+      const auto percent = total == 0 ? 0. : 100. * double(inclusive) / total;
+      char numbers[96];
+      switch (format) {
+        case Format::Text:
+          std::snprintf(numbers, sizeof(numbers), "%8.2f%% %17llu %17llu",
+                        percent, (unsigned long long)inclusive,
+                        (unsigned long long)self);
+          os << numbers << "  " << profile_.symbol(function) << " ("
+             << profile_.object(function) << ")\n";
+          break;
+        case Format::Csv:
+          std::snprintf(numbers, sizeof(numbers), "%zu,", rank + 1);
+          os << numbers;
+          writeCsvField(os, event);
+          std::snprintf(numbers, sizeof(numbers), ",%llu,%llu,%.4f,",
+                        (unsigned long long)inclusive,
+                        (unsigned long long)self, percent);
+          os << numbers;
+          writeCsvField(os, profile_.symbol(function));
+          os << ',';
+          writeCsvField(os, profile_.file(function));
+          os << ',';
+          writeCsvField(os, profile_.object(function));
+          os << '\n';
+          break;
+        case Format::Json:
+          std::snprintf(numbers, sizeof(numbers),
+                        "%s\n  {\"rank\": %zu, \"inclusive\": %llu, "
+                        "\"self\": %llu, \"percent\": %.4f, \"symbol\": ",
+                        rank == 0 ? "" : ",", rank + 1,
+                        (unsigned long long)inclusive,
+                        (unsigned long long)self, percent);
+          os << numbers;
+          writeJsonString(os, profile_.symbol(function));
+          os << ", \"file\": ";
+          writeJsonString(os, profile_.file(function));
+          os << ", \"object\": ";
+          writeJsonString(os, profile_.object(function));
+          os << '}';
+          break;
+      }
+    }
+
+    if (format == Format::Json) os << "\n]}\n";
+    os.flush();
+  }
+
+ private:
+  static void writeJsonString(std::ostream &os, std::string_view text) {
+    os << '"';
+    for (const char c : text) {
+      if (c == '"' || c == '\\') {
+        os << '\\' << c;
+      } else if (static_cast<unsigned char>(c) < 0x20) {
+        char escaped[8];
+        std::snprintf(escaped, sizeof(escaped), "\\u%04x", unsigned(c));
+        os << escaped;
+      } else {
+        os << c;
+      }
+    }
+    os << '"';
+  }
+
+  /* quoted if it has a separator, a quote or a line break */
+  static void writeCsvField(std::ostream &os, std::string_view text) {
+    if (text.find_first_of(",\"\r\n") == std::string_view::npos) {
+      os << text;
+      return;
+    }
+    os << '"';
+    for (const char c : text) {
+      if (c == '"') os << '"';
+      os << c;
+    }
+    os << '"';
+  }
+
+  const Profile &profile_;
+  size_t event_;
+  size_t top_;
+};
+
+#endif  // CALLGRIND_VIEWER__REPORT_HPP_
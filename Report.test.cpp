@@ -0,0 +1,92 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "Report.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+namespace {
+
+/* main calls "hot" and "a, b"; D1mr sorts them the other way */
+void buildProfile(Profile &profile) {
+  profile.setPositions({"line"});
+  profile.setEvents({"Ir", "D1mr"});
+  auto object = profile.names().intern("a.out");
+  auto file = profile.names().intern("a.c");
+  auto main_function =
+      profile.addFunction(object, file, profile.names().intern("main"));
+  auto hot = profile.addFunction(object, file, profile.names().intern("hot"));
+  auto quoted = profile.addFunction(object, file,
+                                    profile.names().intern("f(\"a, b\")"));
+  const Profile::SubPosition line[] = {1};
+  const Profile::Cost main_cost[] = {10, 0};
+  const Profile::Cost hot_cost[] = {60, 5};
+  const Profile::Cost quoted_cost[] = {30, 15};
+  profile.addCost(main_function, line, main_cost);
+  profile.addCall(main_function, hot, 1, line, line, hot_cost);
+  profile.addCall(main_function, quoted, 1, line, line, quoted_cost);
+  profile.addCost(hot, line, hot_cost);
+  profile.addCost(quoted, line, quoted_cost);
+  profile.finalize();
+}
+
+}  // namespace
+
+TEST(Report, Csv) {
+  Profile profile;
+  buildProfile(profile);
+  std::ostringstream os;
+  Report(profile, Report::findEvent(profile, "D1mr"), 2)
+      .write(os, Report::Format::Csv);
+  EXPECT_EQ(os.str(),
+            "rank,event,inclusive,self,percent,symbol,file,object\n"
+            "1,D1mr,20,0,100.0000,main,a.c,a.out\n"
+            "2,D1mr,15,15,75.0000,\"f(\"\"a, b\"\")\",a.c,a.out\n");
+}
+
+TEST(Report, Json) {
+  Profile profile;
+  buildProfile(profile);
+  std::ostringstream os;
+  Report(profile, Profile::kPrimaryEvent, 10)
+      .write(os, Report::Format::Json, "callgrind.out");
+  EXPECT_EQ(os.str(),
+            "{\"title\": \"callgrind.out\", \"event\": \"Ir\", "
+            "\"total\": 100, \"entries_count\": 3, \"entries\": [\n"
+            "  {\"rank\": 1, \"inclusive\": 100, \"self\": 10, "
+            "\"percent\": 100.0000, \"symbol\": \"main\", \"file\": \"a.c\", "
+            "\"object\": \"a.out\"},\n"
+            "  {\"rank\": 2, \"inclusive\": 60, \"self\": 60, "
+            "\"percent\": 60.0000, \"symbol\": \"hot\", \"file\": \"a.c\", "
+            "\"object\": \"a.out\"},\n"
+            "  {\"rank\": 3, \"inclusive\": 30, \"self\": 30, "
+            "\"percent\": 30.0000, \"symbol\": \"f(\\\"a, b\\\")\", "
+            "\"file\": \"a.c\", \"object\": \"a.out\"}\n"
+            "]}\n");
+}
+
+TEST(Report, Errors) {
+  Profile profile;
+  buildProfile(profile);
+  EXPECT_THROW(Report::findEvent(profile, "Bcm"), std::runtime_error);
+  EXPECT_THROW(Report::parseFormat("xml"), std::runtime_error);
+  EXPECT_EQ(Report::parseFormat("json"), Report::Format::Json);
+}
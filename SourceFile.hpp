@@ -0,0 +1,79 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CALLGRIND_VIEWER__SOURCEFILE_HPP_
+#define CALLGRIND_VIEWER__SOURCEFILE_HPP_
+
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "MappedFile.hpp"
+
+/* Lines of a source file. The file is mapped on the first request and its
+   lines are found only as far as they are asked for, so showing a few
+   lines of a big file reads only the pages up to them. */
+class SourceFile {
+ public:
+  explicit SourceFile(std::string filename) : filename_(std::move(filename)) {}
+
+  /* false if the file cannot be read */
+  bool readable() {
+    open();
+    return bool(file_);
+  }
+
+  /* text of the line by 1-based number without the line end, empty past
+     the end or if the file cannot be read */
+  std::string_view line(size_t number) {
+    open();
+    if (number == 0 || !file_) return {};
+    const auto text = file_.view();
+    while (line_starts_.size() < number && line_starts_.back() < text.size()) {
+      const auto start = line_starts_.back();
+      const auto eol = static_cast<const char *>(
+          std::memchr(text.data() + start, '\n', text.size() - start));
+      line_starts_.push_back(eol ? eol - text.data() + 1 : text.size());
+    }
+    if (line_starts_.size() < number) return {};
+    const auto start = line_starts_[number - 1];
+    if (start >= text.size()) return {};
+    auto line = text.substr(start);
+    line = line.substr(0, line.find('\n'));
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    return line;
+  }
+
+ private:
+  void open() {
+    if (opened_) return;
+    opened_ = true;
+    if (file_.map(filename_)) line_starts_.push_back(0);
+  }
+
+  std::string filename_;
+  bool opened_{false};
+  MappedFile file_;
+  /* offsets of the lines found so far */
+  std::vector<size_t> line_starts_;
+};
+
+#endif  // CALLGRIND_VIEWER__SOURCEFILE_HPP_
@@ -0,0 +1,46 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "SourceFile.hpp"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+
+TEST(SourceFile, Lines) {
+  const auto path =
+      (std::filesystem::temp_directory_path() / "source_file_test.c")
+          .string();
+  std::ofstream(path) << "int main() {\r\n  return 0;\n\n}";
+
+  SourceFile source(path);
+  EXPECT_TRUE(source.readable());
+  EXPECT_EQ(source.line(2), "  return 0;");
+  EXPECT_EQ(source.line(1), "int main() {");
+  EXPECT_EQ(source.line(3), "");
+  EXPECT_EQ(source.line(4), "}");
+  EXPECT_EQ(source.line(5), "");
+  EXPECT_EQ(source.line(0), "");
+
+  SourceFile missing(path + ".missing");
+  EXPECT_FALSE(missing.readable());
+  EXPECT_EQ(missing.line(1), "");
+  std::filesystem::remove(path);
+}
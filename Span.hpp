@@ -0,0 +1,58 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CALLGRIND_VIEWER__SPAN_HPP_
+#define CALLGRIND_VIEWER__SPAN_HPP_
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+/* Non-owning view of a contiguous range, a minimal std::span for C++17 */
+template <typename T>
+class Span {
+ public:
+  Span() = default;
+  Span(T *data, size_t size) : data_(data), size_(size) {}
+  template <typename U>
+  Span(std::vector<U> &vector) : data_(vector.data()), size_(vector.size()) {}
+  template <typename U>
+  Span(const std::vector<U> &vector)
+      : data_(vector.data()), size_(vector.size()) {}
+
+  T *data() const { return data_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  T *begin() const { return data_; }
+  T *end() const { return data_ + size_; }
+  T &operator[](size_t i) const {
+    assert(i < size_);
+    return data_[i];
+  }
+  Span subspan(size_t offset, size_t count) const {
+    assert(offset + count <= size_);
+    return {data_ + offset, count};
+  }
+
+ private:
+  T *data_{nullptr};
+  size_t size_{0};
+};
+
+#endif  // CALLGRIND_VIEWER__SPAN_HPP_
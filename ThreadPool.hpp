@@ -0,0 +1,96 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CALLGRIND_VIEWER__THREADPOOL_HPP_
+#define CALLGRIND_VIEWER__THREADPOOL_HPP_
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/* Fixed set of worker threads running submitted tasks. The destructor runs
+   the tasks still queued and joins the threads. */
+class ThreadPool {
+ public:
+  explicit ThreadPool(unsigned int threads) {
+    for (unsigned int ithread = 0; ithread < std::max(threads, 1u);
+         ++ithread) {
+      threads_.emplace_back([this] { run(); });
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    wakeup_.notify_all();
+    for (auto &thread : threads_) thread.join();
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  /* urgent tasks run before the ones already queued */
+  template <typename Task>
+  std::future<void> submit(Task &&task, bool urgent = false) {
+    std::packaged_task<void()> packaged(std::forward<Task>(task));
+    auto future = packaged.get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (urgent) {
+        tasks_.push_front(std::move(packaged));
+      } else {
+        tasks_.push_back(std::move(packaged));
+      }
+    }
+    wakeup_.notify_one();
+    return future;
+  }
+
+  size_t size() const { return threads_.size(); }
+
+ private:
+  void run() {
+    while (true) {
+      std::packaged_task<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wakeup_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+        if (tasks_.empty()) return;
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+      }
+      task();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable wakeup_;
+  std::deque<std::packaged_task<void()> > tasks_;
+  bool stopping_{false};
+  std::vector<std::thread> threads_;
+};
+
+#endif  // CALLGRIND_VIEWER__THREADPOOL_HPP_
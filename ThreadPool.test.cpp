@@ -0,0 +1,48 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ThreadPool.hpp"
+
+#include <atomic>
+
+#include <gtest/gtest.h>
+
+TEST(ThreadPool, RunsAllTasks) {
+  std::atomic<int> sum{0};
+  std::vector<std::future<void> > done;
+  {
+    ThreadPool pool(3);
+    EXPECT_EQ(pool.size(), 3);
+    for (int i = 1; i <= 100; ++i) {
+      done.push_back(pool.submit([&sum, i] { sum += i; }, i % 2 == 0));
+    }
+    done.front().wait();
+  }
+  /* the destructor drains the queue */
+  for (auto &future : done) future.get();
+  EXPECT_EQ(sum, 5050);
+}
+
+TEST(ThreadPool, Exceptions) {
+  ThreadPool pool(1);
+  auto failed = pool.submit([] { throw std::runtime_error("task"); });
+  EXPECT_THROW(failed.get(), std::runtime_error);
+  auto passed = pool.submit([] {});
+  EXPECT_NO_THROW(passed.get());
+}
@@ -0,0 +1,106 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include "CallgrindParser.hpp"
+#include "ProfileGenerator.hpp"
+#include "TreeNode.hpp"
+
+namespace {
+
+const Profile &generatedProfile() {
+  static const auto profile = [] {
+    ProfileGenerator::Options options;
+    options.size = uint64_t(8) << 20;
+    const auto path =
+        (std::filesystem::temp_directory_path() / "cursegrind_bench_rows.out")
+            .string();
+    ProfileGenerator(options).writeFile(path);
+    CallgrindParser parser(path);
+    parser.parse();
+    std::filesystem::remove(path);
+    return parser.getProfile();
+  }();
+  return *profile;
+}
+
+DisplayNames &displayNames() {
+  static DisplayNames names(generatedProfile());
+  return names;
+}
+
+NodeFormat format(const benchmark::State &state, const Profile &profile) {
+  NodeFormat format;
+  format.costs_view = CostsView(state.range(0));
+  format.name_view = ENameView(state.range(1));
+  displayNames().build(format.name_view);
+  format.names = &displayNames();
+  format.top_entry = profile.entries().front();
+  return format;
+}
+
+/* the text of every entry row, as the TreeView makes them when it is
+   scrolled through */
+void BM_FormatEntries(benchmark::State &state) {
+  const auto &profile = generatedProfile();
+  const auto node_format = format(state, profile);
+  TreeNode node;
+  node.kind = TreeNode::kEntry;
+  for (auto _ : state) {
+    for (auto entry : profile.entries()) {
+      node.function = entry;
+      benchmark::DoNotOptimize(formatNode(profile, node, node_format));
+    }
+  }
+  state.SetItemsProcessed(int64_t(state.iterations()) *
+                          int64_t(profile.entries().size()));
+}
+BENCHMARK(BM_FormatEntries)
+    ->ArgsProduct({{kAbsolute, kPersentage},
+                   {kSymbolOnly, kFileSymbol, kObjectSymbol,
+                    kCollapsedSymbol}})
+    ->Unit(benchmark::kMillisecond);
+
+void BM_FormatCalls(benchmark::State &state) {
+  const auto &profile = generatedProfile();
+  const auto node_format = format(state, profile);
+  TreeNode node;
+  node.kind = TreeNode::kCall;
+  for (auto _ : state) {
+    for (Profile::CallId call = 0; call < profile.callCount(); ++call) {
+      const auto &edge = profile.call(call);
+      node.function = edge.callee;
+      node.parent = edge.caller;
+      node.call = call;
+      benchmark::DoNotOptimize(formatNode(profile, node, node_format));
+    }
+  }
+  state.SetItemsProcessed(int64_t(state.iterations()) *
+                          int64_t(profile.callCount()));
+}
+BENCHMARK(BM_FormatCalls)
+    ->ArgsProduct({{kAbsolute, kPersentage}, {kSymbolOnly, kFileSymbol}})
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
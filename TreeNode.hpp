@@ -0,0 +1,207 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CALLGRIND_VIEWER__TREENODE_HPP_
+#define CALLGRIND_VIEWER__TREENODE_HPP_
+
+#include <cstdint>
+#include <cstdio>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include "DisplayNames.hpp"
+#include "Profile.hpp"
+#include "ProfileDiff.hpp"
+
+enum CostsView { kAbsolute, kPersentage };
+
+/* a visible row of the TreeView, made from the profile when its parent is
+   expanded; the level and whether it is selectable are kept by the
+   NodeList */
+struct TreeNode {
+  enum Kind : uint8_t { kEntry, kCaller, kCall, kOthers };
+  Kind kind{kEntry};
+  bool expandable{false};
+  bool is_expanded{false};
+  /* the function shown by the node, identifies it across profile updates */
+  Profile::FunctionId function{Profile::kNoFunction};
+  /* calls: the calling function and the call; callers: the called function
+     and the caller edge */
+  Profile::FunctionId parent{Profile::kNoFunction};
+  Profile::CallId call{0};
+  /* calls and callers: the function is already on the path to the node */
+  bool recursion{false};
+  /* others only: the rows below the threshold, the entries or the calls or
+     callers of parent from first on, and their summed cost */
+  bool others_callers{false};
+  uint32_t others_first{0};
+  uint32_t others_count{0};
+  Profile::Cost others_cost{0};
+};
+
+/* how the rows show costs and names */
+struct NodeFormat {
+  CostsView costs_view{kAbsolute};
+  ENameView name_view{kSymbolOnly};
+  size_t event{Profile::kPrimaryEvent};
+  /* percentages of entries are of its cost, the most expensive entry */
+  Profile::FunctionId top_entry{Profile::kNoFunction};
+  /* the profile is the joined one of the diff, costs are shown as the
+     change from the base */
+  const ProfileDiff *diff{nullptr};
+  /* the cost of the program, of which others nodes show their share */
+  Profile::Cost total{0};
+  /* built for name_view; without them names are symbols */
+  const DisplayNames *names{nullptr};
+};
+
+inline void formatName(std::ostream &os, const Profile &profile,
+                       Profile::FunctionId function, const NodeFormat &format) {
+  if (format.names) {
+    os << format.names->name(function, format.name_view);
+  } else {
+    os << profile.symbol(function);
+  }
+}
+
+/* "[+delta] [+relative%] " of a change from base */
+inline void formatDelta(std::ostream &os, ProfileDiff::Delta delta,
+                        Profile::Cost base) {
+  char text[48];
+  if (base != 0) {
+    std::snprintf(text, sizeof(text), "[%+9.2g] [%+7.1f%%] ", double(delta),
+                  100. * double(delta) / double(base));
+  } else {
+    std::snprintf(text, sizeof(text), "[%+9.2g] [%8s] ", double(delta),
+                  delta == 0 ? "=" : "new");
+  }
+  os << text;
+}
+
+inline std::string formatDiffNode(const Profile &profile, const TreeNode &node,
+                                  const NodeFormat &format) {
+  std::stringstream text_stream;
+  const auto &diff = *format.diff;
+  const auto event = format.event;
+  switch (node.kind) {
+    case TreeNode::kEntry:
+      formatDelta(text_stream, diff.inclusiveDelta(node.function, event),
+                  profile.inclusiveCost(node.function, diff.baseEvent(event)));
+      break;
+    case TreeNode::kOthers:
+      /* formatOthersNode() */
+      break;
+    case TreeNode::kCaller: {
+      const auto costs = profile.edgeCost(node.call);
+      const auto base_cost = costs[diff.baseEvent(event)];
+      text_stream << "< [calls=" << profile.edgeCalls(node.call) << "] ";
+      formatDelta(text_stream,
+                  ProfileDiff::Delta(costs[event]) -
+                      ProfileDiff::Delta(base_cost),
+                  base_cost);
+      break;
+    }
+    case TreeNode::kCall: {
+      const auto ncalls = profile.call(node.call).ncalls;
+      const auto base_ncalls = diff.baseCalls(node.call);
+      text_stream << "> [calls=";
+      if (ncalls != base_ncalls) text_stream << base_ncalls << "->";
+      text_stream << ncalls << "] ";
+      formatDelta(text_stream, diff.callDelta(node.call, event),
+                  profile.callCost(node.call)[diff.baseEvent(event)]);
+      break;
+    }
+  }
+  formatName(text_stream, profile, node.function, format);
+  if (node.recursion) text_stream << " [recursion]";
+  return text_stream.str();
+}
+
+/* "N others (Y%)" */
+inline std::string formatOthersNode(const TreeNode &node,
+                                    const NodeFormat &format) {
+  std::stringstream text_stream;
+  text_stream << node.others_count << " others (" << std::setprecision(2)
+              << (format.total ? 100 * double(node.others_cost) /
+                                     double(format.total)
+                               : 0.)
+              << "%)";
+  return text_stream.str();
+}
+
+/* "[calls=N] [event=cost] " or the share of the inclusive cost of parent */
+inline void formatEdge(std::ostream &os, const Profile &profile,
+                       const NodeFormat &format, uint64_t ncalls,
+                       Profile::Cost cost, Profile::FunctionId parent) {
+  os << "[calls=" << std::setprecision(2) << double(ncalls) << "] ";
+  if (format.costs_view == kAbsolute) {
+    os << "[" << profile.events()[format.event] << "="
+       << std::setprecision(2) << double(cost) << "] ";
+  } else {
+    os << "[" << std::setprecision(2)
+       << 100 * double(cost) / profile.inclusiveCost(parent, format.event)
+       << "%] ";
+  }
+}
+
+/* the text of a row */
+inline std::string formatNode(const Profile &profile, const TreeNode &node,
+                              const NodeFormat &format) {
+  if (node.kind == TreeNode::kOthers) return formatOthersNode(node, format);
+  if (format.diff) return formatDiffNode(profile, node, format);
+  std::stringstream text_stream;
+  const auto event = format.event;
+  switch (node.kind) {
+    case TreeNode::kEntry: {
+      const auto cost = double(profile.inclusiveCost(node.function, event));
+      if (format.costs_view == kAbsolute) {
+        text_stream << "[" << std::setw(7) << std::setprecision(2) << cost
+                    << "] ";
+      } else if (format.costs_view == kPersentage) {
+        text_stream << "[" << std::setw(7) << std::setprecision(2)
+                    << 100 * cost /
+                           profile.inclusiveCost(format.top_entry, event)
+                    << "%] ";
+      }
+      break;
+    }
+    case TreeNode::kOthers:
+      /* formatOthersNode() */
+      break;
+    case TreeNode::kCaller:
+      /* the share is of the cost of the called function */
+      text_stream << "< ";
+      formatEdge(text_stream, profile, format, profile.edgeCalls(node.call),
+                 profile.edgeCost(node.call)[event], node.parent);
+      break;
+    case TreeNode::kCall:
+      text_stream << "> ";
+      formatEdge(text_stream, profile, format, profile.call(node.call).ncalls,
+                 profile.callCost(node.call)[event], node.parent);
+      break;
+  }
+  formatName(text_stream, profile, node.function, format);
+  if (node.recursion) text_stream << " [recursion]";
+  return text_stream.str();
+}
+
+#endif  // CALLGRIND_VIEWER__TREENODE_HPP_
@@ -0,0 +1,159 @@
+/*
+ *     calcurse - lightweight viewer of the callgrind tool of Valgrind
+ *     Copyright (C) 2021  Evgeny Kashirin
+ *     Contact: kashirin.e(a)list.ru
+ *
+ *     This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ *
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <zlib.h>
+
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "ProfileGenerator.hpp"
+
+namespace {
+
+const char kUsage[] =
+    "usage: cursegrind_generate [options] <output>\n"
+    "  --size N[K|M|G]             text size, 10M by default\n"
+    "  --blocks N                  fn= blocks instead of a size\n"
+    "  --symbols N                 distinct functions, 10000\n"
+    "  --objects N                 distinct objects, 16\n"
+    "  --files N                   distinct source files, 1000\n"
+    "  --events N                  events per cost line, 2, at most 9\n"
+    "  --lines N                   cost lines per fn= block, 8\n"
+    "  --fanout N                  calls per fn= block, 4\n"
+    "  --instr                     \"instr line\" positions\n"
+    "  --no-name-compression       full names on every line\n"
+    "  --no-position-compression   absolute sub-positions\n"
+    "  --gzip                      gzip the output\n"
+    "  --seed N                    random seed, 1\n"
+    "<output> may be - for the standard output\n";
+
+uint64_t parseSize(const std::string &text) {
+  size_t end = 0;
+  auto size = std::stoull(text, &end);
+  if (end + 1 == text.size()) {
+    switch (text[end]) {
+      case 'K':
+      case 'k':
+        return size << 10;
+      case 'M':
+      case 'm':
+        return size << 20;
+      case 'G':
+      case 'g':
+        return size << 30;
+    }
+  }
+  if (end != text.size()) throw std::invalid_argument("Bad size: " + text);
+  return size;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  ProfileGenerator::Options options;
+  bool gzip = false;
+  std::string output;
+  try {
+    for (int iarg = 1; iarg < argc; ++iarg) {
+      const std::string arg = argv[iarg];
+      auto value = [&]() -> std::string {
+        if (iarg + 1 == argc) {
+          throw std::invalid_argument(arg + " needs a value");
+        }
+        return argv[++iarg];
+      };
+      if (arg == "--size") {
+        options.size = parseSize(value());
+      } else if (arg == "--blocks") {
+        options.blocks = std::stoull(value());
+      } else if (arg == "--symbols") {
+        options.symbols = std::stoull(value());
+      } else if (arg == "--objects") {
+        options.objects = std::stoull(value());
+      } else if (arg == "--files") {
+        options.files = std::stoull(value());
+      } else if (arg == "--events") {
+        options.events = std::stoull(value());
+      } else if (arg == "--lines") {
+        options.lines = std::stoull(value());
+      } else if (arg == "--fanout") {
+        options.fanout = std::stoull(value());
+      } else if (arg == "--instr") {
+        options.instructions = true;
+      } else if (arg == "--no-name-compression") {
+        options.compress_names = false;
+      } else if (arg == "--no-position-compression") {
+        options.compress_positions = false;
+      } else if (arg == "--gzip") {
+        gzip = true;
+      } else if (arg == "--seed") {
+        options.seed = std::stoull(value());
+      } else if (!arg.empty() && arg[0] == '-' && arg != "-") {
+        throw std::invalid_argument("Unknown option " + arg);
+      } else {
+        output = arg;
+      }
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << "\n" << kUsage;
+    return 1;
+  }
+  if (output.empty()) {
+    std::cerr << kUsage;
+    return 1;
+  }
+
+  ProfileGenerator generator(options);
+  if (gzip) {
+    gzFile file = output == "-" ? gzdopen(fileno(stdout), "wb")
+                                : gzopen(output.c_str(), "wb");
+    if (!file) {
+      std::cerr << "Cannot open " << output << std::endl;
+      return 1;
+    }
+    bool failed = false;
+    generator.write([&](std::string_view text) {
+      if (!failed && !text.empty()) {
+        failed = gzwrite(file, text.data(), unsigned(text.size())) == 0;
+      }
+    });
+    failed = gzclose(file) != Z_OK || failed;
+    if (failed) {
+      std::cerr << "Cannot write " << output << std::endl;
+      return 1;
+    }
+    return 0;
+  }
+
+  try {
+    if (output == "-") {
+      generator.write([](std::string_view text) {
+        std::fwrite(text.data(), 1, text.size(), stdout);
+      });
+    } else {
+      generator.writeFile(output);
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
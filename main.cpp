@@ -21,21 +21,52 @@
 #include <ncurses.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
-#include <filesystem>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
 #include <iostream>
 #include <iterator>
 #include <memory>
 #include <mutex>
+#include <new>
+#include <optional>
+#include <set>
+#include <sstream>
 #include <thread>
+#include <unordered_map>
 #include <utility>
 
+#include "Annotation.hpp"
+#include "CallGraph.hpp"
 #include "CallgrindParser.hpp"
-
-std::string short_path(const std::string &f) {
-  namespace fs = std::filesystem;
-  fs::path p(f);
-  return p.filename();
+#include "DisplayNames.hpp"
+#include "FileWatcher.hpp"
+#include "NameIndex.hpp"
+#include "NameMatcher.hpp"
+#include "OutlineList.hpp"
+#include "ParseStats.hpp"
+#include "ProfileDiff.hpp"
+#include "Report.hpp"
+#include "SourceFile.hpp"
+#include "TreeNode.hpp"
+
+/* allocations are counted for the parse stats; the operators are kept out
+   of line, GCC takes their malloc() and free() inlined into a new and
+   delete pair for a mismatch */
+__attribute__((noinline)) void *operator new(std::size_t size) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  if (void *memory = std::malloc(size == 0 ? 1 : size)) return memory;
+  throw std::bad_alloc();
+}
+__attribute__((noinline)) void operator delete(void *memory) noexcept {
+  std::free(memory);
+}
+__attribute__((noinline)) void operator delete(void *memory,
+                                               std::size_t) noexcept {
+  std::free(memory);
 }
 
 struct WindowDeleter {
@@ -48,6 +79,8 @@ struct WindowDeleter {
 
 using UniqueWinPtr = std::unique_ptr<WINDOW, WindowDeleter>;
 
+/* windows are staged with wnoutrefresh(), the caller flushes them to the
+   terminal with doupdate() */
 struct ItemView {
   void render() {
     auto height = 5;
@@ -56,45 +89,124 @@ struct ItemView {
     if (!window) {
       window = UniqueWinPtr(newwin(height, width, LINES - 5, 1));
       keypad(window.get(), true);
-    } else {
-      height = getmaxy(window.get());
-      width = getmaxx(window.get());
+    } else if (message == drawn_message) {
+      return;
     }
 
-    wclear(window.get());
+    werase(window.get());
     box(window.get(), 0, 0);
     mvwprintw(window.get(), 1, 1, "%s", message.c_str());
+    drawn_message = message;
 
-    wrefresh(window.get());
+    wnoutrefresh(window.get());
   }
 
+  /* the window is made again for the size of the terminal */
+  void resize() { window.reset(); }
+
   std::string message;
   UniqueWinPtr window{nullptr};
+
+ private:
+  std::string drawn_message;
 };
 
 struct TreeView {
-  enum CostsView { kAbsolute, kPersentage };
-  enum ENameView { kSymbolOnly, kFileSymbol, kObjectSymbol };
-
-  struct TreeNode {
-    int level{0};
-    bool expandable{true};
-    bool selectable{true};
-    std::vector<std::shared_ptr<TreeNode> > children;
-    std::function<std::string(int, int)> render_string;
-    std::function<void()> on_expand;
-
-    bool is_expanded{false};
-    bool is_highlighted{false};
-  };
+  using NodeList = OutlineList<TreeNode>;
 
-  using TreeNodePtr = std::shared_ptr<TreeNode>;
-
-  explicit TreeView(std::shared_ptr<CallgrindParser> parser)
-      : parser(std::move(parser)) {}
+  explicit TreeView(std::shared_ptr<const Profile> profile)
+      : profile(std::move(profile)),
+        call_graph(std::make_unique<CallGraph>(*this->profile)),
+        display_names(std::make_unique<DisplayNames>(*this->profile)) {}
   ~TreeView() { destroy(); }
 
-  void render() {
+  /* shows another state of the profile, nodes that are still there stay
+     expanded and selected */
+  void setProfile(std::shared_ptr<const Profile> new_profile) {
+    using Path = std::vector<FunctionId>;
+    std::set<Path> expanded;
+    Path selected;
+    forEachPath([&](size_t inode, const Path &path) {
+      if (nodes[inode].is_expanded) expanded.insert(path);
+      if (long(inode) == selected_inode) selected = path;
+    });
+
+    /* function ids are not kept across profiles */
+    if (new_profile != profile) annotation_activated = false;
+    if (diff && new_profile != diff->profile()) diff.reset();
+    /* except by the later snapshots of a profile, the names made stay;
+       they are moved on while the profile shown is still there */
+    const bool later = new_profile->sameIds(*profile) &&
+                       new_profile->functionCount() >= profile->functionCount();
+    const auto shown = std::move(profile);
+    profile = std::move(new_profile);
+    if (&call_graph->profile() != profile.get()) {
+      call_graph = std::make_unique<CallGraph>(*profile);
+    }
+    if (&display_names->profile() != profile.get()) {
+      if (later) {
+        display_names->extend(*profile);
+      } else {
+        display_names = std::make_unique<DisplayNames>(*profile);
+      }
+      display_names->build(name_view);
+    }
+    if (cost_event >= profile->events().size()) {
+      cost_event = Profile::kPrimaryEvent;
+    }
+    text_cache.clear();
+    resetSearchIndex();
+    nodes.clear();
+    initNodes();
+    nodes_initialized = true;
+    selected_inode = -1;
+    forEachPath([&](size_t inode, const Path &path) {
+      if (nodes[inode].kind == TreeNode::kOthers) {
+        /* shown again if it hid an expanded or the selected node */
+        const Path prefix(path.begin(), path.end() - 1);
+        auto hid = [&](const Path &other) {
+          return other.size() > prefix.size() &&
+                 std::equal(prefix.begin(), prefix.end(), other.begin()) &&
+                 hides(nodes[inode], other[prefix.size()]);
+        };
+        bool reveal = hid(selected);
+        for (auto it = expanded.lower_bound(prefix);
+             !reveal && it != expanded.end() &&
+             std::equal(prefix.begin(), prefix.end(), it->begin());
+             ++it) {
+          reveal = hid(*it);
+        }
+        if (reveal) expandNode(inode);
+        return;
+      }
+      if (expanded.count(path)) expandNode(inode);
+      if (selected_inode < 0 && path == selected) selected_inode = inode;
+    });
+    if (selected_inode < 0) selected_inode = firstSelectable();
+    updateMatches(search_query);
+    render();
+  }
+
+  /* what opening the profile took, shown instead of the tree */
+  void setStats(std::vector<std::string> lines) {
+    stats_lines = std::move(lines);
+    if (stats_activated) render();
+  }
+
+  /* rows costing less than percent of the total are collapsed into an
+     others node, 0 shows all */
+  void SetThreshold(double percent) { threshold = std::max(percent, 0.); }
+
+  /* wgetch() timeout in ms, negative to block */
+  void SetInputTimeout(int input_timeout) {
+    TreeView::input_timeout = input_timeout;
+  }
+
+  /* the view is drawn again by dispatch(), once for the keys queued
+     together */
+  void render() { render_pending = true; }
+
+  void draw() {
     static std::string symbol_expand = "[+]";
     static std::string symbol_collapse = "[-]";
     static std::string symbol_nonexp = " * ";
@@ -102,17 +214,17 @@ struct TreeView {
     auto height = LINES - 6;
     auto width = COLS - 1;
 
+    /* made again on KEY_RESIZE only */
     if (!window) {
       window = newwin(height, width, 1, 1);
       keypad(window, true);
-    } else if (getmaxx(window) != COLS - 1 || getmaxy(window) != LINES - 1) {
-      destroy();
-      window = newwin(height, width, 1, 1);
-      keypad(window, true);
+      full_redraw = true;
     } else {
       height = getmaxy(window);
       width = getmaxx(window);
     }
+    render_pending = false;
+    next_frame = Clock::now() + kFrameInterval;
 
     constexpr auto PAIR_SELECTED = 2;
     constexpr auto PAIR_HIGHLIGHTED = 3;
@@ -121,69 +233,136 @@ struct TreeView {
     init_pair(PAIR_SELECTED, COLOR_BLACK, COLOR_WHITE);
     init_pair(PAIR_HIGHLIGHTED, COLOR_BLACK, COLOR_YELLOW);
 
-    wclear(window);
-
     if (!nodes_initialized) {
       initNodes();
       nodes_initialized = true;
-      if (nodes.empty()) {
-        wrefresh(window);
-        return;
-      }
-      auto first_selectable_it = std::find_if(
-          begin(nodes), end(nodes),
-          [](TreeNodePtr &nodeptr) { return nodeptr->selectable; });
-      selected_inode = std::distance(begin(nodes), first_selectable_it);
+      selected_inode = firstSelectable();
     }
 
-    renderSearchForm();
-    box(window, 0, 0);
-
     constexpr int BORDER_WIDTH = 1;
     constexpr int LEVEL_OFFSET_WIDTH = 1;
 
     const auto frame_width = width - 2 * BORDER_WIDTH;
     const auto frame_height = height - (search_activated ? 2 : 1);
 
+    /* only the lines that differ from the drawn ones are repainted */
+    if (full_redraw) werase(window);
+    /* posting the form erases the window */
+    renderSearchForm();
+    /* the event shown is named in the top border */
+    auto title = cost_event < profile->events().size()
+                     ? " " + profile->events()[cost_event] + " "
+                     : std::string();
+    if (diff && !title.empty()) title += "change from the base ";
+    if (pruning()) {
+      std::stringstream threshold_text;
+      threshold_text << "below " << threshold << "% hidden ";
+      title += threshold_text.str();
+    }
+    if (full_redraw || title != drawn_title) {
+      if (full_redraw) {
+        box(window, 0, 0);
+      } else {
+        mvwhline(window, 0, 1, ACS_HLINE, width - 2);
+      }
+      mvwprintw(window, 0, 2, "%s", title.c_str());
+      drawn_title = title;
+    }
+    if (full_redraw) {
+      drawn_lines.assign(std::max(frame_height, 0), {});
+      full_redraw = false;
+    }
+    if (annotation_activated) {
+      renderAnnotation(frame_width, frame_height);
+      return;
+    }
+    if (stats_activated) {
+      renderStats(frame_width, frame_height);
+      return;
+    }
+    if (nodes.empty()) {
+      /* nothing parsed yet */
+      for (int iline = 1; iline < frame_height; ++iline) {
+        drawLine(iline, {}, frame_width);
+      }
+      wnoutrefresh(window);
+      setMessage({});
+      doupdate();
+      return;
+    }
+
     if (selected_inode - offset_inode >= frame_height - 2) {
       offset_inode = selected_inode - (frame_height - 2);
     } else if (selected_inode < offset_inode) {
       offset_inode = selected_inode;
     }
     size_t inode = offset_inode;
-    for (int iline = 1; iline < frame_height && inode < nodes.size();
-         ++iline, ++inode) {
-      auto &node = *nodes[inode];
-      const auto is_selected = inode == selected_inode;
-      std::stringstream line_text;
-
-      std::string bullet_symbol =
-          node.expandable ? node.is_expanded ? symbol_collapse : symbol_expand
-                          : symbol_nonexp;
-
-      line_text << node.render_string(0, 0);
-
-      const auto padding_left = BORDER_WIDTH + LEVEL_OFFSET_WIDTH * node.level;
-      const auto padding_right = BORDER_WIDTH;
-      const auto text_offset = padding_left + bullet_symbol.length() + 1;
-      const auto text_length = frame_width - padding_right - text_offset;
-      auto text = line_text.str().substr(0, text_length);
-      mvwprintw(window, iline, padding_left, "%s", bullet_symbol.c_str());
-      if (is_selected) {
-        wattron(window, COLOR_PAIR(PAIR_SELECTED));
-      } else if (node.is_highlighted) {
-        wattron(window, COLOR_PAIR(PAIR_HIGHLIGHTED));
+    for (int iline = 1; iline < frame_height; ++iline, ++inode) {
+      if (inode >= nodes.size()) {
+        drawLine(iline, {}, frame_width);
+        continue;
       }
-      mvwprintw(window, iline, text_offset, "%s", text.c_str());
-      wattron(window, COLOR_PAIR(1));
+      const auto &row = nodes.row(inode);
+      const auto &node = row.value;
+      DrawnLine line;
+      line.bullet =
+          node.expandable ? node.is_expanded ? &symbol_collapse : &symbol_expand
+                          : &symbol_nonexp;
+      line.text = nodeText(node);
+      line.padding_left = BORDER_WIDTH + LEVEL_OFFSET_WIDTH * row.level;
+      line.color_pair = long(inode) == selected_inode ? PAIR_SELECTED
+                        : isMatch(node.function) ? PAIR_HIGHLIGHTED
+                                                 : 1;
+      drawLine(iline, std::move(line), frame_width);
     }
 
-    wrefresh(window);
-    setMessage(nodes[selected_inode]->render_string(0, 0));
+    wnoutrefresh(window);
+    setMessage(nodeText(nodes[selected_inode]));
+    doupdate();
   }
 
-  int dispatch(int) {
-    int ch = wgetch(window);
+  /* waits for a key up to the input timeout and handles it with the keys
+     queued after it, so that holding a key or pasting draws once; a frame
+     is drawn at most every kFrameInterval, keys coming faster go into the
+     next one */
+  int dispatch() {
+    if (render_pending && Clock::now() >= next_frame) draw();
+    auto timeout = input_timeout;
+    if (render_pending) {
+      const auto frame_due = int(std::chrono::ceil<std::chrono::milliseconds>(
+                                     next_frame - Clock::now())
+                                     .count());
+      timeout = timeout < 0 ? frame_due : std::min(timeout, frame_due);
+    }
+    wtimeout(window, timeout);
+    for (int ch = wgetch(window); ch != ERR;) {
+      if (dispatchKey(ch) != 0) return -1;
+      if (render_pending && Clock::now() >= next_frame) break;
+      wtimeout(window, 0);
+      ch = wgetch(window);
+    }
+    if (render_pending && Clock::now() >= next_frame) draw();
+    return 0;
+  }
+
+  int dispatchKey(int ch) {
+    if (ch == KEY_RESIZE) {
+      resize();
+      return 0;
+    }
+    if (nodes.empty() && !search_activated) {
+      /* nothing to navigate until the first entries are parsed */
+      switch (ch) {
+        case 'q':
+        case 'Q':
+        case KEY_F(10):
+          return -1;
+        default:
+          return 0;
+      }
+    }
+    if (annotation_activated) return dispatchAnnotation(ch);
+    if (stats_activated) return dispatchStats(ch);
     if (search_activated) {
       switch (ch) {
         case KEY_LEFT:
@@ -192,20 +371,30 @@ struct TreeView {
         case KEY_RIGHT:
           form_driver(search_form, REQ_NEXT_CHAR);
           break;
+        case '\t':
+          toggleSearchMode();
+          break;
         case 127:
         case '\b':
         case KEY_BACKSPACE:
           form_driver(search_form, REQ_DEL_PREV);
+          searchEdited();
           break;
         case '\n':
         case KEY_ENTER:
-          form_driver(search_form, REQ_VALIDATION);
-          /* populate search results */
-          doSearch();
+          /* keep the matches, go to the first one */
+          search_activated = false;
+          form_driver(search_form, REQ_CLR_FIELD);
+          current_match = kNoMatch;
+          full_redraw = true;
+          nextMatch(1);
+          break;
         case 27 /*ESCAPE */:
           /* cancel search */
           search_activated = false;
           form_driver(search_form, REQ_CLR_FIELD);
+          updateMatches({});
+          full_redraw = true;
           render();
           break;
         case KEY_F(10):
@@ -213,6 +402,7 @@ struct TreeView {
           break;
         default:
           form_driver(search_form, ch);
+          searchEdited();
       }
       return 0;
     }
@@ -249,8 +439,37 @@ struct TreeView {
       case 'c':
         toggleCostsView();
         break;
+      case 'x':
+        switchEvent(1);
+        break;
+      case 'X':
+        switchEvent(-1);
+        break;
+      case 't':
+        switchThreshold(1);
+        break;
+      case 'T':
+        switchThreshold(-1);
+        break;
+      case 'n':
+        nextMatch(1);
+        break;
+      case 'N':
+        nextMatch(-1);
+        break;
       case '/':
         search_activated = true;
+        full_redraw = true;
+        render();
+        break;
+      case 'A':
+      case 'a':
+        openAnnotation(nodes[selected_inode].function);
+        break;
+      case 'S':
+      case 's':
+        stats_activated = true;
+        full_redraw = true;
         render();
         break;
       case 'q':
@@ -262,6 +481,24 @@ struct TreeView {
     return 0;
   }
 
+  /* the windows and the search form are made again for the new size of the
+     terminal, the typed query is kept */
+  void resize() {
+    const auto query = search_activated ? searchText() : std::string();
+    destroy();
+    if (item_view) item_view->resize();
+    /* the status line */
+    touchwin(stdscr);
+    wnoutrefresh(stdscr);
+    draw();
+    if (!query.empty()) {
+      set_field_buffer(search_fields[0], 0, query.c_str());
+      form_driver(search_form, REQ_END_LINE);
+      wnoutrefresh(window);
+      doupdate();
+    }
+  }
+
   void destroy() {
     if (search_form) {
       unpost_form(search_form);
@@ -273,6 +510,14 @@ struct TreeView {
       search_fields.clear();
     }
     if (window) delwin(window);
+    window = nullptr;
+  }
+
+  /* shows the joined profile of the diff, sorted and labelled by the
+     changes */
+  void setDiff(std::shared_ptr<const ProfileDiff> new_diff) {
+    diff = std::move(new_diff);
+    setProfile(diff->profile());
   }
 
   void SetItemView(const std::shared_ptr<ItemView> &item_view) {
@@ -281,194 +526,349 @@ struct TreeView {
 
  private:
   void expand_selected() {
-    auto current_node = nodes[selected_inode];
-    if (!current_node->expandable) {
-      return;
+    if (expandNode(selected_inode)) render();
+  }
+
+  bool expandNode(size_t inode) {
+    auto &current_node = nodes[inode];
+    if (!current_node.expandable) {
+      return false;
     }
-    if (current_node->is_expanded) return;
-    if (current_node->on_expand) {
-      current_node->on_expand();
+    if (current_node.kind == TreeNode::kOthers) {
+      expandOthers(inode);
+      return true;
     }
-    current_node->is_expanded = true;
-    for (auto &child : current_node->children) {
-      child->level = current_node->level + 1;
+    if (current_node.is_expanded) return false;
+    current_node.is_expanded = true;
+    /* the functions from the node up to the top level */
+    auto path = ancestors(inode);
+    path.insert(path.begin(), current_node.function);
+    nodes.insert(inode + 1,
+                 childRows(nodes[inode], path, nodes.row(inode).level + 1));
+    return true;
+  }
+
+  /* visit(inode, path) with the functions from the top level to the node */
+  template <typename Visitor>
+  void forEachPath(Visitor &&visit) {
+    /* by index, visit may expand the node */
+    std::vector<FunctionId> path;
+    for (size_t inode = 0; inode < nodes.size(); ++inode) {
+      const auto &row = nodes.row(inode);
+      const bool others = row.value.kind == TreeNode::kOthers;
+      path.resize(row.level);
+      path.push_back(row.value.function);
+      visit(inode, path);
+      /* the rows an expanded others node hid are visited from its place */
+      if (others && nodes[inode].kind != TreeNode::kOthers) --inode;
     }
-    nodes.insert(begin(nodes) + selected_inode + 1,
-                 begin(current_node->children), end(current_node->children));
-    render();
   }
 
   void collapse_selected() {
-    auto current_node = nodes[selected_inode];
-    if (current_node->is_expanded) {
-      current_node->is_expanded = false;
-      auto current_node_it = begin(nodes) + selected_inode;
-      auto collapse_begin = current_node_it + 1;
-      auto collapse_end = std::find_if(
-          collapse_begin, end(nodes), [&current_node](const TreeNodePtr &ptr) {
-            return current_node->level >= ptr->level;
-          });
-      nodes.erase(collapse_begin, collapse_end);
+    auto &current_node = nodes[selected_inode];
+    const auto level = nodes.row(selected_inode).level;
+    if (current_node.is_expanded) {
+      current_node.is_expanded = false;
+      nodes.erase(selected_inode + 1, nodes.nextAtLevel(selected_inode, level));
       render();
-    } else if (current_node->level > 0) {
-      // collapse parent node
-      // search backwards level < current level
-      auto rit = std::make_reverse_iterator(begin(nodes) + selected_inode);
-      auto rend = std::make_reverse_iterator(begin(nodes));
-      auto rfound =
-          std::find_if(rit, rend, [current_node](const TreeNodePtr &node) {
-            return node->level < current_node->level;
-          });
-      selected_inode = std::distance(rfound, rend) - 1;
+    } else if (level > 0) {
+      /* collapse the parent node */
+      selected_inode = nodes.prevBelowLevel(selected_inode, level);
       collapse_selected();
     }
   }
 
-  TreeNodePtr makeCallerNode(const CallgrindParser::EntryPtr &caller) {
-    auto new_node = std::make_shared<TreeNode>();
-    new_node->expandable = false;
-    new_node->selectable = false;
-    new_node->render_string = [this, caller, new_node](int, int) {
-      std::stringstream text_stream;
-      text_stream << "< ";  // add n-called and stats
+  using FunctionId = Profile::FunctionId;
+  using CallId = Profile::CallId;
+  using NameId = Profile::NameId;
+
+  /* the rows an others node hid take its place */
+  void expandOthers(size_t inode) {
+    const auto others = nodes[inode];
+    const auto level = nodes.row(inode).level;
+    std::vector<NodeList::Row> rows;
+    if (others.parent == Profile::kNoFunction) {
+      sortAllEntries();
+      for (auto rank = size_t(others.others_first); rank < entries.size();
+           ++rank) {
+        rows.push_back({makeEntryNode(entries[rank]), level, true});
+      }
+    } else {
+      const auto path = ancestors(inode);
+      const auto edges = edgesOf(others.parent, others.others_callers);
+      for (auto iedge = size_t(others.others_first); iedge < edges.size();
+           ++iedge) {
+        rows.push_back({makeEdgeNode(others.parent, edges[iedge],
+                                     others.others_callers, path),
+                        level, true});
+      }
+    }
+    nodes.erase(inode, inode + 1);
+    nodes.insert(inode, std::move(rows));
+  }
 
-      if (name_view == kSymbolOnly) {
-        text_stream << caller->position->symbol;
-      } else if (name_view == kFileSymbol) {
-        text_stream << short_path(caller->position->source)
-                    << ":::" << caller->position->symbol;
-      } else if (name_view == kObjectSymbol) {
-        text_stream << short_path(caller->position->binary)
-                    << ":::" << caller->position->symbol;
+  /* whether function is one of the rows hidden by the others node */
+  bool hides(const TreeNode &others, FunctionId function) {
+    if (others.parent == Profile::kNoFunction) {
+      sortAllEntries();
+      return std::find(entries.begin() + others.others_first, entries.end(),
+                       function) != entries.end();
+    }
+    const auto edges = edgesOf(others.parent, others.others_callers);
+    for (auto iedge = size_t(others.others_first); iedge < edges.size();
+         ++iedge) {
+      if (edgeFunction(edges[iedge], others.others_callers) == function) {
+        return true;
       }
-      return text_stream.str();
-    };
+    }
+    return false;
+  }
 
-    return new_node;
+  /* the functions of the rows above the node, from its parent up to the top
+     level */
+  std::vector<FunctionId> ancestors(size_t inode) const {
+    std::vector<FunctionId> path;
+    for (auto iparent = inode; nodes.row(iparent).level > 0;) {
+      iparent = nodes.prevBelowLevel(iparent, nodes.row(iparent).level);
+      path.push_back(nodes[iparent].function);
+    }
+    return path;
   }
 
-  TreeNodePtr makeCallNode(const CallgrindParser::EntryPtr &parent,
-                           const CallgrindParser::Call &call) {
-    auto new_node = std::make_shared<TreeNode>();
-    new_node->expandable = true;
-    new_node->selectable = true;
-    new_node->render_string = [this, parent, new_node, call](int, int) {
-      std::stringstream text_stream;
-      text_stream << "> [calls=" << std::setprecision(2) << double(call.ncalls)
-                  << "] ";
-      if (costs_view == kAbsolute) {
-        text_stream << "[Ir=" << std::setprecision(2)
-                    << double(call.totalCosts()[0]) << "] ";
-      } else {
-        text_stream << "[" << std::setprecision(2)
-                    << 100 * double(call.totalCosts()[0]) /
-                           parent->totalCost()[0]
-                    << "%] ";
-      }
+  /* what a line of the window shows */
+  struct DrawnLine {
+    const std::string *bullet{nullptr};
+    std::string text;
+    int padding_left{0};
+    int color_pair{0};
 
-      if (name_view == kSymbolOnly) {
-        text_stream << call.entry->position->symbol;
-      } else if (name_view == kFileSymbol) {
-        text_stream << short_path(call.entry->position->source)
-                    << ":::" << call.entry->position->symbol;
-      } else if (name_view == kObjectSymbol) {
-        text_stream << short_path(call.entry->position->binary)
-                    << ":::" << call.entry->position->symbol;
-      }
-      return text_stream.str();
-    };
-    auto call_entry = call.entry;
-    if (call_entry->calls.empty()) {
-      new_node->expandable = false;
-      return new_node;
-    }
-    new_node->on_expand = [this, call_entry, new_node]() {
-      new_node->children.clear();
-      auto calls = call_entry->calls;
-      std::sort(begin(calls), end(calls),
-                [](const CallgrindParser::Call &lhs,
-                   const CallgrindParser::Call &rhs) {
-                  return lhs.totalCosts()[0] > rhs.totalCosts()[0];
-                });
-      for (auto &call : calls) {
-        new_node->children.emplace_back(makeCallNode(call_entry, call));
-      }
-    };
-    return new_node;
+    bool operator==(const DrawnLine &rhs) const {
+      return bullet == rhs.bullet && padding_left == rhs.padding_left &&
+             color_pair == rhs.color_pair && text == rhs.text;
+    }
+  };
+
+  void drawLine(int iline, DrawnLine line, int frame_width) {
+    auto &drawn = drawn_lines[iline];
+    if (drawn == line) return;
+    wattron(window, COLOR_PAIR(1));
+    mvwhline(window, iline, 1, ' ' | COLOR_PAIR(1), frame_width);
+    if (line.bullet) {
+      const auto padding_right = 1;
+      const auto text_offset = line.padding_left + line.bullet->length() + 1;
+      const auto text_length = std::max<long>(
+          long(frame_width) - padding_right - long(text_offset), 0);
+      mvwprintw(window, iline, line.padding_left, "%s", line.bullet->c_str());
+      wattron(window, COLOR_PAIR(line.color_pair));
+      mvwprintw(window, iline, text_offset, "%s",
+                line.text.substr(0, text_length).c_str());
+      wattron(window, COLOR_PAIR(1));
+    }
+    drawn = std::move(line);
   }
 
-  TreeNodePtr makeEntryNode(const CallgrindParser::EntryPtr &entry) {
-    auto new_node = std::make_shared<TreeNode>();
-    new_node->expandable = true;
-    new_node->selectable = true;
-    new_node->is_expanded = false;
+  /* recently shown texts, made again when a view changes */
+  const std::string &nodeText(const TreeNode &node) {
+    if (text_cache_name_view != name_view ||
+        text_cache_costs_view != costs_view ||
+        text_cache.size() >= kTextCacheSize) {
+      text_cache.clear();
+      text_cache_name_view = name_view;
+      text_cache_costs_view = costs_view;
+    }
+    /* the text of a call or caller depends on the edge and whether it
+       recurses only, the one of others on the list they are in */
+    const bool edge =
+        node.kind == TreeNode::kCall || node.kind == TreeNode::kCaller;
+    const auto key = uint64_t(node.others_callers) << 35 |
+                     uint64_t(node.recursion) << 34 |
+                     uint64_t(node.kind) << 32 |
+                     (edge                             ? node.call
+                      : node.kind == TreeNode::kOthers ? node.parent
+                                                       : node.function);
+    auto [found, inserted] = text_cache.try_emplace(key);
+    if (inserted) {
+      found->second =
+          formatNode(*profile, node,
+                     {costs_view, name_view, cost_event,
+                      entries.empty() ? Profile::kNoFunction : entries.front(),
+                      diff.get(), total_cost, display_names.get()});
+    }
+    return found->second;
+  }
 
-    new_node->render_string = [this, entry, new_node](int, int) -> std::string {
-      std::stringstream text_stream;
-      if (costs_view == kAbsolute) {
-        text_stream << "[" << std::setw(7) << std::setprecision(2)
-                    << double(entry->totalCost()[0]) << "] ";
-      } else if (costs_view == kPersentage) {
-        text_stream << "[" << std::setw(7) << std::setprecision(2)
-                    << 100 * double(entry->totalCost()[0]) /
-                           parser->getEntries()[0]->totalCost()[0]
-                    << "%] ";
-      }
+  TreeNode makeEntryNode(FunctionId entry) const {
+    TreeNode node;
+    node.kind = TreeNode::kEntry;
+    node.expandable =
+        !profile->calls(entry).empty() || !profile->callers(entry).empty();
+    node.function = entry;
+    return node;
+  }
 
-      if (name_view == kSymbolOnly) {
-        text_stream << entry->position->symbol;
-      } else if (name_view == kFileSymbol) {
-        text_stream << short_path(entry->position->source)
-                    << ":::" << entry->position->symbol;
-      } else if (name_view == kObjectSymbol) {
-        text_stream << short_path(entry->position->binary)
-                    << ":::" << entry->position->symbol;
-      }
-      return text_stream.str();
-    };
+  /* the rows from first on, parent is kNoFunction for the entries */
+  TreeNode makeOthersNode(FunctionId parent, bool callers, size_t first,
+                          size_t count, Profile::Cost cost) const {
+    TreeNode node;
+    node.kind = TreeNode::kOthers;
+    node.expandable = true;
+    node.parent = parent;
+    node.others_callers = callers;
+    node.others_first = uint32_t(first);
+    node.others_count = uint32_t(count);
+    node.others_cost = cost;
+    return node;
+  }
+
+  /* The calls of a function or its caller edges, the most expensive
+     first; edge ids are calls or caller edges of the profile. */
+  Span<const CallId> edgesOf(FunctionId function, bool callers) {
+    return callers ? call_graph->callerEdgesBy(function, cost_event)
+                   : call_graph->callsBy(function, cost_event);
+  }
+  Profile::Cost edgeCost(CallId edge, bool callers) const {
+    return (callers ? profile->edgeCost(edge)
+                    : profile->callCost(edge))[cost_event];
+  }
+  /* the caller or the callee */
+  FunctionId edgeFunction(CallId edge, bool callers) const {
+    return callers ? profile->edgeCaller(edge) : profile->call(edge).callee;
+  }
 
-    if (entry->calls.empty()) {
-      new_node->expandable = false;
-      new_node->is_expanded = false;
-      return new_node;
+  /* a call to, or from, a function on the path is a recursion and is not
+     expanded any further, its cost is already in the call that entered it */
+  TreeNode makeEdgeNode(FunctionId parent, CallId edge, bool callers,
+                        const std::vector<FunctionId> &path) const {
+    TreeNode node;
+    node.kind = callers ? TreeNode::kCaller : TreeNode::kCall;
+    node.function = edgeFunction(edge, callers);
+    node.recursion = profile->recursive(node.function) &&
+                     std::find(begin(path), end(path), node.function) !=
+                         end(path);
+    node.expandable = !node.recursion &&
+                      !(callers ? profile->callers(node.function)
+                                : profile->calls(node.function))
+                           .empty();
+    node.parent = parent;
+    node.call = edge;
+    return node;
+  }
+
+  /* entries show their callers, then their calls; calls show the calls of
+     the callee and callers the callers of the caller */
+  std::vector<NodeList::Row> childRows(const TreeNode &node,
+                                       const std::vector<FunctionId> &path,
+                                       int level) {
+    std::vector<NodeList::Row> rows;
+    if (node.kind != TreeNode::kCall) {
+      addEdgeRows(rows, node.function, true, path, level);
+    }
+    if (node.kind != TreeNode::kCaller) {
+      addEdgeRows(rows, node.function, false, path, level);
     }
+    return rows;
+  }
 
-    new_node->on_expand = [this, entry, new_node]() {
-      new_node->children.clear();
-      auto callers = entry->callers;
-      for (const auto &caller : callers) {
-        new_node->children.emplace_back(makeCallerNode(caller.lock()));
-      }
-      auto calls = entry->calls;
-      std::sort(begin(calls), end(calls),
-                [](const CallgrindParser::Call &lhs,
-                   const CallgrindParser::Call &rhs) {
-                  return lhs.totalCosts()[0] > rhs.totalCosts()[0];
-                });
-      for (auto &call : calls) {
-        new_node->children.emplace_back(makeCallNode(entry, call));
+  /* the rows below the threshold are collapsed into an others node */
+  void addEdgeRows(std::vector<NodeList::Row> &rows, FunctionId function,
+                   bool callers, const std::vector<FunctionId> &path,
+                   int level) {
+    std::vector<CallId> by_delta;
+    auto edges = edgesOf(function, callers);
+    if (diff && !callers) {
+      by_delta = diff->callsByDelta(function, cost_event);
+      edges = by_delta;
+    }
+    const auto min_cost = minCost();
+    size_t shown = 0;
+    while (shown < edges.size() &&
+           edgeCost(edges[shown], callers) >= min_cost) {
+      rows.push_back(
+          {makeEdgeNode(function, edges[shown], callers, path), level, true});
+      ++shown;
+    }
+    if (shown < edges.size()) {
+      Profile::Cost hidden = 0;
+      for (auto iedge = shown; iedge < edges.size(); ++iedge) {
+        hidden += edgeCost(edges[iedge], callers);
       }
-    };
-    return new_node;
+      rows.push_back({makeOthersNode(function, callers, shown,
+                                     edges.size() - shown, hidden),
+                      level, true});
+    }
   }
 
+  /* the entries above the threshold are selected without sorting all of
+     them, the others are sorted when shown or searched */
   void initNodes() {
-    auto &entries = parser->getEntries();
+    total_cost = cost_event < profile->events().size()
+                     ? profile->totalSelfCost(cost_event)
+                     : 0;
+    size_t shown = 0;
+    Profile::Cost hidden = 0;
+    if (pruning()) {
+      shown = profile->countEntriesCosting(cost_event, minCost(), &hidden);
+      entries = profile->topEntriesBy(cost_event, shown);
+      all_entries = shown == profile->entries().size();
+    } else {
+      entries = diff ? diff->entriesByDelta(cost_event)
+                     : profile->entriesBy(cost_event);
+      all_entries = true;
+    }
+    std::vector<NodeList::Row> rows;
+    rows.reserve(entries.size() + 1);
+    for (auto entry : entries) {
+      rows.push_back({makeEntryNode(entry), 0, true});
+    }
+    if (!all_entries) {
+      rows.push_back({makeOthersNode(Profile::kNoFunction, false, shown,
+                                     profile->entries().size() - shown,
+                                     hidden),
+                      0, true});
+    }
+    nodes.insert(0, std::move(rows));
+  }
+
+  void sortAllEntries() {
+    if (all_entries) return;
+    entries = profile->entriesBy(cost_event);
+    all_entries = true;
+    entry_ranks.clear();
+  }
 
-    for (auto &entry : entries) {
-      nodes.emplace_back(makeEntryNode(entry));
+  /* a diff sorts by the signed change, its small rows are not together */
+  bool pruning() const { return threshold > 0 && !diff; }
+  Profile::Cost minCost() const {
+    return pruning() ? Profile::Cost(double(total_cost) * threshold / 100)
+                     : 0;
+  }
+
+  /* the next / previous of the preset thresholds */
+  void switchThreshold(int step) {
+    static constexpr double kThresholds[] = {0, 0.001, 0.01, 0.1, 1};
+    constexpr auto count = long(std::size(kThresholds));
+    auto index = long(std::lower_bound(std::begin(kThresholds),
+                                       std::end(kThresholds), threshold) -
+                      std::begin(kThresholds));
+    if (index < count && kThresholds[index] == threshold) {
+      index += step;
+    } else if (step < 0) {
+      index -= 1;
     }
+    threshold = kThresholds[(index % count + count) % count];
+    full_redraw = true;
+    setProfile(profile);
+  }
+
+  long firstSelectable() const {
+    const auto first = nodes.nextSelectable(NodeList::npos);
+    return first == NodeList::npos ? long(nodes.size()) : long(first);
   }
 
   void nextSelectable() {
-    auto current_node_it = begin(nodes) + selected_inode;
-    auto next_selectable_node_it =
-        std::find_if(current_node_it + 1, end(nodes),
-                     [](const TreeNodePtr &n) { return n->selectable; });
-    if (next_selectable_node_it == end(nodes)) {
-      /* ignore */
-    } else {
-      selected_inode = std::distance(begin(nodes), next_selectable_node_it);
+    const auto next = nodes.nextSelectable(selected_inode);
+    if (next != NodeList::npos) {
+      selected_inode = next;
     }
     render();
   }
@@ -477,30 +877,36 @@ struct TreeView {
     if (selected_inode == 0) {
       return;
     }
-    auto rit = std::make_reverse_iterator(begin(nodes) + selected_inode) + 1;
-    auto rend = nodes.rend();
-    auto rfound = std::find_if(
-        rit, rend, [](const TreeNodePtr &n) { return n->selectable; });
-    if (rfound != rend) {
-      selected_inode = std::distance(rfound, rend);
-    } else {
-      selected_inode = 0;
-    }
+    const auto prev = nodes.prevSelectable(selected_inode);
+    selected_inode = prev != NodeList::npos ? prev : 0;
 
     render();
   }
 
   void toggleNameView() {
-    if (name_view == kSymbolOnly) {
-      name_view = kFileSymbol;
-    } else if (name_view == kFileSymbol) {
-      name_view = kObjectSymbol;
-    } else if (name_view == kObjectSymbol) {
-      name_view = kSymbolOnly;
-    }
+    name_view = ENameView((name_view + 1) % kNameViewCount);
+    display_names->build(name_view);
+    /* the shown names are searched */
+    updateMatches(search_query);
     render();
   }
 
+  /* the costs of another event are shown and sorted by, the nodes are
+     made again keeping those expanded and selected */
+  void switchEvent(int step) {
+    /* a diff shows the changes of the current events */
+    const auto nevents = diff ? diff->eventCount() : profile->events().size();
+    if (nevents < 2) return;
+    cost_event = (cost_event + nevents + step) % nevents;
+    full_redraw = true;
+    setProfile(profile);
+    if (annotation_activated) {
+      annotation = Annotation(*profile, annotated_function,
+                              annotation_position, cost_event);
+      render();
+    }
+  }
+
   void toggleCostsView() {
     if (costs_view == kAbsolute)
       costs_view = kPersentage;
@@ -513,7 +919,8 @@ struct TreeView {
   void renderSearchForm() {
     if (!search_form) {
       search_fields = {
-          new_field(1 /* height */, getmaxx(window) - 11 - 2 /* width */,
+          new_field(1 /* height */,
+                    getmaxx(window) - 11 - 2 - kMatchCountWidth /* width */,
                     getmaxy(window) - 2 /* startpos y */, 11 /* startposx */, 0,
                     1),
           nullptr};
@@ -526,18 +933,24 @@ struct TreeView {
 
       init_pair(12, COLOR_YELLOW, COLOR_BLACK);
       wattron(window, COLOR_PAIR(12));
-      mvwprintw(window, getmaxy(window) - 2, 1, "Search: ");
+      static const char *const labels[] = {"Search: ", "Regex:  ", "Fuzzy:  "};
+      mvwprintw(window, getmaxy(window) - 2, 1, "%s",
+                labels[int(search_mode)]);
       wattroff(window, COLOR_PAIR(12));
+      if (bad_pattern) {
+        mvwprintw(window, getmaxy(window) - 2,
+                  getmaxx(window) - 1 - kMatchCountWidth, "%*s",
+                  kMatchCountWidth, "bad pattern");
+      } else {
+        mvwprintw(window, getmaxy(window) - 2,
+                  getmaxx(window) - 1 - kMatchCountWidth, "%*zu matches",
+                  kMatchCountWidth - 8, matches.size());
+      }
+      pos_form_cursor(search_form);
     }
   }
 
-  void resetHighlights() {
-    for (auto &node_ptr : nodes) {
-      node_ptr->is_highlighted = false;
-    }
-  }
-
-  void doSearch() {
+  std::string searchText() const {
     auto buffer_begin = field_buffer(search_fields[0], 0);
     auto buffer_length = strlen(buffer_begin);
     auto buffer_end = buffer_begin + buffer_length;
@@ -546,27 +959,397 @@ struct TreeView {
     while (buffer_end > buffer_begin && std::isspace(*(buffer_end - 1)))
       buffer_end--;
 
-    std::string search_string{buffer_begin, buffer_end};
+    return {buffer_begin, buffer_end};
+  }
+
+  /* the matches follow the field as it is typed */
+  void searchEdited() {
+    form_driver(search_form, REQ_VALIDATION);
+    updateMatches(searchText());
+    render();
+  }
+
+  /* substring, regex, fuzzy */
+  void toggleSearchMode() {
+    search_mode = NameMatcher::Mode((int(search_mode) + 1) % 3);
+    searchEdited();
+  }
+
+  /* the index is made on the first search in a profile */
+  void resetSearchIndex() {
+    name_index.reset();
+    matched_query.clear();
+    matched_names.clear();
+    entry_ranks.clear();
+  }
 
-    resetHighlights();
-    if (search_string.empty()) {
+  bool isMatch(FunctionId function) const {
+    return function < matched_functions.size() && matched_functions[function];
+  }
+
+  /* functions whose symbol, or whose file or object name when it is shown,
+     matches query in the search mode; the entries first, in their order */
+  void updateMatches(const std::string &query) {
+    search_query = query;
+    matches.clear();
+    matched_functions.clear();
+    current_match = kNoMatch;
+    bad_pattern = false;
+    if (query.empty()) {
+      matched_query.clear();
+      matched_names.clear();
+      return;
+    }
+    std::optional<NameMatcher> matcher;
+    try {
+      matcher.emplace(search_mode, query);
+    } catch (const std::regex_error &) {
+      /* likely not typed completely yet */
+      bad_pattern = true;
+      matched_query.clear();
       return;
     }
-    for (auto &node_ptr : nodes) {
-      if (node_ptr->render_string(0, 0).find(search_string, 0) !=
-          std::string::npos) {
-        node_ptr->is_highlighted = true;
+
+    /* hidden entries are found too */
+    sortAllEntries();
+    if (entry_ranks.empty()) {
+      entry_ranks.assign(profile->functionCount(), NodeList::npos);
+      for (size_t rank = 0; rank < entries.size(); ++rank) {
+        entry_ranks[entries[rank]] = rank;
       }
     }
+    if (search_mode == NameMatcher::Mode::Substring) {
+      if (!name_index) {
+        name_index = std::make_unique<NameIndex>(profile->names());
+      }
+      /* a longer query only drops names */
+      if (!matched_query.empty() && query.find(matched_query) != query.npos) {
+        matched_names = name_index->refine(query, matched_names);
+      } else {
+        matched_names = name_index->find(query);
+      }
+      matched_query = query;
+    } else {
+      if (!search_pool) {
+        search_pool =
+            std::make_unique<ThreadPool>(std::thread::hardware_concurrency());
+      }
+      matched_names = matcher->findAll(profile->names(), search_pool.get());
+      matched_query.clear();
+    }
 
-    /* move selector to the first highlighted entry */
-    auto first_highlighted =
-        std::find_if(begin(nodes), end(nodes), [](const TreeNodePtr &node) {
-          return node->is_highlighted && node->selectable;
-        });
-    if (first_highlighted != end(nodes)) {
-      selected_inode = std::distance(begin(nodes), first_highlighted);
+    std::vector<bool> name_matches(profile->names().size());
+    for (auto name : matched_names) name_matches[name] = true;
+    /* the shown file and object names are the short ones, each is matched
+       once */
+    const bool paths_shown =
+        name_view == kFileSymbol || name_view == kObjectSymbol;
+    std::vector<int8_t> path_matches(
+        paths_shown ? profile->names().size() : 0, -1);
+    const auto shown_match = [&](NameId name) {
+      auto &match = path_matches[name];
+      if (match < 0) match = matcher->matches(display_names->shortName(name));
+      return match > 0;
+    };
+    matched_functions.assign(profile->functionCount(), false);
+    for (FunctionId function = 0; function < profile->functionCount();
+         ++function) {
+      bool match = name_matches[profile->symbolName(function)];
+      if (!match && name_view == kFileSymbol) {
+        match = shown_match(profile->fileName(function));
+      } else if (!match && name_view == kObjectSymbol) {
+        match = shown_match(profile->objectName(function));
+      }
+      matched_functions[function] = match;
+    }
+
+    for (auto entry : entries) {
+      if (matched_functions[entry]) matches.push_back(entry);
+    }
+    for (FunctionId function = 0; function < profile->functionCount();
+         ++function) {
+      if (matched_functions[function] &&
+          entry_ranks[function] == NodeList::npos) {
+        matches.push_back(function);
+      }
+    }
+  }
+
+  /* selects the match step matches away from the current one */
+  void nextMatch(long step) {
+    if (!matches.empty()) {
+      const auto count = long(matches.size());
+      current_match =
+          current_match == kNoMatch
+              ? (step > 0 ? 0 : count - 1)
+              : size_t(((long(current_match) + step) % count + count) % count);
+      revealFunction(matches[current_match]);
+    }
+    render();
+  }
+
+  /* selects the entry of function, or a call of it from an entry, which is
+     expanded */
+  void revealFunction(FunctionId function) {
+    if (entry_ranks[function] != NodeList::npos) {
+      selected_inode = long(revealEntry(entry_ranks[function]));
+      return;
+    }
+    for (auto caller : profile->callers(function)) {
+      if (entry_ranks[caller] == NodeList::npos) continue;
+      const auto root = revealEntry(entry_ranks[caller]);
+      expandNode(root);
+      for (auto child = root + 1;
+           child < nodes.size() && nodes.row(child).level > 0;
+           child = nodes.nextAtLevel(child, 1)) {
+        if (nodes[child].kind == TreeNode::kOthers &&
+            !nodes[child].others_callers && hides(nodes[child], function)) {
+          expandOthers(child);
+        }
+        const auto &node = nodes[child];
+        if (node.kind == TreeNode::kCall && node.function == function) {
+          selected_inode = long(child);
+          return;
+        }
+      }
+    }
+  }
+
+  /* the top-level row of the entry of rank, shown if it was hidden */
+  size_t revealEntry(size_t rank) {
+    auto root = nodes.root(rank);
+    if (root == NodeList::npos || nodes[root].kind == TreeNode::kOthers) {
+      expandOthers(nodes.prevBelowLevel(nodes.size(), 1));
+      root = nodes.root(rank);
+    }
+    return root;
+  }
+
+  /* shows the costs of function by line or instruction instead of the
+     tree */
+  void openAnnotation(FunctionId function) {
+    /* a diff has no cost lines to annotate */
+    if (diff || function == Profile::kNoFunction) return;
+    const auto &positions = profile->positions();
+    const auto line = std::find(begin(positions), end(positions), "line");
+    annotation_activated = true;
+    annotated_function = function;
+    annotation_position =
+        line != end(positions) ? size_t(line - begin(positions)) : 0;
+    annotation_selected = 0;
+    annotation_offset = 0;
+    annotation = Annotation(*profile, function, annotation_position,
+                            cost_event);
+    full_redraw = true;
+    render();
+  }
+
+  int dispatchStats(int ch) {
+    switch (ch) {
+      case 'S':
+      case 's':
+      case 'H':
+      case 'h':
+      case KEY_LEFT:
+      case 27 /*ESCAPE */:
+        stats_activated = false;
+        full_redraw = true;
+        render();
+        break;
+      case 'q':
+      case 'Q':
+      case KEY_F(10):
+        return -1;
+      default:;
+    }
+    return 0;
+  }
+
+  void renderStats(int frame_width, int frame_height) {
+    static std::string no_bullet;
+    for (int iline = 1; iline < frame_height; ++iline) {
+      const auto istats = size_t(iline - 1);
+      DrawnLine line;
+      if (istats < stats_lines.size() ||
+          (istats == 0 && stats_lines.empty())) {
+        line.bullet = &no_bullet;
+        line.padding_left = 1;
+        line.color_pair = 1;
+        line.text = stats_lines.empty() ? "Still parsing" : stats_lines[istats];
+      }
+      drawLine(iline, std::move(line), frame_width);
+    }
+    wnoutrefresh(window);
+    setMessage("Parse stats, 's' or Esc to go back");
+    doupdate();
+  }
+
+  int dispatchAnnotation(int ch) {
+    switch (ch) {
+      case 'J':
+      case 'j':
+      case KEY_DOWN:
+        moveAnnotation(1);
+        break;
+      case 'K':
+      case 'k':
+      case KEY_UP:
+        moveAnnotation(-1);
+        break;
+      case KEY_NPAGE:
+        moveAnnotation(getmaxy(window) - 2);
+        break;
+      case KEY_PPAGE:
+        moveAnnotation(-(getmaxy(window) - 2));
+        break;
+      case 'S':
+      case 's':
+        annotation_by_cost = !annotation_by_cost;
+        annotation_selected = 0;
+        render();
+        break;
+      case 'I':
+      case 'i':
+        /* the next position, e.g. instructions instead of lines */
+        annotation_position =
+            (annotation_position + 1) % std::max<size_t>(
+                                            profile->positions().size(), 1);
+        annotation_selected = 0;
+        annotation = Annotation(*profile, annotated_function,
+                                annotation_position, cost_event);
+        render();
+        break;
+      case 'C':
+      case 'c':
+        toggleCostsView();
+        break;
+      case 'x':
+        switchEvent(1);
+        break;
+      case 'X':
+        switchEvent(-1);
+        break;
+      case 'A':
+      case 'a':
+      case 'h':
+      case 'H':
+      case KEY_LEFT:
+      case 27 /* ESCAPE */:
+        annotation_activated = false;
+        full_redraw = true;
+        render();
+        break;
+      case 'q':
+      case 'Q':
+      case KEY_F(10):
+        return -1;
+      default:;
     }
+    return 0;
+  }
+
+  void moveAnnotation(long step) {
+    const auto count = long(annotation.lines().size());
+    annotation_selected =
+        std::max(0l, std::min(annotation_selected + step, count - 1));
+    render();
+  }
+
+  void renderAnnotation(int frame_width, int frame_height) {
+    static std::string no_bullet;
+    constexpr auto PAIR_SELECTED = 2;
+    const auto &lines = annotation.lines();
+    const auto count = long(lines.size());
+
+    if (annotation_selected - annotation_offset >= frame_height - 2) {
+      annotation_offset = annotation_selected - (frame_height - 2);
+    } else if (annotation_selected < annotation_offset) {
+      annotation_offset = annotation_selected;
+    }
+    const bool by_line =
+        annotation_position < profile->positions().size() &&
+        profile->positions()[annotation_position] == "line";
+    /* only the shown lines are read from the source */
+    auto source =
+        by_line ? sourceFile(profile->file(annotated_function)) : nullptr;
+    auto iannotation = annotation_offset;
+    for (int iline = 1; iline < frame_height; ++iline, ++iannotation) {
+      if (iannotation >= count) {
+        DrawnLine empty;
+        if (count == 0 && iline == 1) {
+          /* snapshots of a file still parsed have no cost lines */
+          empty.bullet = &no_bullet;
+          empty.padding_left = 1;
+          empty.color_pair = 1;
+          empty.text = "No cost lines";
+        }
+        drawLine(iline, std::move(empty), frame_width);
+        continue;
+      }
+      const auto &line =
+          lines[annotation_by_cost ? annotation.byCost()[iannotation]
+                                   : iannotation];
+      DrawnLine drawn;
+      drawn.bullet = &no_bullet;
+      drawn.text = annotationText(line, by_line, source);
+      drawn.padding_left = 1;
+      drawn.color_pair = iannotation == annotation_selected ? PAIR_SELECTED : 1;
+      drawLine(iline, std::move(drawn), frame_width);
+    }
+
+    wnoutrefresh(window);
+    std::stringstream message;
+    message << profile->symbol(annotated_function) << " ("
+            << short_path(profile->file(annotated_function)) << "), self and "
+            << "call costs by "
+            << (annotation_position < profile->positions().size()
+                    ? profile->positions()[annotation_position]
+                    : std::string("position"))
+            << (annotation_by_cost ? ", the most expensive first" : "");
+    if (by_line && !source->readable()) message << ", no source";
+    setMessage(message.str());
+    doupdate();
+  }
+
+  std::string annotationText(const Annotation::Line &line, bool by_line,
+                             SourceFile *source) const {
+    std::stringstream text_stream;
+    for (auto cost : {line.self, line.calls}) {
+      if (costs_view == kAbsolute) {
+        text_stream << "[" << std::setw(7) << std::setprecision(2)
+                    << double(cost) << "] ";
+      } else {
+        text_stream << "[" << std::setw(7) << std::setprecision(2)
+                    << (annotation.total() > 0
+                            ? 100 * double(cost) / annotation.total()
+                            : 0.)
+                    << "%] ";
+      }
+    }
+    if (!by_line) {
+      text_stream << "0x" << std::hex << line.position;
+      return text_stream.str();
+    }
+    text_stream << std::setw(6) << line.position << "  ";
+    /* tabs would move the cursor past the line */
+    size_t column = 0;
+    for (auto c : source->line(line.position)) {
+      if (c == '\t') {
+        do {
+          text_stream << ' ';
+        } while (++column % 8 != 0);
+      } else {
+        text_stream << c;
+        ++column;
+      }
+    }
+    return text_stream.str();
+  }
+
+  SourceFile *sourceFile(std::string_view filename) {
+    auto &source = source_files[std::string(filename)];
+    if (!source) source = std::make_unique<SourceFile>(std::string(filename));
+    return source.get();
   }
 
   void setMessage(const std::string &message) const {
@@ -578,26 +1361,254 @@ struct TreeView {
 
   ENameView name_view{kSymbolOnly};
   CostsView costs_view{kAbsolute};
+  /* shown and sorted by */
+  size_t cost_event{Profile::kPrimaryEvent};
   long selected_inode{0};
   long offset_inode{0};
 
   WINDOW *window{nullptr};
-  std::shared_ptr<const CallgrindParser> parser{};
+  int input_timeout{-1};
+  using Clock = std::chrono::steady_clock;
+  static constexpr auto kFrameInterval = std::chrono::milliseconds(16);
+  bool render_pending{true};
+  Clock::time_point next_frame{};
+  /* indexed by window line */
+  std::vector<DrawnLine> drawn_lines;
+  std::string drawn_title;
+  bool full_redraw{true};
+  std::shared_ptr<const Profile> profile{};
+  /* the calls of the functions sorted by an event, kept while the profile
+     is shown */
+  std::unique_ptr<CallGraph> call_graph;
+  /* the names of the functions in the name views shown so far */
+  std::unique_ptr<DisplayNames> display_names;
+  /* percent of the total cost, see SetThreshold() */
+  double threshold{0};
+  Profile::Cost total_cost{0};
+  /* set when the profile is the joined one of a diff */
+  std::shared_ptr<const ProfileDiff> diff{};
+
+  static constexpr size_t kTextCacheSize = 4096;
+  std::unordered_map<uint64_t, std::string> text_cache;
+  int text_cache_name_view{-1};
+  int text_cache_costs_view{-1};
 
   bool nodes_initialized{false};
-  std::vector<std::shared_ptr<TreeNode> > nodes;
+  /* the entries in display order, only the shown ones until all_entries */
+  std::vector<FunctionId> entries;
+  bool all_entries{true};
+  /* the visible nodes in display order */
+  NodeList nodes;
 
   bool search_activated{false};
+  NameMatcher::Mode search_mode{NameMatcher::Mode::Substring};
+  bool bad_pattern{false};
+  static constexpr int kMatchCountWidth = 16;
   std::vector<FIELD *> search_fields;
   FORM *search_form{nullptr};
 
+  static constexpr size_t kNoMatch = size_t(-1);
+  std::string search_query;
+  /* over the names of the profile, made by the first search */
+  std::unique_ptr<NameIndex> name_index;
+  std::string matched_query;
+  std::vector<NameId> matched_names;
+  /* for the regex and fuzzy modes, which scan all the names */
+  std::unique_ptr<ThreadPool> search_pool;
+  /* by function */
+  std::vector<bool> matched_functions;
+  /* the functions to go through with n and N */
+  std::vector<FunctionId> matches;
+  size_t current_match{kNoMatch};
+  /* position of each entry in entries, npos for the others */
+  std::vector<size_t> entry_ranks;
+
+  bool stats_activated{false};
+  std::vector<std::string> stats_lines;
+
+  /* the annotation of a function shown instead of the tree */
+  bool annotation_activated{false};
+  FunctionId annotated_function{Profile::kNoFunction};
+  size_t annotation_position{0};
+  bool annotation_by_cost{true};
+  Annotation annotation;
+  long annotation_selected{0};
+  long annotation_offset{0};
+  /* by file name, mapped once */
+  std::unordered_map<std::string, std::unique_ptr<SourceFile>> source_files;
+
   std::shared_ptr<ItemView> item_view;
 };
 
-int main(int argc, char *argv[]) {
-  if (argc == 1) return 1;
+/* how often the progress is shown while the file is parsed, ms */
+constexpr int kProgressInterval = 100;
+
+/* how long the followed files have to stay the same before they are
+   merged, ms */
+constexpr int kFollowInterval = 500;
+
+/* merges the dumps of the followed run until stop is set: once the watcher
+   saw no change for an interval, or every interval without a watcher */
+void followRun(CallgrindParser &parser, const std::atomic<bool> &stop) {
+  FileWatcher watcher(parser.followedDirectory());
+  bool changed = true;
+  while (!stop) {
+    if (watcher.wait(std::chrono::milliseconds(kFollowInterval))) {
+      changed = true;
+      continue;
+    }
+    if (watcher.watching() && !changed) continue;
+    parser.update();
+    changed = parser.pending();
+  }
+}
+
+void renderStatus(const std::string &status) {
+  mvprintw(0, 0, "%s", status.c_str());
+  clrtoeol();
+  wnoutrefresh(stdscr);
+  doupdate();
+}
 
-  std::string file_to_process{argv[1]};
+std::string loadingStatus(const CallgrindParser::Progress &progress) {
+  std::stringstream text_stream;
+  text_stream << std::fixed << std::setprecision(1) << "Loading "
+              << double(progress.bytes_read) / (1 << 20) << " of "
+              << double(progress.total_bytes) / (1 << 20) << " MB, "
+              << progress.lines << " lines, " << progress.entries
+              << " entries. Press 'q' or F10 to exit";
+  return text_stream.str();
+}
+
+/* parses the files and writes the top entries to the standard output,
+   without curses */
+int runReport(const std::vector<std::string> &files, bool keep_parts,
+              size_t top, const std::string &event_name,
+              const std::string &format_name) {
+  try {
+    const auto format = Report::parseFormat(format_name);
+    CallgrindParser parser(files);
+    parser.SetKeepParts(keep_parts);
+    parser.SetThreads(std::thread::hardware_concurrency());
+    parser.SetSortEntries(false);
+    parser.parse();
+    const auto profile = parser.getProfile();
+    const auto event = event_name.empty()
+                           ? Profile::kPrimaryEvent
+                           : Report::findEvent(*profile, event_name);
+    std::string title;
+    for (const auto &file : files) title += (title.empty() ? "" : " ") + file;
+    Report(*profile, event, top).write(std::cout, format, title);
+  } catch (const std::exception &e) {
+    std::cerr << "cursegrind: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+/* parses the files and writes their folded call stacks to the standard
+   output, without curses */
+int runFlameGraph(const std::vector<std::string> &files, bool keep_parts,
+                  const std::string &event_name) {
+  try {
+    CallgrindParser parser(files);
+    parser.SetKeepParts(keep_parts);
+    parser.SetThreads(std::thread::hardware_concurrency());
+    parser.parse();
+    const auto profile = parser.getProfile();
+    const auto event = event_name.empty()
+                           ? Profile::kPrimaryEvent
+                           : Report::findEvent(*profile, event_name);
+    CallGraph(*profile).writeFolded(std::cout, event);
+  } catch (const std::exception &e) {
+    std::cerr << "cursegrind: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+/* parses the files and writes what it took as JSON to the standard
+   output, without curses */
+int runStats(const std::vector<std::string> &files, bool keep_parts) {
+  try {
+    CallgrindParser parser(files);
+    parser.SetKeepParts(keep_parts);
+    parser.SetThreads(std::thread::hardware_concurrency());
+    parser.parse();
+    parser.stats()->writeJson(std::cout);
+  } catch (const std::exception &e) {
+    std::cerr << "cursegrind: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  /* cursegrind [--keep-parts] [--follow] [--threshold P] [--no-cache]
+                file...|directory
+     cursegrind --diff [--keep-parts] base current
+     cursegrind --report [--top N] [--event E] [--format text|csv|json]
+                [--keep-parts] file...
+     cursegrind --stats [--keep-parts] file...
+     cursegrind --flamegraph [--event E] [--keep-parts] file... */
+  std::vector<std::string> files_to_process;
+  bool keep_parts = false;
+  bool report = false;
+  bool stats = false;
+  bool flame_graph = false;
+  bool diff_mode = false;
+  bool follow = false;
+  bool cache = true;
+  size_t report_top = 20;
+  double threshold = 0;
+  std::string report_event;
+  std::string report_format = "text";
+  for (int iarg = 1; iarg < argc; ++iarg) {
+    const bool has_value = iarg + 1 < argc;
+    if (std::strcmp(argv[iarg], "--keep-parts") == 0) {
+      keep_parts = true;
+    } else if (std::strcmp(argv[iarg], "--diff") == 0) {
+      diff_mode = true;
+    } else if (std::strcmp(argv[iarg], "--follow") == 0) {
+      follow = true;
+    } else if (std::strcmp(argv[iarg], "--no-cache") == 0) {
+      cache = false;
+    } else if (std::strcmp(argv[iarg], "--stats") == 0) {
+      stats = true;
+    } else if (std::strcmp(argv[iarg], "--flamegraph") == 0) {
+      flame_graph = true;
+    } else if (std::strcmp(argv[iarg], "--report") == 0) {
+      report = true;
+    } else if (std::strcmp(argv[iarg], "--top") == 0 && has_value) {
+      report_top = std::strtoull(argv[++iarg], nullptr, 10);
+    } else if (std::strcmp(argv[iarg], "--threshold") == 0 && has_value) {
+      threshold = std::strtod(argv[++iarg], nullptr);
+    } else if (std::strcmp(argv[iarg], "--event") == 0 && has_value) {
+      report_event = argv[++iarg];
+    } else if (std::strcmp(argv[iarg], "--format") == 0 && has_value) {
+      report_format = argv[++iarg];
+    } else {
+      files_to_process.emplace_back(argv[iarg]);
+    }
+  }
+  if (files_to_process.empty()) return 1;
+  if (diff_mode && files_to_process.size() != 2) {
+    std::cerr << "cursegrind: --diff compares a base and a current file"
+              << std::endl;
+    return 1;
+  }
+  if (follow && (diff_mode || report || stats || flame_graph)) {
+    std::cerr << "cursegrind: --follow shows a single run" << std::endl;
+    return 1;
+  }
+  if (stats) return runStats(files_to_process, keep_parts);
+  if (flame_graph) {
+    return runFlameGraph(files_to_process, keep_parts, report_event);
+  }
+  if (report) {
+    return runReport(files_to_process, keep_parts, report_top, report_event,
+                     report_format);
+  }
 
   initscr(); /* Start curses mode 		*/
 
@@ -616,26 +1627,147 @@ int main(int argc, char *argv[]) {
 
   noecho();
 
-  printw("Press 'q' or F10 to exit");
-  refresh();
+  renderStatus("Press 'q' or F10 to exit");
+
+  /* the file is parsed in the background, the view shows the snapshots
+     published meanwhile; the two files of a diff are parsed at the same
+     time and shown once joined */
+  std::vector<std::shared_ptr<CallgrindParser>> parsers;
+  if (diff_mode) {
+    for (const auto &file : files_to_process) {
+      parsers.push_back(std::make_shared<CallgrindParser>(file));
+    }
+  } else {
+    parsers.push_back(std::make_shared<CallgrindParser>(files_to_process));
+  }
+  for (auto &parser : parsers) {
+    parser->SetKeepParts(keep_parts);
+    parser->SetThreads(std::thread::hardware_concurrency() /
+                       unsigned(parsers.size()));
+    parser->SetSnapshots(!diff_mode);
+    parser->SetCache(cache);
+    parser->SetFollow(follow);
+  }
+  auto &parser = parsers.back();
+  std::shared_ptr<const ProfileDiff> diff;
+  std::atomic<bool> parse_finished{false};
+  std::atomic<bool> following{false};
+  std::atomic<bool> stop_following{false};
+  std::string parse_error;
+  std::thread parse_thread([&] {
+    try {
+      if (diff_mode) {
+        std::string base_error;
+        std::thread base_thread([&] {
+          try {
+            parsers[0]->parse();
+          } catch (const std::exception &e) {
+            base_error = e.what();
+          }
+        });
+        try {
+          parsers[1]->parse();
+        } catch (...) {
+          parsers[0]->Cancel();
+          base_thread.join();
+          throw;
+        }
+        base_thread.join();
+        if (!base_error.empty()) throw std::runtime_error(base_error);
+        diff = std::make_shared<ProfileDiff>(*parsers[0]->getProfile(),
+                                             *parsers[1]->getProfile());
+      } else {
+        parser->parse();
+        if (follow) {
+          following = true;
+          followRun(*parser, stop_following);
+        }
+      }
+    } catch (const std::exception &e) {
+      parse_error = e.what();
+    }
+    following = false;
+    parse_finished = true;
+  });
 
-  auto parser = std::make_shared<CallgrindParser>(file_to_process);
-  auto tree_view = std::make_shared<TreeView>(parser);
+  auto empty_profile = std::make_shared<Profile>();
+  empty_profile->finalize();
+  auto tree_view = std::make_shared<TreeView>(empty_profile);
   auto item_view = std::make_shared<ItemView>();
   tree_view->SetItemView(item_view);
-  parser->SetVerbose(false);
-  parser->parse();
+  tree_view->SetInputTimeout(kProgressInterval);
+  tree_view->SetThreshold(threshold);
 
   tree_view->render();
   item_view->render();
+  doupdate();
 
-  int ch = 1;
+  std::shared_ptr<const Profile> shown_profile;
+  std::vector<std::shared_ptr<const ParseStats>> shown_stats(parsers.size());
+  bool loading = true;
   while (true) {
-    if (0 != tree_view->dispatch(ch)) {
+    if (loading) {
+      /* read before the snapshot so the final one is not missed; a followed
+         run goes on publishing them */
+      const bool finished = parse_finished;
+      const bool live = following;
+      if (auto snapshot = parser->getSnapshot();
+          snapshot && snapshot != shown_profile) {
+        shown_profile = snapshot;
+        tree_view->setProfile(snapshot);
+      }
+      /* the stats of the files parsed so far, a diff shows the base first */
+      bool stats_changed = false;
+      for (size_t iparser = 0; iparser < parsers.size(); ++iparser) {
+        auto file_stats = parsers[iparser]->stats();
+        stats_changed |= file_stats != shown_stats[iparser];
+        shown_stats[iparser] = std::move(file_stats);
+      }
+      if (stats_changed) {
+        std::vector<std::string> lines;
+        for (size_t iparser = 0; iparser < parsers.size(); ++iparser) {
+          if (!shown_stats[iparser]) continue;
+          if (diff_mode) {
+            if (!lines.empty()) lines.emplace_back();
+            lines.push_back(files_to_process[iparser]);
+          }
+          const auto file_lines = shown_stats[iparser]->textLines();
+          lines.insert(lines.end(), file_lines.begin(), file_lines.end());
+        }
+        tree_view->setStats(std::move(lines));
+      }
+      if (finished) {
+        loading = false;
+        if (diff) tree_view->setDiff(diff);
+        tree_view->SetInputTimeout(-1);
+        renderStatus(parse_error.empty()
+                         ? "Press 'q' or F10 to exit"
+                         : "Error: " + parse_error +
+                               ". Press 'q' or F10 to exit");
+      } else if (live) {
+        renderStatus("Following " + parser->followedDirectory() +
+                     ". Press 'q' or F10 to exit");
+      } else {
+        CallgrindParser::Progress progress{0, 0, 0, 0};
+        for (const auto &file_parser : parsers) {
+          const auto file_progress = file_parser->progress();
+          progress.bytes_read += file_progress.bytes_read;
+          progress.total_bytes += file_progress.total_bytes;
+          progress.lines += file_progress.lines;
+          progress.entries += file_progress.entries;
+        }
+        renderStatus(loadingStatus(progress));
+      }
+    }
+    if (0 != tree_view->dispatch()) {
       break;
     }
   }
 
+  stop_following = true;
+  for (auto &file_parser : parsers) file_parser->Cancel();
+  parse_thread.join();
+
   tree_view->destroy();
   endwin(); /* End curses mode		  */
   return 0;